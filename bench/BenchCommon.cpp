@@ -0,0 +1,15 @@
+#include "BenchCommon.hpp"
+
+#include <cmath>
+
+std::vector<glm::vec3> MakeGridPositions(size_t count, float spacing)
+{
+    size_t side = (size_t)std::ceil(std::sqrt((double)count));
+    std::vector<glm::vec3> positions;
+    positions.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        positions.push_back(glm::vec3((float)(i % side) * spacing, 0.0f, -(float)(i / side) * spacing));
+    }
+    return positions;
+}
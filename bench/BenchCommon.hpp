@@ -0,0 +1,68 @@
+#ifndef BENCHCOMMON_HPP
+#define BENCHCOMMON_HPP
+
+#include "JobSystem.hpp"
+
+#include <benchmark/benchmark.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Scene sizes every scaling benchmark runs at
+const int64_t gBenchMinObjects = 1000;
+const int64_t gBenchMaxObjects = 1000000;
+
+// Object counts 1k to 1M, times thread counts 1 to 8
+#define BENCH_SCENE_SIZES RangeMultiplier(10)->Range(gBenchMinObjects, gBenchMaxObjects)
+#define BENCH_SCENE_THREADS ArgsProduct({benchmark::CreateRange(gBenchMinObjects, gBenchMaxObjects, 10), {1, 2, 4, 8}})
+
+// Jobs for the benchmarks that split their work, on threads threads,
+// counting the benchmark's own. One thread runs the work inline, since
+// JobSystem::start(0) would pick a worker per core.
+class BenchJobs
+{
+public:
+    explicit BenchJobs(size_t threads)
+        : mThreads(threads)
+    {
+        if (threads > 1)
+        {
+            mJobs.start(threads - 1);
+        }
+    }
+
+    ~BenchJobs()
+    {
+        mJobs.stop();
+    }
+
+    BenchJobs(const BenchJobs &) = delete;
+    BenchJobs &operator=(const BenchJobs &) = delete;
+
+    // About four ranges per thread, inside the job rings
+    template <typename F>
+    void parallelFor(size_t count, const F &function)
+    {
+        if (mThreads <= 1)
+        {
+            function((size_t)0, count);
+            return;
+        }
+        size_t grain = (count + mThreads * 4 - 1) / (mThreads * 4);
+        mJobs.parallelFor(count, grain, function);
+    }
+
+    size_t getThreadCount() const { return mThreads; }
+
+private:
+    size_t mThreads;
+    JobSystem mJobs;
+};
+
+// Square grid of count positions spacing apart on the xz plane, like the
+// instanced scene
+std::vector<glm::vec3> MakeGridPositions(size_t count, float spacing);
+
+#endif
@@ -0,0 +1,63 @@
+#include "BenchCommon.hpp"
+#include "Camera.hpp"
+
+#include <glm/ext.hpp>
+
+// A moved camera rebuilds view, view projection and frustum on the next get
+static void BM_CameraMoveAndRebuild(benchmark::State &state)
+{
+    Camera camera;
+    camera.setProjection(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+    for (auto _ : state)
+    {
+        camera.mouseLook(1, 0);
+        camera.moveForward(0.01f);
+        benchmark::DoNotOptimize(camera.getFrustum());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CameraMoveAndRebuild);
+
+// A projection change invalidates everything built from it too
+static void BM_CameraProjectionRebuild(benchmark::State &state)
+{
+    Camera camera;
+    float aspect = 1.0f;
+    for (auto _ : state)
+    {
+        aspect = aspect > 2.0f ? 1.0f : aspect + 0.01f;
+        camera.setProjection(glm::radians(45.0f), aspect, 0.1f, 200.0f);
+        benchmark::DoNotOptimize(camera.getViewProjectionMatrix());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CameraProjectionRebuild);
+
+// Nothing changed, every get returns the cached result
+static void BM_CameraCached(benchmark::State &state)
+{
+    Camera camera;
+    camera.setProjection(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+    camera.getFrustum();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(camera.getViewProjectionMatrix());
+        benchmark::DoNotOptimize(camera.getFrustum());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CameraCached);
+
+// Plane extraction alone, as done once per culled view
+static void BM_ExtractFrustum(benchmark::State &state)
+{
+    glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 200.0f) *
+                               glm::lookAt(glm::vec3(0.0f, 2.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(viewProjection);
+        benchmark::DoNotOptimize(ExtractFrustum(viewProjection));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ExtractFrustum);
@@ -0,0 +1,123 @@
+#include "BenchCommon.hpp"
+#include "Camera.hpp"
+#include "SceneIndex.hpp"
+
+#include <glm/ext.hpp>
+
+// One box per grid position, and a camera above one corner looking
+// across the grid, so part of the scene is visible at every size
+static void BuildScene(SceneIndex &index, size_t count)
+{
+    std::vector<glm::vec3> positions = MakeGridPositions(count, 1.5f);
+    for (const glm::vec3 &position : positions)
+    {
+        index.insert(MakeBounds(position, glm::vec3(0.5f)));
+    }
+    index.build();
+}
+
+static Frustum MakeSceneFrustum()
+{
+    Camera camera;
+    camera.setProjection(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+    camera.setView(glm::vec3(-5.0f, 10.0f, 5.0f), glm::vec3(1.0f, -0.3f, -1.0f));
+    return camera.getFrustum();
+}
+
+// BVH traversal testing leaf boxes four or eight at a time
+static void BM_SceneCull(benchmark::State &state)
+{
+    size_t count = (size_t)state.range(0);
+    SceneIndex index;
+    BuildScene(index, count);
+    Frustum frustum = MakeSceneFrustum();
+    std::vector<SceneIndex::ObjectId> visible;
+    visible.reserve(count);
+    for (auto _ : state)
+    {
+        visible.clear();
+        index.cull(frustum, visible);
+        benchmark::DoNotOptimize(visible.data());
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+    state.counters["visible"] = (double)visible.size();
+}
+BENCHMARK(BM_SceneCull)->BENCH_SCENE_SIZES;
+
+// The same query one box at a time
+static void BM_SceneCullScalar(benchmark::State &state)
+{
+    size_t count = (size_t)state.range(0);
+    SceneIndex index;
+    BuildScene(index, count);
+    Frustum frustum = MakeSceneFrustum();
+    std::vector<SceneIndex::ObjectId> visible;
+    visible.reserve(count);
+    for (auto _ : state)
+    {
+        visible.clear();
+        index.cullScalar(frustum, visible);
+        benchmark::DoNotOptimize(visible.data());
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+    state.counters["visible"] = (double)visible.size();
+}
+BENCHMARK(BM_SceneCullScalar)->BENCH_SCENE_SIZES;
+
+// Disjoint subtrees culled on the job threads, as frame recording does
+static void BM_SceneCullParallel(benchmark::State &state)
+{
+    size_t count = (size_t)state.range(0);
+    SceneIndex index;
+    BuildScene(index, count);
+    Frustum frustum = MakeSceneFrustum();
+    BenchJobs jobs((size_t)state.range(1));
+
+    std::vector<uint32_t> roots;
+    index.getSubtrees(jobs.getThreadCount() * 4, roots);
+    std::vector<std::vector<SceneIndex::ObjectId>> visible(roots.size());
+    std::vector<std::vector<uint32_t>> stacks(roots.size());
+    std::vector<SceneIndex::CullStats> stats(roots.size());
+
+    size_t visibleCount = 0;
+    for (auto _ : state)
+    {
+        jobs.parallelFor(roots.size(), [&](size_t first, size_t last)
+                         {
+                             for (size_t i = first; i < last; i++)
+                             {
+                                 visible[i].clear();
+                                 index.cullSubtree(frustum, roots[i], visible[i], stacks[i], stats[i]);
+                             } });
+        visibleCount = 0;
+        for (const std::vector<SceneIndex::ObjectId> &objects : visible)
+        {
+            visibleCount += objects.size();
+        }
+        benchmark::DoNotOptimize(visibleCount);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+    state.counters["visible"] = (double)visibleCount;
+}
+BENCHMARK(BM_SceneCullParallel)->BENCH_SCENE_THREADS->UseRealTime();
+
+// Moving every object and committing, refits and the occasional rebuild
+static void BM_SceneRefit(benchmark::State &state)
+{
+    size_t count = (size_t)state.range(0);
+    SceneIndex index;
+    BuildScene(index, count);
+    std::vector<glm::vec3> positions = MakeGridPositions(count, 1.5f);
+    float offset = 0.0f;
+    for (auto _ : state)
+    {
+        offset = offset > 1.0f ? 0.0f : offset + 0.01f;
+        for (size_t i = 0; i < count; i++)
+        {
+            index.update((SceneIndex::ObjectId)i, MakeBounds(positions[i] + glm::vec3(0.0f, offset, 0.0f), glm::vec3(0.5f)));
+        }
+        index.commit();
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+}
+BENCHMARK(BM_SceneRefit)->BENCH_SCENE_SIZES;
@@ -0,0 +1,83 @@
+#include "BenchCommon.hpp"
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Wavy indexed grid of about count vertices, 6 floats each like the
+// scene mesh. Rows are emitted in scanline order, far from what a vertex
+// cache wants.
+static void MakeGridMesh(size_t count, std::vector<float> &vertices, std::vector<uint32_t> &indices)
+{
+    size_t side = std::max((size_t)std::sqrt((double)count), (size_t)2);
+    vertices.clear();
+    indices.clear();
+    vertices.reserve(side * side * 6);
+    for (size_t y = 0; y < side; y++)
+    {
+        for (size_t x = 0; x < side; x++)
+        {
+            float u = (float)x / (float)(side - 1);
+            float v = (float)y / (float)(side - 1);
+            float height = 0.1f * std::sin(u * 20.0f) * std::cos(v * 20.0f);
+            const float vertex[6] = {u, height, v, u, v, 0.5f};
+            vertices.insert(vertices.end(), vertex, vertex + 6);
+        }
+    }
+
+    indices.reserve((side - 1) * (side - 1) * 6);
+    for (size_t y = 0; y + 1 < side; y++)
+    {
+        for (size_t x = 0; x + 1 < side; x++)
+        {
+            uint32_t corner = (uint32_t)(y * side + x);
+            const uint32_t quad[6] = {corner, corner + 1, corner + (uint32_t)side, corner + (uint32_t)side, corner + 1, corner + (uint32_t)side + 1};
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+// The import pipeline: weld, vertex cache, overdraw and vertex fetch
+static void BM_OptimizeMesh(benchmark::State &state)
+{
+    std::vector<float> sourceVertices;
+    std::vector<uint32_t> sourceIndices;
+    MakeGridMesh((size_t)state.range(0), sourceVertices, sourceIndices);
+
+    MeshOptimizeStats stats;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::vector<float> vertices = sourceVertices;
+        std::vector<uint32_t> indices = sourceIndices;
+        state.ResumeTiming();
+
+        stats = OptimizeMesh(vertices, 6, indices);
+        benchmark::DoNotOptimize(indices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)(sourceIndices.size() / 3));
+    state.counters["acmr_before"] = stats.mAcmrBefore;
+    state.counters["acmr_after"] = stats.mAcmrAfter;
+}
+BENCHMARK(BM_OptimizeMesh)->BENCH_SCENE_SIZES->Unit(benchmark::kMillisecond);
+
+// Tipsify alone
+static void BM_OptimizeVertexCache(benchmark::State &state)
+{
+    std::vector<float> vertices;
+    std::vector<uint32_t> sourceIndices;
+    MakeGridMesh((size_t)state.range(0), vertices, sourceIndices);
+    size_t vertexCount = vertices.size() / 6;
+
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::vector<uint32_t> indices = sourceIndices;
+        state.ResumeTiming();
+
+        OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+        benchmark::DoNotOptimize(indices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)(sourceIndices.size() / 3));
+}
+BENCHMARK(BM_OptimizeVertexCache)->BENCH_SCENE_SIZES->Unit(benchmark::kMillisecond);
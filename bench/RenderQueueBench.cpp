@@ -0,0 +1,64 @@
+#include "BenchCommon.hpp"
+#include "RenderQueue.hpp"
+
+#include <random>
+
+// Draws spread over a few programs, materials and vertex arrays at
+// random depths, the same every run
+static std::vector<DrawPacket> MakePackets(size_t count, bool depthFirst)
+{
+    std::mt19937 random(1234u);
+    std::uniform_int_distribution<uint32_t> state(1, 16);
+    std::uniform_real_distribution<float> depth(0.1f, 200.0f);
+
+    std::vector<DrawPacket> packets(count);
+    for (DrawPacket &packet : packets)
+    {
+        packet.mProgram = state(random);
+        packet.mVertexArray = state(random);
+        uint32_t material = state(random);
+        uint32_t quantized = QuantizeDepth(depth(random), 200.0f);
+        if (depthFirst)
+        {
+            packet.mKey = MakeDepthSortKey(1, quantized, packet.mProgram, packet.mVertexArray, material);
+        }
+        else
+        {
+            packet.mKey = MakeSortKey(1, packet.mProgram, material, packet.mVertexArray, quantized);
+        }
+        packet.mIndexCount = 6;
+    }
+    return packets;
+}
+
+// Submit a frame's packets and radix sort them
+static void RunQueue(benchmark::State &state, bool depthFirst)
+{
+    size_t count = (size_t)state.range(0);
+    std::vector<DrawPacket> packets = MakePackets(count, depthFirst);
+    RenderQueue queue;
+    for (auto _ : state)
+    {
+        queue.clear();
+        for (const DrawPacket &packet : packets)
+        {
+            queue.submit(packet);
+        }
+        queue.sort();
+        benchmark::DoNotOptimize(queue[0]);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+}
+
+static void BM_RenderQueueSort(benchmark::State &state)
+{
+    RunQueue(state, false);
+}
+BENCHMARK(BM_RenderQueueSort)->BENCH_SCENE_SIZES;
+
+// Front to back keys, the depth bits are no longer the low ones
+static void BM_RenderQueueSortDepthFirst(benchmark::State &state)
+{
+    RunQueue(state, true);
+}
+BENCHMARK(BM_RenderQueueSortDepthFirst)->BENCH_SCENE_SIZES;
@@ -0,0 +1,85 @@
+#include "BenchCommon.hpp"
+#include "TransformSystem.hpp"
+
+#include <algorithm>
+
+// Instanced quads spinning about y, as the scene simulates them
+static void FillTransforms(TransformSystem &transforms, size_t count)
+{
+    std::vector<glm::vec3> positions = MakeGridPositions(count, 1.5f);
+    transforms.reserve(count);
+    for (const glm::vec3 &position : positions)
+    {
+        transforms.create(position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+    }
+}
+
+static void SpinTransforms(TransformSystem &transforms, size_t first, size_t last, float angle)
+{
+    for (size_t i = first; i < last; i++)
+    {
+        transforms.setRotation((TransformSystem::Handle)i, glm::angleAxis(angle + (float)(i % 100) * 0.1f, glm::vec3(0.0f, 1.0f, 0.0f)));
+    }
+}
+
+// Every block dirty, matrices rebuilt on the compiled SIMD path
+static void BM_TransformUpdate(benchmark::State &state)
+{
+    size_t count = (size_t)state.range(0);
+    TransformSystem transforms;
+    FillTransforms(transforms, count);
+    for (auto _ : state)
+    {
+        transforms.markAllDirty();
+        transforms.update();
+        benchmark::DoNotOptimize(transforms.getWorldMatrices());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+    state.SetBytesProcessed(state.iterations() * (int64_t)(count * sizeof(glm::mat4)));
+    state.SetLabel(TransformSystem::getSimdName());
+}
+BENCHMARK(BM_TransformUpdate)->BENCH_SCENE_SIZES;
+
+// The same on the scalar reference path
+static void BM_TransformUpdateScalar(benchmark::State &state)
+{
+    size_t count = (size_t)state.range(0);
+    TransformSystem transforms;
+    FillTransforms(transforms, count);
+    for (auto _ : state)
+    {
+        transforms.markAllDirty();
+        transforms.updateScalar();
+        benchmark::DoNotOptimize(transforms.getWorldMatrices());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+    state.SetBytesProcessed(state.iterations() * (int64_t)(count * sizeof(glm::mat4)));
+    state.SetLabel("scalar");
+}
+BENCHMARK(BM_TransformUpdateScalar)->BENCH_SCENE_SIZES;
+
+// A simulated frame split into block ranges across the job threads:
+// spin every entry of the range, then rebuild its blocks
+static void BM_TransformSimulateParallel(benchmark::State &state)
+{
+    size_t count = (size_t)state.range(0);
+    TransformSystem transforms;
+    FillTransforms(transforms, count);
+    BenchJobs jobs((size_t)state.range(1));
+    float angle = 0.0f;
+    for (auto _ : state)
+    {
+        angle += 0.01f;
+        jobs.parallelFor(transforms.getBlockCount(), [&transforms, count, angle](size_t firstBlock, size_t lastBlock)
+                         {
+                             SpinTransforms(transforms, firstBlock * gTransformBlockSize, std::min(lastBlock * gTransformBlockSize, count), angle);
+                             transforms.updateBlocks(firstBlock, lastBlock); });
+        benchmark::DoNotOptimize(transforms.getWorldMatrices());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+    state.SetLabel(TransformSystem::getSimdName());
+}
+BENCHMARK(BM_TransformSimulateParallel)->BENCH_SCENE_THREADS->UseRealTime();
@@ -0,0 +1,101 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include "GpuProfiler.hpp"
+#include "RollingStats.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Command line settings. Without --benchmark the program runs
+// interactively and only the scene and path recording options apply.
+struct BenchmarkOptions
+{
+    bool mEnabled = false;
+    int mFrames = 1000;
+    int mWarmupFrames = 60;
+
+    // Played back in benchmarks, the scripted flyover when empty
+    std::string mCameraPath;
+
+    // Interactive runs save the camera here every frame
+    std::string mRecordPath;
+    std::string mOutputPath = "benchmark.json";
+
+    // Synthetic scene size, -1 keeps the default
+    int mInstances = -1;
+    int mStaticMeshes = -1;
+
+    bool mGpuCulling = false;
+    bool mDepthPrepass = false;
+
+    // Starting render scale, held unless a GPU budget in milliseconds
+    // lets the resolution controller change it
+    float mRenderScale = 1.0f;
+    double mGpuBudget = 0.0;
+
+    // Render into an offscreen target in a hidden window
+    bool mOffscreen = false;
+
+    // 0 keeps the default window size
+    int mWidth = 0;
+    int mHeight = 0;
+};
+
+// Prints the usage and returns false on bad arguments
+bool ParseBenchmarkOptions(int argc, char *argv[], BenchmarkOptions &options);
+
+// What was measured, written next to the results
+struct BenchmarkInfo
+{
+    std::string mRenderer;
+    std::string mVersion;
+    std::string mSimd;
+    size_t mInstances = 0;
+    size_t mStaticMeshes = 0;
+    size_t mJobThreads = 0;
+    bool mMultiDraw = false;
+    std::string mCameraPath;
+};
+
+// Per-frame samples of a benchmark run. The main thread adds its CPU
+// time, the render thread everything else; the two never touch the same
+// members, and the results are written after the render thread joined.
+class BenchmarkRecorder
+{
+public:
+    // Windows sized so no sample of the run is dropped
+    void start(size_t frames);
+
+    // Main thread: simulation and command recording
+    void addCpuFrame(double milliseconds);
+
+    // Render thread: full frame interval, the busy part of it, and what
+    // was drawn. GPU culled instances count as one draw and no triangles,
+    // the CPU never learns how many survived.
+    void addRenderFrame(double frameMilliseconds, double renderMilliseconds, size_t drawCalls, size_t triangles);
+
+    // Render thread: take the scope results that arrived this frame
+    void addGpuScopes(const GpuProfiler &profiler);
+
+    bool writeJson(const std::string &path, const BenchmarkOptions &options, const BenchmarkInfo &info) const;
+
+private:
+    struct GpuScopeTimes
+    {
+        std::string mName;
+        RollingStats mTimes;
+        unsigned long long mSeen = 0;
+    };
+
+    size_t mFrames = 0;
+    RollingStats mCpuTimes;
+    RollingStats mFrameTimes;
+    RollingStats mRenderTimes;
+    RollingStats mDrawCalls;
+    RollingStats mTriangles;
+    std::vector<GpuScopeTimes> mGpuScopes;
+};
+
+#endif
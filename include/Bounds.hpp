@@ -0,0 +1,29 @@
+#ifndef BOUNDS_HPP
+#define BOUNDS_HPP
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+// Axis-aligned box plus bounding sphere of the same geometry
+struct Bounds
+{
+    glm::vec3 mMin = glm::vec3(0.0f);
+    glm::vec3 mMax = glm::vec3(0.0f);
+    glm::vec3 mCenter = glm::vec3(0.0f);
+    float mRadius = 0.0f;
+};
+
+// Bounds of positions read every stride floats, starting at positions[0]
+Bounds ComputeBounds(const float *positions, size_t vertexCount, size_t stride);
+
+// Box from a center and half extents, the sphere encloses the box
+Bounds MakeBounds(const glm::vec3 &center, const glm::vec3 &halfExtents);
+
+// Bounds of the box after a transform, the box is refit around the
+// transformed corners so it stays axis aligned
+Bounds TransformBounds(const Bounds &bounds, const glm::mat4 &transform);
+
+Bounds MergeBounds(const Bounds &a, const Bounds &b);
+
+#endif
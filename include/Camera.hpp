@@ -3,12 +3,38 @@
 
 #include <glm/glm.hpp>
 
+#include "Frustum.hpp"
+
+// Keeps a cached view, projection and view-projection, and the frustum
+// planes extracted from it. The movement functions and setProjection()
+// only mark them dirty, they are rebuilt once on the next get call so
+// every pass in a frame shares the same computation.
 class Camera
 {
 public:
     Camera(glm::vec3 eye, glm::vec3 viewDirection, glm::vec3 upVector);
     Camera();
-    glm::mat4 getViewMatrix();
+
+    void setProjection(float fovY, float aspect, float nearPlane, float farPlane);
+    void setAspect(float aspect);
+
+    const glm::mat4 &getViewMatrix();
+    const glm::mat4 &getProjectionMatrix();
+    const glm::mat4 &getViewProjectionMatrix();
+    const Frustum &getFrustum();
+
+    const glm::vec3 &getEye() const { return eye; }
+    const glm::vec3 &getViewDirection() const { return viewDirection; }
+    float getFovY() const { return fovY; }
+    float getNearPlane() const { return nearPlane; }
+    float getFarPlane() const { return farPlane; }
+
+    // Increases every time the view or projection changes
+    unsigned int getVersion() const { return version; }
+
+    // Place the camera directly, e.g. from a recorded path
+    void setView(const glm::vec3 &eye, const glm::vec3 &viewDirection);
+
     void mouseLook(int mouseX, int mouseY);
     void moveForward(float speed);
     void moveBackward(float speed);
@@ -16,11 +42,30 @@ public:
     void moveRight(float speed);
 
 private:
+    void markViewDirty();
+    void markProjectionDirty();
+
     glm::vec3 eye;
     glm::vec3 viewDirection;
     glm::vec3 upVector;
     glm::vec2 oldMousePos;
     glm::vec3 rightVector;
+
+    float fovY = glm::radians(45.0f);
+    float aspect = 4.0f / 3.0f;
+    float nearPlane = 0.1f;
+    float farPlane = 10.0f;
+
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    glm::mat4 viewProjectionMatrix;
+    Frustum frustum;
+
+    bool viewDirty = true;
+    bool projectionDirty = true;
+    bool viewProjectionDirty = true;
+    bool frustumDirty = true;
+    unsigned int version = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
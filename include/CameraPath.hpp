@@ -0,0 +1,46 @@
+#ifndef CAMERAPATH_HPP
+#define CAMERAPATH_HPP
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// Camera keys over frames, recorded from an interactive run or scripted,
+// and played back for benchmarks. Sampling goes by position along the
+// path rather than by time, so a path plays the same for any frame count.
+//
+// Files are text, one key per line: frame, eye xyz, view direction xyz.
+// Lines starting with # are comments.
+class CameraPath
+{
+public:
+    struct Key
+    {
+        float mFrame;
+        glm::vec3 mEye;
+        glm::vec3 mDirection;
+    };
+
+    bool load(const std::string &path);
+    bool save(const std::string &path) const;
+
+    // Keys must be added in frame order
+    void addKey(float frame, const glm::vec3 &eye, const glm::vec3 &direction);
+    void clear() { mKeys.clear(); }
+
+    // Scripted flight over a scene stretching length units down -z from
+    // the origin, ending at the far end looking back
+    void makeFlyover(float length);
+
+    // Eye and direction at t in [0, 1], linear between keys
+    void sample(float t, glm::vec3 &eye, glm::vec3 &direction) const;
+
+    bool empty() const { return mKeys.empty(); }
+    size_t getKeyCount() const { return mKeys.size(); }
+
+private:
+    std::vector<Key> mKeys;
+};
+
+#endif
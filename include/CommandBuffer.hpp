@@ -0,0 +1,109 @@
+#ifndef COMMANDBUFFER_HPP
+#define COMMANDBUFFER_HPP
+
+#include "UniformBlocks.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class RenderBackend;
+class RenderQueue;
+class ShaderProgram;
+class StreamBuffer;
+
+// One indexed draw. Handles and enums are plain values, recording one
+// makes no GL calls. Instances index the buffer's own instance array.
+struct DrawCommand
+{
+    uint64_t mKey = 0;
+    uint32_t mProgram = 0;
+    uint32_t mVertexArray = 0;
+    uint32_t mIndexType = 0;
+    int32_t mIndexCount = 0;
+    uintptr_t mIndexOffset = 0;
+    bool mCullBackFaces = true;
+
+    // Zero instances is a plain draw
+    uint32_t mFirstInstance = 0;
+    int32_t mInstanceCount = 0;
+
+    // Index of the buffer's object data bound as ObjectData, -1 for none
+    int32_t mObject = -1;
+};
+
+// Frame state and uniforms, applied in recording order before any draw
+struct StateCommand
+{
+    enum class Type
+    {
+        Capability,
+        CullFace,
+        FrontFace,
+        Viewport,
+        ClearColor,
+        Clear,
+        UseProgram,
+        UniformVec3,
+        UniformMat4
+    };
+
+    Type mType = Type::Clear;
+    uint32_t mValue = 0;
+    int32_t mInts[4] = {};
+    ShaderProgram *mProgram = nullptr;
+    int mUniform = -1;
+    float mFloats[16] = {};
+};
+
+// Commands recorded on any thread and replayed on the GL thread. Each
+// worker records its own buffer, so recording needs no locking.
+class CommandBuffer
+{
+public:
+    void reset();
+
+    void setCapability(uint32_t capability, bool enabled);
+    void setCullFace(uint32_t face);
+    void setFrontFace(uint32_t mode);
+    void setViewport(int x, int y, int width, int height);
+    void setClearColor(float r, float g, float b, float a);
+    void clear(uint32_t mask);
+
+    void useProgram(ShaderProgram *program);
+    void setUniform(ShaderProgram *program, int uniform, const glm::vec3 &value);
+    void setUniform(ShaderProgram *program, int uniform, const glm::mat4 &value);
+
+    // Space for count model matrices, first receives their index for
+    // DrawCommand::mFirstInstance. Valid until the next allocation.
+    glm::mat4 *allocateInstances(uint32_t count, uint32_t *first);
+
+    // Per-object uniforms, returns the index for DrawCommand::mObject
+    int32_t addObject(const ObjectBlock &object);
+
+    void draw(const DrawCommand &command);
+
+    const std::vector<StateCommand> &getStateCommands() const { return mStateCommands; }
+    const std::vector<DrawCommand> &getDraws() const { return mDraws; }
+    const std::vector<glm::mat4> &getInstances() const { return mInstances; }
+    const std::vector<ObjectBlock> &getObjects() const { return mObjects; }
+
+private:
+    StateCommand &addState(StateCommand::Type type);
+
+    std::vector<StateCommand> mStateCommands;
+    std::vector<DrawCommand> mDraws;
+    std::vector<glm::mat4> mInstances;
+    std::vector<ObjectBlock> mObjects;
+};
+
+// Replay buffers on the GL thread: state commands in buffer order, then
+// every draw through the sorted queue. Instance data is copied into the
+// instance stream buffer and object data into the uniform one, one
+// aligned range per object. Both must be between beginFrame() and
+// endFrame(), and both are committed here.
+void ReplayCommandBuffers(const CommandBuffer *buffers, size_t count, RenderQueue &queue, RenderBackend &backend, StreamBuffer &instances, StreamBuffer &uniforms);
+
+#endif
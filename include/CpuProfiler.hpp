@@ -0,0 +1,95 @@
+#ifndef CPUPROFILER_HPP
+#define CPUPROFILER_HPP
+
+#include <cstdint>
+#include <string>
+
+// Scoped CPU zones, selected at build time with the ENABLE_CPU_PROFILER
+// option.
+//
+// With ENABLE_CPU_PROFILER each thread appends finished zones to its own
+// ring of gCpuProfilerEvents, so recording takes no lock and the newest
+// zones overwrite the oldest. A ring slot is a small seqlock, which lets
+// CpuProfilerWriteTrace() copy the rings while the threads keep going.
+// Traces are Chrome trace_event JSON, for chrome://tracing, Perfetto or
+// Tracy's import-chrome.
+//
+// Without it CpuScope is an empty object and the functions do nothing,
+// no timestamps are taken.
+
+// Zones kept per thread, a power of two
+const uint32_t gCpuProfilerEvents = 1u << 16;
+
+#ifdef ENABLE_CPU_PROFILER
+
+// Nanoseconds since the profiler's epoch, from steady_clock
+uint64_t CpuProfilerNow();
+
+// Append a finished zone to the calling thread's ring. The name must
+// outlive the profiler, zones use string literals.
+void CpuProfilerRecord(const char *name, uint64_t begin, uint64_t end);
+
+// Shown as the thread's name in traces
+void CpuProfilerSetThreadName(const std::string &name);
+
+// Zones of every thread that ended within the last milliseconds, or all
+// zones still in the rings for 0
+bool CpuProfilerWriteTrace(const std::string &path, double lastMilliseconds = 0.0);
+
+inline bool CpuProfilerEnabled()
+{
+    return true;
+}
+
+// Times the enclosing block as one zone
+class CpuScope
+{
+public:
+    explicit CpuScope(const char *name)
+        : mName(name), mBegin(CpuProfilerNow())
+    {
+    }
+
+    ~CpuScope()
+    {
+        CpuProfilerRecord(mName, mBegin, CpuProfilerNow());
+    }
+
+    CpuScope(const CpuScope &) = delete;
+    CpuScope &operator=(const CpuScope &) = delete;
+
+private:
+    const char *mName;
+    uint64_t mBegin;
+};
+
+#else
+
+inline void CpuProfilerSetThreadName(const std::string &)
+{
+}
+
+inline bool CpuProfilerWriteTrace(const std::string &, double = 0.0)
+{
+    return false;
+}
+
+inline bool CpuProfilerEnabled()
+{
+    return false;
+}
+
+class CpuScope
+{
+public:
+    explicit CpuScope(const char *)
+    {
+    }
+
+    CpuScope(const CpuScope &) = delete;
+    CpuScope &operator=(const CpuScope &) = delete;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef FILEWATCHER_HPP
+#define FILEWATCHER_HPP
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(__linux__)
+#include <filesystem>
+#include <map>
+#endif
+
+// Reports files changed in one directory, not recursive. Uses inotify on
+// Linux and polls modification times elsewhere, both on a background
+// thread so checking for changes never touches the file system.
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    bool start(const std::string &directory);
+    void stop();
+
+    // Names, relative to the directory, of files written since the last call
+    void takeChanges(std::vector<std::string> &files);
+
+private:
+    void threadMain();
+    void addChange(const std::string &file);
+
+    std::string mDirectory;
+    std::thread mThread;
+    std::atomic<bool> mStopping{false};
+
+    std::mutex mMutex;
+    std::set<std::string> mChanged;
+
+#if defined(__linux__)
+    int mInotify = -1;
+#else
+    std::map<std::string, std::filesystem::file_time_type> mWriteTimes;
+#endif
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef FIXEDTIMESTEP_HPP
+#define FIXEDTIMESTEP_HPP
+
+// Accumulates frame time and hands it out in whole simulation steps, so
+// the simulation runs at the same rate whatever the frame rate. What is
+// left over is the fraction of a step the frame is between the last two
+// simulated states, for interpolating them.
+class FixedTimestep
+{
+public:
+    // step in seconds. At most maxSteps are run per frame.
+    FixedTimestep(double step, int maxSteps);
+
+    // Add a frame's elapsed seconds and return how many steps are due.
+    // Past maxSteps the rest of the time is dropped, so after a stall the
+    // simulation falls behind once instead of every later frame running
+    // long to catch up.
+    int advance(double elapsed);
+
+    double getStep() const { return mStep; }
+
+    // Fraction of a step accumulated since the last one, in [0, 1)
+    float getAlpha() const { return (float)(mAccumulator / mStep); }
+
+    unsigned long long getStepCount() const { return mStepCount; }
+
+    // Seconds thrown away by the limit
+    double getDroppedTime() const { return mDroppedTime; }
+
+private:
+    double mStep;
+    int mMaxSteps;
+    double mAccumulator = 0.0;
+    unsigned long long mStepCount = 0;
+    double mDroppedTime = 0.0;
+};
+
+#endif
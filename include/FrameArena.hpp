@@ -0,0 +1,88 @@
+#ifndef FRAMEARENA_HPP
+#define FRAMEARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bytes each thread's arena starts with
+const size_t gFrameArenaSize = 256 * 1024;
+
+// Linear allocator for data that lives until the end of the frame.
+// Allocation bumps an offset, reset() drops everything at once and no
+// destructors run, so only trivially destructible types belong here.
+//
+// When a frame needs more than the arena holds, the rest comes from heap
+// blocks that reset() frees, and the arena grows to the frame's peak so
+// the next frames fit again. In steady state a frame never touches the
+// heap.
+class FrameArena
+{
+public:
+    FrameArena();
+    ~FrameArena();
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    void create(size_t capacity);
+    void destroy();
+
+    void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // Uninitialized storage for count objects
+    template <typename T>
+    T *allocateArray(size_t count)
+    {
+        return (T *)allocate(sizeof(T) * count, alignof(T));
+    }
+
+    // Start the next frame. Memory from before is invalid afterwards.
+    void reset();
+
+    size_t getCapacity() const { return mCapacity; }
+    size_t getUsed() const { return mUsed + mOverflowUsed; }
+
+    // Most bytes one frame used so far
+    size_t getPeak() const { return mPeak; }
+
+    // Frames that needed heap blocks
+    unsigned long long getOverflowCount() const { return mOverflowCount; }
+
+private:
+    std::unique_ptr<unsigned char[]> mMemory;
+    size_t mCapacity = 0;
+    size_t mUsed = 0;
+
+    std::vector<std::unique_ptr<unsigned char[]>> mOverflow;
+    size_t mOverflowUsed = 0;
+
+    size_t mPeak = 0;
+    unsigned long long mOverflowCount = 0;
+};
+
+// One arena per job system thread, so jobs allocate without sharing
+class FrameArenas
+{
+public:
+    void create(size_t threadCount, size_t capacity);
+    void destroy();
+
+    // thread is the job system index of the calling thread
+    FrameArena &get(size_t thread) { return *mArenas[thread]; }
+
+    // Call at the top of the frame, while no job uses its arena
+    void reset();
+
+    size_t getThreadCount() const { return mArenas.size(); }
+
+    // Sums over the threads, the peak is each arena's own peak
+    size_t getCapacity() const;
+    size_t getPeak() const;
+    unsigned long long getOverflowCount() const;
+
+private:
+    std::vector<std::unique_ptr<FrameArena>> mArenas;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef FRAMEPACER_HPP
+#define FRAMEPACER_HPP
+
+#include "RollingStats.hpp"
+
+#include <chrono>
+#include <iosfwd>
+
+// Controls how long each frame lasts and keeps frame-time statistics.
+//  VSync          swap interval 1, the driver blocks in SDL_GL_SwapWindow
+//  AdaptiveVSync  swap interval -1, late frames tear instead of waiting
+//  Limited        no vsync, sleep then spin until the target frame time
+//  Uncapped       no vsync and no waiting, for benchmarking
+class FramePacer
+{
+public:
+    enum class Mode
+    {
+        VSync,
+        AdaptiveVSync,
+        Limited,
+        Uncapped
+    };
+
+    FramePacer();
+
+    // Needs a current GL context for the swap interval
+    void initialize(Mode mode, double targetFPS);
+    void setMode(Mode mode);
+    Mode getMode() const { return mMode; }
+
+    // Switch to the next mode in the list above
+    void cycleMode();
+
+    // Also ends the previous frame, whose full interval runs from its
+    // beginFrame() to this one and so includes any wait for work
+    void beginFrame();
+
+    // Call after the swap, records the work time and waits in Limited mode
+    void endFrame();
+
+    // Frame budget in milliseconds
+    double getFrameBudget() const { return mFrameBudget; }
+
+    // Full frame interval and the busy part before any limiter wait. A
+    // frame's interval is only known once the next frame has begun.
+    const RollingStats &getFrameTimes() const { return mFrameTimes; }
+    const RollingStats &getWorkTimes() const { return mWorkTimes; }
+    unsigned long long getFramesOverBudget() const { return mFramesOverBudget; }
+
+    void printReport(std::ostream &out) const;
+
+    static const char *getModeName(Mode mode);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void waitUntil(Clock::time_point deadline);
+
+    Mode mMode = Mode::Limited;
+    double mTargetFPS = 60.0;
+    double mFrameBudget = 1000.0 / 60.0;
+    Clock::duration mFramePeriod;
+
+    Clock::time_point mFrameStart;
+    bool mHasFrameStart = false;
+    Clock::time_point mDeadline;
+    bool mHasDeadline = false;
+
+    RollingStats mFrameTimes;
+    RollingStats mWorkTimes;
+    unsigned long long mFramesOverBudget = 0;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+// View frustum as six planes (xyz normal pointing inwards, w distance),
+// a point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0
+struct Frustum
+{
+    enum Plane
+    {
+        Left,
+        Right,
+        Bottom,
+        Top,
+        Near,
+        Far,
+        PlaneCount
+    };
+
+    glm::vec4 mPlanes[PlaneCount];
+};
+
+// Gribb/Hartmann extraction from a GL style (-w..w depth) view projection
+Frustum ExtractFrustum(const glm::mat4 &viewProjection);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef GLDEBUG_HPP
+#define GLDEBUG_HPP
+
+#include <glad/glad.h>
+
+// Error checking, selected at build time with the ENABLE_GL_DEBUG option.
+//
+// With ENABLE_GL_DEBUG the context is created with the debug flag and, when
+// GL_KHR_debug is available, errors are reported by glDebugMessageCallback
+// as they happen. GLCheck only falls back to polling glGetError when the
+// callback couldn't be installed.
+//
+// Without it GLCheck(x) is just x, no glGetError calls are compiled in.
+
+#ifdef ENABLE_GL_DEBUG
+
+// Install the debug callback, needs a current context. Returns true when
+// the callback is active and GLCheck can skip glGetError.
+bool InitializeGLDebug();
+
+extern bool gGLDebugCallbackActive;
+
+void GLClearError();
+bool GLCheckError(const char *function, const char *file, int line);
+
+// One statement, so GLCheck(x); is safe as the body of an unbraced if
+#define GLCheck(x)                                \
+    do                                            \
+    {                                             \
+        if (!gGLDebugCallbackActive)              \
+            GLClearError();                       \
+        x;                                        \
+        if (!gGLDebugCallbackActive)              \
+            GLCheckError(#x, __FILE__, __LINE__); \
+    } while (0)
+
+#else
+
+inline bool InitializeGLDebug()
+{
+    return false;
+}
+
+#define GLCheck(x) \
+    do             \
+    {              \
+        x;         \
+    } while (0)
+
+#endif
+
+#endif
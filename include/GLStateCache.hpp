@@ -0,0 +1,82 @@
+#ifndef GLSTATECACHE_HPP
+#define GLSTATECACHE_HPP
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Shadow copy of the GL state the renderer changes. Setters only reach GL
+// when the value differs from the last one set. Code that changes this
+// state behind the cache's back must call invalidate() afterwards.
+class GLStateCache
+{
+public:
+    // Forget everything, the next call of every setter reaches GL
+    void invalidate();
+
+    // Only the binding, after code that binds VAOs directly
+    void invalidateVertexArray() { mVertexArrayKnown = false; }
+
+    void setEnabled(GLenum capability, bool enabled);
+    void setCullFace(GLenum face);
+    void setFrontFace(GLenum mode);
+    void setDepthFunc(GLenum func);
+    void setDepthMask(bool write);
+    void setColorMask(bool write);
+    void setViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    void setClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+
+    // Calls that reached GL and calls skipped as redundant, since the last reset
+    size_t getCallCount() const { return mCalls; }
+    size_t getSkippedCount() const { return mSkipped; }
+    void resetCounters();
+
+private:
+    // Changed when the value differs or isn't known, counts either way
+    template <typename T>
+    bool change(T &current, bool &known, const T &value);
+
+    enum Capability
+    {
+        DepthTest,
+        CullFace,
+        Blend,
+        ScissorTest,
+        PolygonOffsetFill,
+        CapabilityCount
+    };
+
+    static int getCapabilityIndex(GLenum capability);
+
+    bool mEnabled[CapabilityCount] = {};
+    bool mEnabledKnown[CapabilityCount] = {};
+
+    GLenum mCullFace = GL_BACK;
+    bool mCullFaceKnown = false;
+    GLenum mFrontFace = GL_CCW;
+    bool mFrontFaceKnown = false;
+    GLenum mDepthFunc = GL_LESS;
+    bool mDepthFuncKnown = false;
+    bool mDepthMask = true;
+    bool mDepthMaskKnown = false;
+    bool mColorMask = true;
+    bool mColorMaskKnown = false;
+
+    GLint mViewport[4] = {};
+    bool mViewportKnown = false;
+    GLfloat mClearColor[4] = {};
+    bool mClearColorKnown = false;
+
+    GLuint mProgram = 0;
+    bool mProgramKnown = false;
+    GLuint mVertexArray = 0;
+    bool mVertexArrayKnown = false;
+
+    size_t mCalls = 0;
+    size_t mSkipped = 0;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef GPUCULLER_HPP
+#define GPUCULLER_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Mesh3D.hpp"
+#include "MeshArena.hpp"
+
+#include <string>
+
+class GLStateCache;
+
+// Texture unit the depth pyramid is sampled from
+const GLuint gHiZTextureUnit = 1;
+
+struct GpuCullSources
+{
+    std::string mCullVertex;
+    std::string mCullGeometry;
+    std::string mHiZVertex;
+    std::string mHiZFragment;
+};
+
+// Frustum and occlusion culling of instances on the GPU, without reading
+// anything back. A transform feedback pass with the rasterizer off tests
+// one point per instance against the frustum and against a max depth
+// pyramid (Hi-Z) of the previous frame, then writes the visible model
+// matrices into a buffer the instanced draw reads. The draw arguments
+// are in an indirect buffer.
+//
+// With ARB_query_buffer_object a geometry shader drops the culled
+// instances, and the primitives-written query is copied on the GPU into
+// the indirect instance count. Without it, as on plain 4.1, every
+// instance is written and culled ones collapse to a zero matrix, so they
+// cost vertex work but no fragments.
+class GpuCuller
+{
+public:
+    GpuCuller();
+    ~GpuCuller();
+
+    GpuCuller(const GpuCuller &) = delete;
+    GpuCuller &operator=(const GpuCuller &) = delete;
+
+    // Pyramid sized for the output, frames drawn at a lower resolution
+    // are stretched to it
+    void create(const GpuCullSources &sources, int width, int height);
+    void destroy();
+
+    // Reallocates the pyramid only when the size changed. The next cull
+    // skips the occlusion test.
+    void resize(int width, int height);
+
+    // Test count instances of mesh, whose model matrices are in models.
+    // The state cache is kept in sync with the bindings changed here.
+    void cull(GLStateCache &state, const Mesh3D &mesh, const glm::mat4 *models, GLsizei count, const glm::mat4 &viewProjection);
+
+    // Draw the visible instances with the bound program
+    void draw(GLStateCache &state, const Mesh3D &mesh) const;
+
+    // Rebuild the pyramid from the depth of framebuffer, 0 for the
+    // default one, after the frame was drawn and before the swap. The
+    // frame covers width by height pixels from the corner, which is the
+    // viewport left behind. The framebuffer is bound again afterwards.
+    // viewProjection is the camera the depth was drawn with.
+    void buildHiZ(GLStateCache &state, GLuint framebuffer, int width, int height, const glm::mat4 &viewProjection);
+
+    // The next cull skips the occlusion test, e.g. after a frame without one
+    void invalidateHiZ() { mHiZValid = false; }
+
+    bool compacts() const { return mCompact; }
+
+private:
+    GLuint linkCullProgram(const std::string &vertexSource, const std::string &geometrySource) const;
+    void reserve(GLsizei count);
+    void createPyramid(int width, int height);
+    void destroyPyramid();
+
+    bool mCompact = false;
+
+    GLuint mCullProgram = 0;
+    GLint mFrustumPlanesUniform = -1;
+    GLint mMeshSphereUniform = -1;
+    GLint mUseHiZUniform = -1;
+    GLint mHiZSizeUniform = -1;
+    GLint mHiZLevelsUniform = -1;
+    GLint mPreviousViewProjectionUniform = -1;
+
+    // Input models, one point each, and the visible models written back
+    GLuint mCullVertexArray = 0;
+    GLuint mInputBuffer = 0;
+    GLuint mCulledBuffer = 0;
+    GLsizei mCapacity = 0;
+    GLuint mIndirectBuffer = 0;
+    GLuint mWrittenQuery = 0;
+
+    // Depth copy and max depth pyramid, R32F
+    int mWidth = 0;
+    int mHeight = 0;
+    int mHiZLevels = 0;
+    GLuint mDepthTexture = 0;
+    GLuint mDepthFramebuffer = 0;
+    GLuint mHiZTexture = 0;
+    GLuint mHiZFramebuffer = 0;
+    GLuint mHiZProgram = 0;
+    GLint mHiZReduceUniform = -1;
+    GLuint mEmptyVertexArray = 0;
+
+    bool mHiZValid = false;
+    glm::mat4 mHiZViewProjection = glm::mat4(1.0f);
+};
+
+#endif
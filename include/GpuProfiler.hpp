@@ -0,0 +1,108 @@
+#ifndef GPUPROFILER_HPP
+#define GPUPROFILER_HPP
+
+#include "RollingStats.hpp"
+
+#include <glad/glad.h>
+
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Frames of queries in flight. Results are read back this many frames
+// late and only when GL_QUERY_RESULT_AVAILABLE says so, never stalling.
+const int gGpuProfilerFrames = 3;
+
+// GPU timings per named scope from GL_TIMESTAMP queries.
+// Timestamps rather than GL_TIME_ELAPSED so scopes can nest and overlap.
+class GpuProfiler
+{
+public:
+    struct Scope
+    {
+        std::string name;
+        RollingStats times;
+    };
+
+    GpuProfiler();
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler &) = delete;
+    GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+    void initialize();
+    void destroy();
+
+    // Collects the oldest frame's results and starts recording a new frame
+    void beginFrame();
+    void endFrame();
+
+    int beginScope(const char *name);
+    void endScope(int marker);
+
+    const std::vector<Scope> &getScopes() const { return mScopes; }
+
+    // nullptr until the scope was first used
+    const RollingStats *getScopeTimes(const char *name) const;
+
+    // Frames whose results weren't ready yet and were dropped
+    unsigned long long getDroppedFrames() const { return mDroppedFrames; }
+
+    void printReport(std::ostream &out) const;
+
+    // One line per scope, e.g. "PreDraw 0.12 ms, Draw 1.40 ms"
+    std::string getSummary() const;
+
+    bool writeCsv(const std::string &path) const;
+
+private:
+    struct Marker
+    {
+        int scope;
+        GLuint beginQuery;
+        GLuint endQuery;
+    };
+
+    struct Frame
+    {
+        std::vector<GLuint> queries;
+        size_t usedQueries = 0;
+        std::vector<Marker> markers;
+    };
+
+    GLuint acquireQuery(Frame &frame);
+    void collect(Frame &frame);
+    int findScope(const char *name);
+
+    bool mInitialized = false;
+    int mFrameIndex = 0;
+    Frame mFrames[gGpuProfilerFrames];
+    std::vector<Scope> mScopes;
+    std::unordered_map<std::string, int> mScopeTable;
+    unsigned long long mDroppedFrames = 0;
+};
+
+// Times everything issued between construction and destruction
+class GpuScope
+{
+public:
+    GpuScope(GpuProfiler &profiler, const char *name)
+        : mProfiler(profiler), mMarker(profiler.beginScope(name))
+    {
+    }
+
+    ~GpuScope()
+    {
+        mProfiler.endScope(mMarker);
+    }
+
+    GpuScope(const GpuScope &) = delete;
+    GpuScope &operator=(const GpuScope &) = delete;
+
+private:
+    GpuProfiler &mProfiler;
+    int mMarker;
+};
+
+#endif
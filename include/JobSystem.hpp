@@ -0,0 +1,169 @@
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Jobs each thread can have in flight, a power of two. Job storage is a
+// ring per thread. When it wraps onto a job that hasn't finished,
+// create() runs other jobs until that one has.
+const size_t gJobCapacity = 4096;
+
+// Bytes of arguments copied into a job
+const size_t gJobDataSize = 96;
+
+struct Job;
+typedef void (*JobFunction)(Job *job, const void *data);
+
+// Counts unfinished jobs. run() adds one, and a job counts as finished
+// when it and every child created under it have returned.
+struct JobCounter
+{
+    std::atomic<int> mValue{0};
+
+    bool isDone() const { return mValue.load(std::memory_order_acquire) == 0; }
+};
+
+struct alignas(64) Job
+{
+    JobFunction mFunction = nullptr;
+    Job *mParent = nullptr;
+    JobCounter *mCounter = nullptr;
+
+    // The job itself plus its unfinished children
+    std::atomic<int> mUnfinished{0};
+
+    unsigned char mData[gJobDataSize];
+};
+
+// Chase-Lev work-stealing deque (Le et al. 2013). The owning thread
+// pushes and pops at the bottom, other threads steal from the top.
+class JobDeque
+{
+public:
+    bool push(Job *job);
+    Job *pop();
+    Job *steal();
+
+private:
+    std::atomic<int64_t> mTop{0};
+    std::atomic<int64_t> mBottom{0};
+    std::atomic<Job *> mJobs[gJobCapacity];
+};
+
+// Fixed pool of worker threads with a deque each. The thread that calls
+// start() becomes thread 0 and takes part in wait(). Other threads may
+// create and run jobs too, they go through a shared locked queue.
+class JobSystem
+{
+public:
+    JobSystem();
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // Zero picks one worker per core, minus the caller and the GL thread
+    void start(size_t workerCount = 0);
+    void stop();
+
+    // Job storage from the calling thread's ring, no heap allocation.
+    // size bytes of data are copied into the job. A parent only finishes
+    // once the children created under it have.
+    Job *create(JobFunction function, const void *data, size_t size, Job *parent = nullptr);
+
+    template <typename T>
+    Job *create(JobFunction function, const T &data, Job *parent = nullptr)
+    {
+        static_assert(sizeof(T) <= gJobDataSize, "Job data too large");
+        return create(function, &data, sizeof(T), parent);
+    }
+
+    void run(Job *job, JobCounter *counter = nullptr);
+
+    // Run other jobs until the counter reaches zero
+    void wait(JobCounter &counter);
+
+    // Call function(begin, end) on ranges of at most grain items covering
+    // [0, count) and wait for all of them. The grain is raised when needed
+    // to keep the ranges to half the job ring. The function isn't copied.
+    template <typename F>
+    void parallelFor(size_t count, size_t grain, const F &function);
+
+    // Workers plus the thread that called start()
+    size_t getThreadCount() const { return mDeques.size(); }
+
+    // Index of the calling thread in [0, getThreadCount()), 0 for the
+    // thread that called start(). Only meaningful on the system's threads.
+    size_t getThreadIndex() const;
+
+private:
+    struct ThreadState;
+
+    void workerMain(size_t index);
+    Job *findJob();
+    void execute(Job *job);
+    void finish(Job *job);
+    ThreadState *getThreadState();
+
+    template <typename F>
+    struct RangeData
+    {
+        const F *mFunction;
+        size_t mBegin;
+        size_t mEnd;
+    };
+
+    template <typename F>
+    static void runRange(Job *, const void *data)
+    {
+        const RangeData<F> *range = (const RangeData<F> *)data;
+        (*range->mFunction)(range->mBegin, range->mEnd);
+    }
+
+    std::vector<JobDeque *> mDeques;
+    std::vector<ThreadState *> mThreadStates;
+    std::vector<std::thread> mThreads;
+    std::atomic<bool> mStopping{false};
+
+    // Jobs from threads the system doesn't own, and their storage
+    std::mutex mExternalMutex;
+    std::vector<Job *> mExternalJobs;
+    std::atomic<size_t> mExternalCount{0};
+    ThreadState *mExternalState = nullptr;
+
+    // Idle workers sleep until jobs are queued
+    std::atomic<int> mQueued{0};
+    std::atomic<int> mSleeping{0};
+    std::mutex mSleepMutex;
+    std::condition_variable mWake;
+};
+
+template <typename F>
+void JobSystem::parallelFor(size_t count, size_t grain, const F &function)
+{
+    JobCounter counter;
+    grain = grain > 0 ? grain : 1;
+
+    // A call never fills the ring with its own jobs
+    const size_t maxRanges = gJobCapacity / 2;
+    if ((count + grain - 1) / grain > maxRanges)
+    {
+        grain = (count + maxRanges - 1) / maxRanges;
+    }
+
+    for (size_t begin = 0; begin < count; begin += grain)
+    {
+        RangeData<F> range = {&function, begin, begin + grain < count ? begin + grain : count};
+        run(create(&JobSystem::runRange<F>, range), &counter);
+    }
+    wait(counter);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. Pages are paged in by the OS
+// on first touch and are file backed, so mapping a large asset doesn't
+// commit its size in private memory.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    const unsigned char *getData() const { return mData; }
+    size_t getSize() const { return mSize; }
+    bool isOpen() const { return mData != nullptr; }
+
+    // Tell the OS the range will be read sequentially soon
+    void prefetch(size_t offset, size_t size) const;
+
+private:
+    const unsigned char *mData = nullptr;
+    size_t mSize = 0;
+
+#ifdef _WIN32
+    void *mFile = nullptr;
+    void *mMapping = nullptr;
+#else
+    int mFile = -1;
+#endif
+};
+
+#endif
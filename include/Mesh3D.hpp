@@ -0,0 +1,69 @@
+#ifndef MESH3D_HPP
+#define MESH3D_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Bounds.hpp"
+#include "MeshFormat.hpp"
+#include "MeshSimplifier.hpp"
+
+#include <cstdint>
+
+// First attribute location used by the per-instance model matrix,
+// a mat4 takes four consecutive locations (2, 3, 4 and 5)
+const GLuint gInstanceAttributeLocation = 2;
+
+struct Mesh3D
+{
+    // VAO, VBO, and IBO
+    GLuint mVertexArrayObject = 0;
+    GLuint mVertexBufferObject = 0;
+    GLuint mIndexBufferObject = 0;
+    GLsizei mIndexCount = 0;
+    GLenum mIndexType = GL_UNSIGNED_INT;
+
+    // Index ranges per level of detail, without any the whole IBO is LOD 0
+    MeshLod mLods[gMeshMaxLods];
+    uint32_t mLodCount = 0;
+
+    // Local space bounds of the vertex positions
+    Bounds mBounds;
+
+    // Maps fetched positions to model space, for quantized layouts
+    glm::vec3 mPositionScale = glm::vec3(1.0f);
+    glm::vec3 mPositionOffset = glm::vec3(0.0f);
+
+    // Per-instance model matrices, read from an external buffer
+    GLsizei mInstanceCount = 0;
+};
+
+// Describe the interleaved vertex buffer to the mesh VAO, the VAO and
+// VBO are bound and unbound by the call
+void SetVertexAttributes(Mesh3D *mesh, const VertexAttribute *attributes, uint32_t count, GLsizei stride);
+
+// Point the instance attributes of the bound VAO at offset in the bound
+// array buffer, for code that manages its own bindings
+void SetInstanceAttributes(GLintptr offset);
+
+// Read this frame's model matrices from an external buffer, e.g. a
+// region of a StreamBuffer. The mesh doesn't own that buffer.
+void SetInstanceSource(Mesh3D *mesh, GLuint buffer, GLintptr offset, GLsizei count);
+
+// Index count and byte offset of a LOD in the IBO
+void GetMeshLodRange(const Mesh3D &mesh, uint32_t lod, GLsizei *count, uintptr_t *offset);
+
+// Coarsest LOD whose error projects to at most maxPixelError pixels.
+// pixelsPerUnit is the projected size of one unit at distance one,
+// viewport height / (2 tan(fovY / 2)).
+uint32_t SelectMeshLod(const Mesh3D &mesh, float distance, float pixelsPerUnit, float maxPixelError);
+
+// Draw the mesh once with the bound uniforms
+void DrawMesh(const Mesh3D &mesh, uint32_t lod = 0);
+
+// Draw every instance in the instance buffer with one call
+void DrawMeshInstanced(const Mesh3D &mesh, uint32_t lod = 0);
+
+void DestroyMesh(Mesh3D *mesh);
+
+#endif
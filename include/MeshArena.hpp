@@ -0,0 +1,102 @@
+#ifndef MESHARENA_HPP
+#define MESHARENA_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Mesh3D.hpp"
+#include "VertexLayout.hpp"
+
+#include <cstdint>
+#include <vector>
+
+class GLStateCache;
+
+// Attribute location of the per-draw index, read once per instance
+const GLuint gDrawIdAttributeLocation = 7;
+
+// Texture unit of the per-draw data buffer
+const GLuint gDrawDataTextureUnit = 0;
+
+// Layout of glMultiDrawElementsIndirect and glDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint mCount;
+    GLuint mInstanceCount;
+    GLuint mFirstIndex;
+    GLint mBaseVertex;
+    GLuint mBaseInstance;
+};
+
+// Static meshes merged into one vertex and one index buffer, so many
+// distinct meshes draw from one VAO. Each draw is one indirect command.
+// Its model matrix, with the mesh's position dequantization folded in,
+// is in a buffer texture the vertex shader reads by draw ID.
+//
+// With ARB_multi_draw_indirect the whole arena is one call and the draw
+// ID comes from an instanced attribute offset by mBaseInstance. On plain
+// 4.1, which has no base instance, each draw sets the attribute's current
+// value instead and is drawn with glDrawElementsBaseVertex.
+class MeshArena
+{
+public:
+    MeshArena();
+    ~MeshArena();
+
+    MeshArena(const MeshArena &) = delete;
+    MeshArena &operator=(const MeshArena &) = delete;
+
+    // Every mesh is packed with this layout
+    void initialize(const VertexLayout &layout);
+
+    // Append packed vertices and 32-bit indices local to the mesh.
+    // Returns the mesh index for addDraw().
+    uint32_t addMesh(const unsigned char *vertices, uint32_t vertexCount, const uint32_t *indices, uint32_t indexCount,
+                     const glm::vec3 &positionScale, const glm::vec3 &positionOffset);
+
+    void addDraw(uint32_t mesh, const glm::mat4 &model);
+
+    // Create the GL buffers and drop the CPU copies. Call once, after
+    // the meshes and draws were added.
+    void upload();
+
+    // Draw everything with the bound program, which samples the draw
+    // data from gDrawDataTextureUnit. Returns the number of GL draw calls.
+    size_t draw(GLStateCache &state) const;
+
+    void destroy();
+
+    bool usesMultiDraw() const { return mUseMultiDraw; }
+    size_t getMeshCount() const { return mMeshes.size(); }
+    size_t getDrawCount() const { return mCommands.size(); }
+    size_t getTriangleCount() const { return mTriangleCount; }
+
+private:
+    struct Range
+    {
+        GLuint mFirstIndex;
+        GLuint mIndexCount;
+        GLint mBaseVertex;
+        glm::mat4 mDequantize;
+    };
+
+    VertexLayout mLayout = {};
+    std::vector<unsigned char> mVertices;
+    std::vector<uint32_t> mIndices;
+    uint32_t mVertexCount = 0;
+
+    std::vector<Range> mMeshes;
+    std::vector<DrawElementsIndirectCommand> mCommands;
+    std::vector<glm::mat4> mDrawData;
+    size_t mTriangleCount = 0;
+
+    // VAO, merged VBO and IBO
+    Mesh3D mMesh;
+    GLuint mDrawIdBuffer = 0;
+    GLuint mIndirectBuffer = 0;
+    GLuint mDrawDataBuffer = 0;
+    GLuint mDrawDataTexture = 0;
+    bool mUseMultiDraw = false;
+};
+
+#endif
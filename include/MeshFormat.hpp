@@ -0,0 +1,91 @@
+#ifndef MESHFORMAT_HPP
+#define MESHFORMAT_HPP
+
+#include "MeshSimplifier.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Binary mesh file (.mesh), little endian:
+//   MeshFileHeader
+//   interleaved vertex data at mVertexDataOffset
+//   index data at mIndexDataOffset, 16 or 32 bit, LOD 0 first and then
+//   the simplified levels listed in mLods
+// Both data blocks are 16 byte aligned so they can be copied straight
+// from a memory mapping into GL buffers.
+
+const uint32_t gMeshFileMagic = 0x48534D4F; // "OMSH"
+const uint32_t gMeshFileVersion = 2;
+const uint32_t gMeshMaxAttributes = 8;
+const uint64_t gMeshDataAlignment = 16;
+
+// Attribute locations a file may use, every GL 4.1 context supports
+// at least this many
+const uint32_t gMeshMaxAttributeLocation = 16;
+
+// One vertex attribute, types and normalization use the GL enums so the
+// description goes straight to glVertexAttribPointer
+struct VertexAttribute
+{
+    uint32_t mLocation;
+    uint32_t mComponents;
+    uint32_t mType;
+    uint32_t mNormalized;
+    uint32_t mOffset;
+};
+
+// One level of detail, a range of the index data in indices
+struct MeshFileLod
+{
+    uint32_t mIndexOffset;
+    uint32_t mIndexCount;
+    float mError;
+};
+
+struct MeshFileHeader
+{
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mVertexCount;
+    uint32_t mIndexCount;
+    uint32_t mVertexStride;
+    uint32_t mIndexType;
+    uint32_t mAttributeCount;
+    uint32_t mLodCount;
+    VertexAttribute mAttributes[gMeshMaxAttributes];
+
+    // Precomputed local bounds, box and sphere
+    float mBoundsMin[3];
+    float mBoundsMax[3];
+    float mBoundsCenter[3];
+    float mBoundsRadius;
+
+    uint64_t mVertexDataOffset;
+    uint64_t mIndexDataOffset;
+
+    // Without any, the whole index data is LOD 0
+    MeshFileLod mLods[gMeshMaxLods];
+};
+
+static_assert(sizeof(VertexAttribute) == 20, "VertexAttribute must match the file layout");
+static_assert(sizeof(MeshFileLod) == 12, "MeshFileLod must match the file layout");
+static_assert(sizeof(MeshFileHeader) == 296, "MeshFileHeader must match the file layout");
+
+size_t GetIndexSize(uint32_t indexType);
+uint64_t GetVertexDataSize(const MeshFileHeader &header);
+uint64_t GetIndexDataSize(const MeshFileHeader &header);
+
+// Bytes one vertex of the attribute takes, 0 for an unknown type or a
+// component count the type doesn't allow
+uint32_t GetAttributeSize(const VertexAttribute &attribute);
+
+// Checks magic, version, that every attribute has a known type, is
+// aligned and lies inside the stride, and that both data blocks are
+// aligned and fit in the file, and that every LOD lies in the indices
+bool ValidateMeshHeader(const MeshFileHeader &header, size_t fileSize);
+
+// Fills in magic, version and data offsets from the counts in header
+bool WriteMeshFile(const std::string &path, MeshFileHeader header, const void *vertices, const void *indices);
+
+#endif
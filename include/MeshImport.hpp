@@ -0,0 +1,44 @@
+#ifndef MESHIMPORT_HPP
+#define MESHIMPORT_HPP
+
+#include "Bounds.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "VertexLayout.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The offline half of the mesh pipeline. Source vertices are optimized
+// and packed here, then uploaded directly or written to a .mesh file.
+// MeshLoader copies files into GL buffers as they are, so a mesh is
+// only reordered on import.
+
+// A mesh in the layout and order it is drawn with
+struct ImportedMesh
+{
+    VertexLayout mLayout;
+    std::vector<unsigned char> mVertices;
+    std::vector<uint32_t> mIndices;
+    size_t mVertexCount = 0;
+    Bounds mBounds;
+    MeshOptimizeStats mStats;
+
+    // Simplified levels follow LOD 0 in mIndices
+    MeshLod mLods[gMeshMaxLods];
+    uint32_t mLodCount = 0;
+};
+
+// vertices holds strideFloats floats per vertex: a position, a color
+// from float 3 and, when the format has normals, a normal from float 6.
+// Runs OptimizeMesh, builds the LOD chain and packs the result, vertices
+// and indices are reordered in place.
+void ImportMesh(const VertexFormat &format, std::vector<float> &vertices, size_t strideFloats, std::vector<uint32_t> &indices, ImportedMesh &mesh);
+
+// Write an imported mesh and its LODs as a .mesh file, with 16 bit
+// indices when every vertex can be addressed by them
+bool WriteImportedMesh(const std::string &path, const ImportedMesh &mesh);
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef MESHLOADER_HPP
+#define MESHLOADER_HPP
+
+#include "JobSystem.hpp"
+#include "MappedFile.hpp"
+#include "Mesh3D.hpp"
+#include "MeshFormat.hpp"
+#include "ObjectPool.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Loads .mesh files without blocking the render thread.
+//
+// A job memory-maps and validates the file. The GL thread then creates
+// the buffers and maps them, jobs copy the vertex and index blocks in
+// slices straight from the file mapping into the GL mappings, and the GL
+// thread unmaps them and sets up the VAO. Data is never held in a heap
+// copy, so peak memory stays at the size of the GL buffers.
+class MeshLoader
+{
+public:
+    typedef uint32_t Request;
+
+    enum class State
+    {
+        Queued,
+        WaitingForBuffers,
+        Copying,
+        Uploading,
+        Ready,
+        Failed,
+        Unknown
+    };
+
+    MeshLoader();
+    ~MeshLoader();
+
+    MeshLoader(const MeshLoader &) = delete;
+    MeshLoader &operator=(const MeshLoader &) = delete;
+
+    // Work runs on the job system, which must outlive stop()
+    void start(JobSystem &jobSystem);
+    void stop();
+
+    Request load(const std::string &path);
+
+    // Call once a frame on the GL thread. Returns true when it made GL
+    // calls, which leave the VAO and buffer bindings at 0.
+    bool update();
+
+    State getState(Request request) const;
+
+    // Move a Ready mesh out of the loader, the caller owns its GL objects
+    bool takeMesh(Request request, Mesh3D *mesh);
+
+private:
+    struct Asset
+    {
+        Request request = 0;
+        std::string path;
+        State state = State::Queued;
+        MappedFile file;
+        MeshFileHeader header = {};
+        void *vertexDestination = nullptr;
+        void *indexDestination = nullptr;
+        Mesh3D mesh;
+
+        // Copy slices still running, the last one moves on to Uploading
+        std::atomic<uint32_t> chunksLeft{0};
+    };
+
+    // Arguments of the loader's jobs
+    struct AssetJob
+    {
+        MeshLoader *loader;
+        Asset *asset;
+        uint64_t offset;
+    };
+
+    static void mapFileJob(Job *job, const void *data);
+    static void copyChunkJob(Job *job, const void *data);
+
+    void mapFile(Asset &asset);
+    void queueCopy(Asset &asset);
+    void copyChunk(Asset &asset, uint64_t offset);
+    void createBuffers(Asset &asset);
+    void finishUpload(Asset &asset);
+    Asset *findAsset(Request request) const;
+
+    mutable std::mutex mMutex;
+    bool mStopping = false;
+
+    JobSystem *mJobSystem = nullptr;
+    JobCounter mPending;
+
+    // Jobs hold Asset pointers, the pool keeps them stable
+    ObjectPool<Asset, 16> mAssetPool;
+    std::vector<Asset *> mAssets;
+    Request mNextRequest = 1;
+
+    // Reused by update() so polling never allocates
+    std::vector<Asset *> mNeedBuffers;
+    std::vector<Asset *> mNeedFinish;
+};
+
+#endif
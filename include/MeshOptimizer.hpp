@@ -0,0 +1,47 @@
+#ifndef MESHOPTIMIZER_HPP
+#define MESHOPTIMIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Post-transform vertex cache size assumed by the reordering and ACMR
+const size_t gVertexCacheSize = 16;
+
+// Overdraw reordering may raise the ACMR by up to this factor
+const float gOverdrawThreshold = 1.05f;
+
+struct MeshOptimizeStats
+{
+    size_t mVerticesBefore = 0;
+    size_t mVerticesAfter = 0;
+    float mAcmrBefore = 0.0f;
+    float mAcmrAfter = 0.0f;
+};
+
+// Average cache miss ratio, vertex shader runs per triangle through a
+// FIFO cache. 3 is the worst case, about 0.5 to 0.7 is good for grids.
+float ComputeACMR(const uint32_t *indices, size_t indexCount, size_t vertexCount, size_t cacheSize = gVertexCacheSize);
+
+// Merge vertices with identical bytes. Fills remap with the new index of
+// every vertex and returns the number of unique vertices.
+size_t WeldVertices(const void *vertices, size_t vertexCount, size_t stride, std::vector<uint32_t> &remap);
+
+// Tipsify (Sander et al. 2007), reorders triangles for the vertex cache
+void OptimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount, size_t cacheSize = gVertexCacheSize);
+
+// Split the cache-optimized order into clusters and sort them so outward
+// facing clusters draw first, keeping the ACMR within threshold. Positions
+// are read every stride floats.
+void OptimizeOverdraw(uint32_t *indices, size_t indexCount, const float *positions, size_t vertexCount, size_t stride,
+                      float threshold = gOverdrawThreshold, size_t cacheSize = gVertexCacheSize);
+
+// Reorder vertices in first use order and rewrite the indices, unused
+// vertices are dropped. Returns the new vertex count.
+size_t OptimizeVertexFetch(uint32_t *indices, size_t indexCount, void *vertices, size_t vertexCount, size_t stride);
+
+// The whole import pipeline on interleaved float vertices: weld, vertex
+// cache, overdraw and vertex fetch. Positions are the first three floats.
+MeshOptimizeStats OptimizeMesh(std::vector<float> &vertices, size_t strideFloats, std::vector<uint32_t> &indices);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef MESHSIMPLIFIER_HPP
+#define MESHSIMPLIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Most LODs kept per mesh, LOD 0 is the full mesh
+const uint32_t gMeshMaxLods = 4;
+
+// One level of detail, a range of the shared index buffer. All levels
+// index the same vertices.
+struct MeshLod
+{
+    uint32_t mIndexOffset = 0;
+    uint32_t mIndexCount = 0;
+
+    // Largest distance, in model units, between this level and the full
+    // mesh surface
+    float mError = 0.0f;
+};
+
+// Quadric error metric edge collapse (Garland and Heckbert 1997). Vertices
+// collapse onto existing vertices so no new ones are created. Vertices
+// on open borders or shared by attribute seams are kept in place.
+// Stops at targetIndexCount or when the next collapse would exceed
+// maxError. Writes the error reached to resultError if given.
+std::vector<uint32_t> SimplifyMesh(const float *positions, size_t vertexCount, size_t stride,
+                                   const uint32_t *indices, size_t indexCount,
+                                   size_t targetIndexCount, float maxError, float *resultError = nullptr);
+
+// Append simplified copies of the indices, each about reduction times
+// the size of the previous level, until maxLods or the mesh won't
+// simplify further. Fills lods and returns how many there are.
+uint32_t BuildLodChain(const float *positions, size_t vertexCount, size_t stride, std::vector<uint32_t> &indices,
+                       MeshLod *lods, uint32_t maxLods, float reduction = 0.5f);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef OBJECTPOOL_HPP
+#define OBJECTPOOL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Long-lived objects of one type in blocks of BlockSize, recycled through
+// a free list. Addresses never change, so other threads may keep
+// pointers while new objects are created. Not thread safe itself, the
+// owner locks. Everything created must be destroyed before the pool.
+template <typename T, size_t BlockSize = 64>
+class ObjectPool
+{
+public:
+    ObjectPool() = default;
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    template <typename... Args>
+    T *create(Args &&...args)
+    {
+        if (mFree == nullptr)
+        {
+            addBlock();
+        }
+        Slot *slot = mFree;
+        mFree = slot->mNext;
+
+        T *object = new (slot->mStorage) T(std::forward<Args>(args)...);
+        mLiveCount++;
+        mPeakCount = mLiveCount > mPeakCount ? mLiveCount : mPeakCount;
+        return object;
+    }
+
+    void destroy(T *object)
+    {
+        object->~T();
+        Slot *slot = reinterpret_cast<Slot *>(object);
+        slot->mNext = mFree;
+        mFree = slot;
+        mLiveCount--;
+    }
+
+    size_t getLiveCount() const { return mLiveCount; }
+    size_t getPeakCount() const { return mPeakCount; }
+    size_t getCapacity() const { return mBlocks.size() * BlockSize; }
+
+private:
+    union Slot
+    {
+        Slot *mNext;
+        alignas(T) unsigned char mStorage[sizeof(T)];
+    };
+
+    void addBlock()
+    {
+        mBlocks.emplace_back(new Slot[BlockSize]);
+        Slot *block = mBlocks.back().get();
+        for (size_t i = 0; i < BlockSize; i++)
+        {
+            block[i].mNext = i + 1 < BlockSize ? &block[i + 1] : mFree;
+        }
+        mFree = block;
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> mBlocks;
+    Slot *mFree = nullptr;
+    size_t mLiveCount = 0;
+    size_t mPeakCount = 0;
+};
+
+#endif
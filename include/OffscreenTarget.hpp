@@ -0,0 +1,49 @@
+#ifndef OFFSCREENTARGET_HPP
+#define OFFSCREENTARGET_HPP
+
+#include <glad/glad.h>
+
+// Frames the GPU may lag behind when nothing is swapped
+const int gOffscreenFrames = 2;
+
+// Color and depth renderbuffers to draw into instead of the window. The
+// scene is drawn into one at the render scale and blitted to the output.
+// Benchmarks in a hidden window use another as the output. Without a
+// swap nothing stops the CPU from queueing frames without limit, so each
+// frame is fenced and endFrame() waits for the one gOffscreenFrames
+// back, like a swap would.
+class OffscreenTarget
+{
+public:
+    OffscreenTarget();
+    ~OffscreenTarget();
+
+    OffscreenTarget(const OffscreenTarget &) = delete;
+    OffscreenTarget &operator=(const OffscreenTarget &) = delete;
+
+    // RGBA8 color and 24-bit depth, the depth format the Hi-Z copy expects
+    bool create(int width, int height);
+    void destroy();
+
+    // Recreates the buffers only when the size changed
+    bool resize(int width, int height);
+
+    // Call where the window would be swapped
+    void endFrame();
+
+    GLuint getFramebuffer() const { return mFramebuffer; }
+    int getWidth() const { return mWidth; }
+    int getHeight() const { return mHeight; }
+
+private:
+    GLuint mFramebuffer = 0;
+    GLuint mColorBuffer = 0;
+    GLuint mDepthBuffer = 0;
+    int mWidth = 0;
+    int mHeight = 0;
+
+    GLsync mFences[gOffscreenFrames] = {};
+    int mFrameIndex = 0;
+};
+
+#endif
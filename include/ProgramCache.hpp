@@ -0,0 +1,47 @@
+#ifndef PROGRAMCACHE_HPP
+#define PROGRAMCACHE_HPP
+
+#include <glad/glad.h>
+
+#include <string>
+
+// On-disk cache of linked program binaries.
+// Entries are keyed by a hash of the shader sources together with the
+// GL_RENDERER and GL_VERSION strings, so a driver update or a different
+// GPU never picks up a stale binary. When the driver rejects a cached
+// binary the program is compiled from source and the entry rewritten.
+class ProgramCache
+{
+public:
+    // Query driver support and create the cache directory
+    void initialize(const std::string &directory);
+
+    // Linked program for the sources, from the cache when possible
+    GLuint load(const std::string &vertexShaderSource, const std::string &fragmentShaderSource);
+
+    // Path of the entry for an arbitrary key, other caches of compiled
+    // programs keep their files next to the binaries
+    std::string getEntryPath(unsigned long long key) const;
+
+    // Hash of the sources plus the driver strings
+    unsigned long long makeKey(const std::string &vertexShaderSource, const std::string &fragmentShaderSource) const;
+
+    bool isSupported() const { return mSupported; }
+    unsigned int getHits() const { return mHits; }
+    unsigned int getMisses() const { return mMisses; }
+
+private:
+    GLuint loadBinary(const std::string &path);
+    void storeBinary(const std::string &path, GLuint program);
+
+    std::string mDirectory;
+    std::string mDriverString;
+    bool mSupported = false;
+    unsigned int mHits = 0;
+    unsigned int mMisses = 0;
+};
+
+// 64-bit FNV-1a, continues from seed so several strings can be chained
+unsigned long long HashString(const std::string &text, unsigned long long seed = 14695981039346656037ull);
+
+#endif
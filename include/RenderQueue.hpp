@@ -0,0 +1,135 @@
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+#include <glad/glad.h>
+
+#include "GLStateCache.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sort key, most significant first:
+//   pass 4 bits | program 12 | material 12 | vertex array 12 | depth 24
+// Sorting groups draws by pass, then by the state that is most expensive
+// to change. Ids are masked to their field, a collision only costs an
+// extra state change, never a wrong draw.
+uint64_t MakeSortKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t vertexArray, uint32_t depth);
+
+// Front to back first, then state:
+//   pass 4 bits | depth 24 | program 12 | vertex array 12 | material 12
+// For passes where early depth rejection saves more than state changes
+// cost, e.g. depth-only passes or opaque draws without a pre-pass.
+uint64_t MakeDepthSortKey(uint32_t pass, uint32_t depth, uint32_t program, uint32_t vertexArray, uint32_t material);
+
+// Pass field of either key layout
+inline uint32_t GetSortKeyPass(uint64_t key) { return (uint32_t)(key >> 60); }
+
+// View depth in [0, farPlane] to the 24 bit key field, nearest first
+uint32_t QuantizeDepth(float depth, float farPlane);
+
+// Drawing state that belongs to what is drawn rather than to the pass.
+// The id goes into the sort key so draws of one material are adjacent.
+struct Material
+{
+    uint32_t mId = 0;
+
+    // Closed meshes cull back faces, flat or open ones are two-sided
+    bool mCullBackFaces = true;
+};
+
+// Depth and color writes of one pass, set when the sorted queue reaches
+// the pass's first draw
+struct PassState
+{
+    GLenum mDepthFunc = GL_LESS;
+    bool mDepthWrite = true;
+    bool mColorWrite = true;
+};
+
+// Everything the backend needs for one indexed draw. Uniforms are set on
+// the program by the pass before the queue is executed.
+struct DrawPacket
+{
+    uint64_t mKey = 0;
+    GLuint mProgram = 0;
+    GLuint mVertexArray = 0;
+    GLenum mIndexType = GL_UNSIGNED_INT;
+    GLsizei mIndexCount = 0;
+    uintptr_t mIndexOffset = 0;
+    bool mCullBackFaces = true;
+
+    // Zero for a plain draw. Instanced draws read the model matrices
+    // from mInstanceBuffer at mInstanceOffset.
+    GLsizei mInstanceCount = 0;
+    GLuint mInstanceBuffer = 0;
+    GLintptr mInstanceOffset = 0;
+
+    // ObjectData range, none when the buffer is 0
+    GLuint mObjectBuffer = 0;
+    GLintptr mObjectOffset = 0;
+};
+
+class RenderQueue
+{
+public:
+    void clear();
+    void submit(const DrawPacket &packet);
+
+    // Radix sort by key, stable, so equal keys draw in submit order
+    void sort();
+
+    size_t size() const { return mPackets.size(); }
+
+    // Packets in sorted order after sort()
+    const DrawPacket &operator[](size_t i) const { return mPackets[mOrder[i]]; }
+
+private:
+    std::vector<DrawPacket> mPackets;
+    std::vector<uint32_t> mOrder;
+    std::vector<uint32_t> mScratch;
+    std::vector<uint64_t> mKeys;
+    std::vector<uint64_t> mScratchKeys;
+};
+
+// Executes sorted queues through a GLStateCache, so consecutive packets
+// with the same program or vertex array cost no bind calls. Depth and
+// color writes follow each packet's pass and are left on afterwards.
+class RenderBackend
+{
+public:
+    static const uint32_t PassCount = 16;
+
+    struct Stats
+    {
+        size_t draws = 0;
+        size_t triangles = 0;
+        size_t instanceSourceChanges = 0;
+        size_t objectRangeChanges = 0;
+    };
+
+    void setPassState(uint32_t pass, const PassState &state) { mPassStates[pass % PassCount] = state; }
+
+    void execute(const RenderQueue &queue);
+
+    GLStateCache &getState() { return mState; }
+
+    // Counters for the last execute
+    const Stats &getStats() const { return mStats; }
+
+private:
+    GLStateCache mState;
+    Stats mStats;
+    PassState mPassStates[PassCount];
+
+    // Last instance attributes written, they are stored in the VAO
+    GLuint mInstanceVertexArray = 0;
+    GLuint mInstanceBuffer = 0;
+    GLintptr mInstanceOffset = -1;
+
+    // Last range bound to the ObjectData binding point
+    GLuint mObjectBuffer = 0;
+    GLintptr mObjectOffset = -1;
+};
+
+#endif
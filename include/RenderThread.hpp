@@ -0,0 +1,104 @@
+#ifndef RENDERTHREAD_HPP
+#define RENDERTHREAD_HPP
+
+#include <SDL2/SDL.h>
+
+#include "CommandBuffer.hpp"
+#include "Mesh3D.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Frames recorded ahead of the GL thread. With two, frame N+1 is being
+// simulated and recorded while frame N is submitted.
+const size_t gFramesInFlight = 2;
+
+// Everything the GL thread needs for a frame
+struct FrameCommands
+{
+    std::vector<CommandBuffer> mBuffers;
+
+    // Bound once for the whole frame
+    FrameBlock mFrameBlock = {};
+    ViewBlock mViewBlock = {};
+
+    // Opaque draws were recorded with a depth-only pass ahead of them
+    bool mDepthPrepass = false;
+
+    // Window or offscreen target size, and the corner of it the scene
+    // is drawn into at the render scale
+    int mOutputWidth = 0;
+    int mOutputHeight = 0;
+    int mRenderWidth = 0;
+    int mRenderHeight = 0;
+
+    // Run on the GL thread before the buffers are replayed, e.g. to
+    // delete objects no longer referenced by this frame
+    std::vector<std::function<void()>> mTasks;
+
+    // Instances of mCullMesh culled on the GPU, drawn after the buffers.
+    // Empty when the CPU culled them into the buffers.
+    Mesh3D mCullMesh;
+    std::vector<glm::mat4> mCullModels;
+    glm::mat4 mViewProjection = glm::mat4(1.0f);
+    ObjectBlock mCullObject = {};
+};
+
+// Owns the GL context on a dedicated thread and replays recorded frames
+// in order. The simulation thread fills the slot from beginFrame() and
+// hands it over with submitFrame(); it only blocks when it's more than
+// gFramesInFlight frames ahead.
+class RenderThread
+{
+public:
+    typedef std::function<void(FrameCommands &)> RenderFunction;
+
+    RenderThread();
+    ~RenderThread();
+
+    RenderThread(const RenderThread &) = delete;
+    RenderThread &operator=(const RenderThread &) = delete;
+
+    // Releases the context on the calling thread and makes it current on
+    // the render thread
+    void start(SDL_Window *window, SDL_GLContext context, RenderFunction render);
+
+    // Replays what was submitted, joins and makes the context current
+    // on the calling thread again
+    void stop();
+
+    bool isRunning() const { return mThread.joinable(); }
+
+    FrameCommands &beginFrame();
+    void submitFrame();
+
+    // Time the simulation thread spent waiting for a free slot, in ms
+    double getLastWaitTime() const { return mLastWaitTime; }
+
+private:
+    void threadMain();
+
+    SDL_Window *mWindow = nullptr;
+    SDL_GLContext mContext = nullptr;
+    RenderFunction mRender;
+
+    std::thread mThread;
+    std::mutex mMutex;
+    std::condition_variable mChanged;
+    bool mStopping = false;
+
+    FrameCommands mFrames[gFramesInFlight];
+    size_t mWriteIndex = 0;
+    size_t mReadIndex = 0;
+
+    // Submitted frames not yet finished by the render thread
+    size_t mQueued = 0;
+
+    double mLastWaitTime = 0.0;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef RESOLUTIONCONTROLLER_HPP
+#define RESOLUTIONCONTROLLER_HPP
+
+#include "RollingStats.hpp"
+
+// Render scale range, a fraction of the output size on each axis
+const float gRenderScaleMin = 0.5f;
+const float gRenderScaleMax = 1.0f;
+
+// Scale changes snap to multiples of this, so noise doesn't resize the
+// viewport every frame
+const float gRenderScaleStep = 0.05f;
+
+// Output size scaled and rounded, never below one pixel
+int ScaleRenderSize(int size, float scale);
+
+// Picks the render scale that keeps the GPU frame time inside a budget.
+//
+// GPU time is smoothed over a few frames. Above the budget's upper
+// headroom the scale drops, below the lower one it rises, and in between
+// it holds. The step assumes the cost is in fragments, which grow with
+// the square of the scale, and falls faster than it rises so a spike is
+// answered quickly without oscillating back up. After each change the
+// controller waits until the profiler's latency has passed and the
+// samples are from frames at the new scale.
+class ResolutionController
+{
+public:
+    ResolutionController();
+
+    // budget in milliseconds of GPU time per frame
+    void initialize(float scale, double budget);
+
+    // Off holds the current scale
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return mEnabled; }
+
+    void setScale(float scale);
+    void setBudget(double budget) { mBudget = budget; }
+
+    // Call once a frame with the GPU frame times. Only new samples are
+    // used, frames whose queries weren't ready yet are skipped. Returns
+    // true when the scale changed.
+    bool update(const RollingStats &gpuFrameTimes);
+
+    float getScale() const { return mScale; }
+    double getBudget() const { return mBudget; }
+    double getSmoothedTime() const { return mSmoothedTime; }
+
+private:
+    bool mEnabled = false;
+    float mScale = gRenderScaleMax;
+    double mBudget = 1000.0 / 60.0;
+    double mSmoothedTime = 0.0;
+    unsigned long long mSeen = 0;
+    bool mHasTime = false;
+    int mSettleFrames = 0;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef ROLLINGSTATS_HPP
+#define ROLLINGSTATS_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Fixed window of the most recent samples with min/avg/max/percentiles.
+// Used for frame times and GPU pass timings, values are milliseconds.
+class RollingStats
+{
+public:
+    explicit RollingStats(size_t windowSize = 1000);
+
+    void add(double value);
+    void clear();
+
+    double getMin() const;
+    double getMax() const;
+    double getAverage() const;
+
+    // percentile in [0, 100], sorts a copy of the window
+    double getPercentile(double percentile) const;
+
+    double getLast() const { return mLast; }
+
+    // Samples currently in the window and samples ever added
+    size_t getCount() const { return mSamples.size(); }
+    unsigned long long getTotalCount() const { return mTotalCount; }
+
+    const std::vector<double> &getSamples() const { return mSamples; }
+
+private:
+    size_t mWindowSize;
+    size_t mNext = 0;
+    std::vector<double> mSamples;
+    double mLast = 0.0;
+    unsigned long long mTotalCount = 0;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef SCENEINDEX_HPP
+#define SCENEINDEX_HPP
+
+#include "Bounds.hpp"
+#include "Frustum.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Objects per BVH leaf. Leaf boxes are stored as structure-of-arrays in
+// slots padded to this size, so one leaf is tested four or eight boxes
+// at a time.
+const size_t gSceneLeafSize = 8;
+
+// Bounding volume hierarchy over object world boxes for frustum culling.
+// Moving objects only refit the boxes on their path to the root; the
+// tree is rebuilt when refits have grown it too far from the last build.
+class SceneIndex
+{
+public:
+    typedef uint32_t ObjectId;
+
+    struct CullStats
+    {
+        size_t nodesVisited = 0;
+        size_t boxesTested = 0;
+        size_t visible = 0;
+    };
+
+    ObjectId insert(const Bounds &bounds);
+    void update(ObjectId object, const Bounds &bounds);
+    void clear();
+
+    // Full top-down rebuild, median split on the longest axis
+    void build();
+
+    // Apply pending updates, rebuilding first if objects were inserted
+    void commit();
+
+    // Append the objects whose box touches the frustum
+    void cull(const Frustum &frustum, std::vector<ObjectId> &visible);
+
+    // Same query testing one box at a time, the reference for the SIMD path
+    void cullScalar(const Frustum &frustum, std::vector<ObjectId> &visible);
+
+    // Up to count disjoint subtrees covering the tree, for culling on
+    // several threads. Call commit() first.
+    void getSubtrees(size_t count, std::vector<uint32_t> &roots) const;
+
+    // Cull one subtree from getSubtrees(). Const, each thread passes its
+    // own output, stack and stats.
+    void cullSubtree(const Frustum &frustum, uint32_t root, std::vector<ObjectId> &visible, std::vector<uint32_t> &stack, CullStats &stats) const;
+
+    size_t getObjectCount() const { return mObjectBounds.size(); }
+    size_t getNodeCount() const { return mNodes.size(); }
+    const CullStats &getCullStats() const { return mCullStats; }
+
+private:
+    struct Node
+    {
+        glm::vec3 mMin;
+        glm::vec3 mMax;
+
+        // Internal nodes: children at mFirst and mFirst + 1, mCount is 0.
+        // Leaves: objects in slots [mFirst, mFirst + mCount).
+        uint32_t mFirst = 0;
+        uint32_t mCount = 0;
+        uint32_t mParent = 0;
+    };
+
+    void buildNode(uint32_t index, uint32_t *objects, uint32_t count, uint32_t parent);
+    void refitLeaf(uint32_t node);
+    float rootArea() const;
+
+    template <typename Lanes>
+    void cullTree(const Frustum &frustum, uint32_t root, std::vector<ObjectId> &visible, std::vector<uint32_t> &stack, CullStats &stats) const;
+
+    template <typename Lanes>
+    void cullLeaf(const Node &node, const Frustum &frustum, unsigned int planeMask, std::vector<ObjectId> &visible, CullStats &stats) const;
+
+    void emitSubtree(uint32_t node, std::vector<ObjectId> &visible) const;
+
+    std::vector<Bounds> mObjectBounds;
+    std::vector<uint32_t> mObjectSlot;
+    std::vector<uint32_t> mObjectLeaf;
+
+    std::vector<Node> mNodes;
+    std::vector<uint8_t> mDirtyNodes;
+
+    // Leaf slots, structure-of-arrays
+    std::vector<float> mSlotMinX, mSlotMinY, mSlotMinZ;
+    std::vector<float> mSlotMaxX, mSlotMaxY, mSlotMaxZ;
+    std::vector<ObjectId> mSlotObject;
+
+    bool mNeedsBuild = true;
+    bool mHasDirty = false;
+    float mBuildArea = 0.0f;
+
+    std::vector<uint32_t> mStack;
+    CullStats mCullStats;
+};
+
+#endif
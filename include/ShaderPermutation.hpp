@@ -0,0 +1,134 @@
+#ifndef SHADERPERMUTATION_HPP
+#define SHADERPERMUTATION_HPP
+
+#include <glad/glad.h>
+
+#include "ProgramCache.hpp"
+#include "ShaderProgram.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class ShaderReloader;
+
+// Features a shader source can be specialized for. Each set bit becomes
+// a #define FEATURE_... line after the #version line, and the shader
+// picks its code with #ifdef, so no permutation branches at run time.
+enum class ShaderFeatures : uint32_t
+{
+    None = 0,
+
+    // Model matrix from the per-instance attribute instead of ObjectData
+    Instanced = 1u << 0,
+
+    // Positions are normalized and undone with ObjectData's scale and offset
+    PackedPositions = 1u << 1,
+
+    // Color from the vertex, or from the base color texture
+    VertexColor = 1u << 2,
+    Texture = 1u << 3,
+
+    // Position only, for the depth pre-pass
+    DepthOnly = 1u << 4
+};
+
+const uint32_t gShaderFeatureMask = (1u << 5) - 1;
+
+constexpr ShaderFeatures operator|(ShaderFeatures a, ShaderFeatures b)
+{
+    return (ShaderFeatures)((uint32_t)a | (uint32_t)b);
+}
+
+constexpr ShaderFeatures operator&(ShaderFeatures a, ShaderFeatures b)
+{
+    return (ShaderFeatures)((uint32_t)a & (uint32_t)b);
+}
+
+constexpr bool HasFeature(ShaderFeatures features, ShaderFeatures feature)
+{
+    return (features & feature) != ShaderFeatures::None;
+}
+
+// Color comes from exactly one source, and the depth pass has none
+constexpr bool IsValidPermutation(ShaderFeatures features)
+{
+    if (((uint32_t)features & ~gShaderFeatureMask) != 0)
+    {
+        return false;
+    }
+    bool vertexColor = HasFeature(features, ShaderFeatures::VertexColor);
+    bool texture = HasFeature(features, ShaderFeatures::Texture);
+    if (HasFeature(features, ShaderFeatures::DepthOnly))
+    {
+        return !vertexColor && !texture;
+    }
+    return vertexColor != texture;
+}
+
+// Fixed permutations go through this, an illegal one doesn't compile
+template <ShaderFeatures Features>
+constexpr ShaderFeatures MakePermutation()
+{
+    static_assert(IsValidPermutation(Features), "Illegal combination of shader features");
+    return Features;
+}
+
+static_assert(IsValidPermutation(ShaderFeatures::Instanced | ShaderFeatures::VertexColor), "Instanced vertex color must be legal");
+static_assert(!IsValidPermutation(ShaderFeatures::VertexColor | ShaderFeatures::Texture), "Two color sources must be illegal");
+static_assert(!IsValidPermutation(ShaderFeatures::DepthOnly | ShaderFeatures::Texture), "Depth only with color must be illegal");
+static_assert(!IsValidPermutation(ShaderFeatures::Instanced), "A color pass without color must be illegal");
+
+// The #define lines for a set of features, one per line
+std::string GetPermutationDefines(ShaderFeatures features);
+
+// Whole contents of a shader file, empty when it can't be read
+std::string ReadShaderFile(const std::string &path);
+
+// Insert defines after the #version line, the only thing allowed before
+// it. A #line directive keeps compiler messages on the file's line
+// numbers. Sources without a #version line get the defines first.
+std::string InjectDefines(const std::string &source, const std::string &defines);
+
+// Programs built from one vertex and fragment file with different feature
+// sets. A permutation is compiled the first time it is asked for, through
+// the program cache. The cache key covers the injected defines, so every
+// permutation gets its own binary next to the others. Each compiled
+// permutation is watched for edits of the two files.
+class ShaderPermutations
+{
+public:
+    ShaderPermutations();
+    ~ShaderPermutations();
+
+    ShaderPermutations(const ShaderPermutations &) = delete;
+    ShaderPermutations &operator=(const ShaderPermutations &) = delete;
+
+    // Files are relative to directory and read when a permutation is
+    // built. The reloader may be null.
+    void initialize(ProgramCache *cache, ShaderReloader *reloader, const std::string &directory,
+                    const std::string &vertexFile, const std::string &fragmentFile);
+
+    // GL thread. Exits on an illegal set or a build failure, like the
+    // other shader loading. The program stays at the same address until
+    // destroy().
+    ShaderProgram &get(ShaderFeatures features);
+
+    // After the reloader was stopped
+    void destroy();
+
+    size_t getCount() const { return mPrograms.size(); }
+
+private:
+    ProgramCache *mCache = nullptr;
+    ShaderReloader *mReloader = nullptr;
+    std::string mDirectory;
+    std::string mVertexFile;
+    std::string mFragmentFile;
+
+    std::unordered_map<uint32_t, std::unique_ptr<ShaderProgram>> mPrograms;
+};
+
+#endif
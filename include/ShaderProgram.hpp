@@ -0,0 +1,103 @@
+#ifndef SHADERPROGRAM_HPP
+#define SHADERPROGRAM_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+GLuint CompileShader(GLuint type, const std::string &source);
+
+// Set retrievable to read the linked binary back with glGetProgramBinary
+GLuint CreateShaderProgram(const std::string &vertexShaderSource, const std::string &fragmentShaderSource, bool retrievable = false);
+
+// Linked program plus a table of its active uniforms and attributes.
+// The shared uniform blocks are bound when a program is reflected.
+// Locations are read once after linking, lookups are then a hash of the
+// name on the CPU side only. The setters keep a copy of the last value
+// sent for each uniform and skip the upload when it hasn't changed.
+class ShaderProgram
+{
+public:
+    struct Uniform
+    {
+        std::string name;
+        GLint location = -1;
+        GLenum type = GL_NONE;
+        GLint size = 0;
+        bool hasValue = false;
+        std::vector<unsigned char> value;
+    };
+
+    struct Attribute
+    {
+        std::string name;
+        GLint location = -1;
+        GLenum type = GL_NONE;
+        GLint size = 0;
+    };
+
+    ShaderProgram();
+    ~ShaderProgram();
+
+    ShaderProgram(const ShaderProgram &) = delete;
+    ShaderProgram &operator=(const ShaderProgram &) = delete;
+
+    // Compile, link and reflect
+    void create(const std::string &vertexShaderSource, const std::string &fragmentShaderSource);
+
+    // Take ownership of an already linked program and reflect it
+    void adopt(GLuint program);
+
+    // Swap in a rebuilt program and return the old one, which the caller
+    // deletes once no queued frame uses it. Uniform indices already
+    // handed out keep meaning the same names, and cached values are
+    // uploaded to the new program, which is left bound.
+    GLuint replace(GLuint program);
+
+    void destroy();
+
+    void use() const;
+
+    // Safe to read while the GL thread replaces the program
+    GLuint getProgram() const { return mProgram.load(std::memory_order_acquire); }
+
+    // Index of a uniform in the table, -1 if it isn't active.
+    // Look the index up once and keep it, the setters take the index.
+    int findUniform(const std::string &name) const;
+    GLint getUniformLocation(const std::string &name) const;
+    GLint getAttributeLocation(const std::string &name) const;
+
+    const std::vector<Uniform> &getUniforms() const { return mUniforms; }
+    const std::vector<Attribute> &getAttributes() const { return mAttributes; }
+
+    // Setters expect the program to be in use, invalid indices are ignored
+    void setInt(int uniform, GLint value);
+    void setFloat(int uniform, GLfloat value);
+    void setVec2(int uniform, const glm::vec2 &value);
+    void setVec3(int uniform, const glm::vec3 &value);
+    void setVec4(int uniform, const glm::vec4 &value);
+    void setMat3(int uniform, const glm::mat3 &value);
+    void setMat4(int uniform, const glm::mat4 &value);
+
+    // Number of uploads skipped because the value was already set
+    unsigned long long getSkippedUploads() const { return mSkippedUploads; }
+
+private:
+    void reflect();
+
+    // True when the value differs from the cached one, updates the cache
+    bool changed(int uniform, const void *data, size_t size);
+
+    std::atomic<GLuint> mProgram{0};
+    std::vector<Uniform> mUniforms;
+    std::vector<Attribute> mAttributes;
+    std::unordered_map<std::string, int> mUniformTable;
+    std::unordered_map<std::string, int> mAttributeTable;
+    unsigned long long mSkippedUploads = 0;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef SHADERRELOADER_HPP
+#define SHADERRELOADER_HPP
+
+#include <glad/glad.h>
+
+#include "FileWatcher.hpp"
+#include "ShaderProgram.hpp"
+
+#include <string>
+#include <vector>
+
+// Frames a replaced program stays alive, recorded frames still in flight
+// may name it
+const int gRetiredProgramFrames = 4;
+
+// Rebuilds programs when their shader files change on disk.
+//
+// All GL work happens in update() on the GL thread. A changed program is
+// compiled and linked without querying any status, and with
+// KHR_parallel_shader_compile the driver does that on its own threads,
+// so later frames only poll GL_COMPLETION_STATUS_KHR. Without it the
+// status query waits for the build, once, when a file was saved. A build
+// that fails prints its log and the last good program stays in use.
+class ShaderReloader
+{
+public:
+    ShaderReloader();
+    ~ShaderReloader();
+
+    ShaderReloader(const ShaderReloader &) = delete;
+    ShaderReloader &operator=(const ShaderReloader &) = delete;
+
+    // Watch the shader directory, on the GL thread
+    void start(const std::string &directory);
+
+    // Drops pending builds and retired programs, on the GL thread
+    void stop();
+
+    // Rebuild program from these files, relative to the directory, with
+    // the permutation's defines injected after the #version line
+    void watch(ShaderProgram *program, const std::string &vertexFile, const std::string &fragmentFile, const std::string &defines = std::string());
+
+    // Call once a frame on the GL thread. Returns true when a program
+    // was swapped, the new one is then bound.
+    bool update();
+
+    bool isParallel() const { return mParallel; }
+
+private:
+    struct Entry
+    {
+        ShaderProgram *mProgram = nullptr;
+        std::string mVertexFile;
+        std::string mFragmentFile;
+        std::string mDefines;
+
+        // Build in progress, 0 when there is none
+        GLuint mPendingProgram = 0;
+        GLuint mPendingVertex = 0;
+        GLuint mPendingFragment = 0;
+    };
+
+    struct Retired
+    {
+        GLuint mProgram;
+        int mFramesLeft;
+    };
+
+    void beginBuild(Entry &entry);
+    bool finishBuild(Entry &entry);
+    void cancelBuild(Entry &entry);
+    std::string getLog(GLuint object, bool program) const;
+
+    std::string mDirectory;
+    FileWatcher mWatcher;
+    bool mParallel = false;
+
+    std::vector<Entry> mEntries;
+    std::vector<Retired> mRetired;
+    std::vector<std::string> mChanges;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef SIMDLANES_HPP
+#define SIMDLANES_HPP
+
+// Thin wrappers over the SIMD instruction sets used by the batch code.
+// Each struct has a vector type V of Width floats and the same static
+// operations, so algorithms are written once as templates over Lanes.
+// SimdLanes is the widest set this build targets, ScalarLanes is the
+// one-lane reference path.
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_LANES_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_LANES_NEON 1
+#endif
+
+struct ScalarLanes
+{
+    typedef float V;
+    static const size_t Width = 1;
+
+    static V load(const float *p) { return *p; }
+    static V set(float f) { return f; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+
+    // Bit i set when lane i of a is less than lane i of b
+    static int lessMask(V a, V b) { return a < b ? 1 : 0; }
+};
+
+#if defined(SIMD_LANES_SSE)
+struct SseLanes
+{
+    typedef __m128 V;
+    static const size_t Width = 4;
+
+    static V load(const float *p) { return _mm_loadu_ps(p); }
+    static V set(float f) { return _mm_set1_ps(f); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static int lessMask(V a, V b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+};
+#endif
+
+#if defined(SIMD_LANES_SSE) && defined(__AVX__)
+struct AvxLanes
+{
+    typedef __m256 V;
+    static const size_t Width = 8;
+
+    static V load(const float *p) { return _mm256_loadu_ps(p); }
+    static V set(float f) { return _mm256_set1_ps(f); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static int lessMask(V a, V b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+};
+#endif
+
+#if defined(SIMD_LANES_NEON)
+struct NeonLanes
+{
+    typedef float32x4_t V;
+    static const size_t Width = 4;
+
+    static V load(const float *p) { return vld1q_f32(p); }
+    static V set(float f) { return vdupq_n_f32(f); }
+    static V add(V a, V b) { return vaddq_f32(a, b); }
+    static V sub(V a, V b) { return vsubq_f32(a, b); }
+    static V mul(V a, V b) { return vmulq_f32(a, b); }
+
+    static int lessMask(V a, V b)
+    {
+        static const uint32_t bits[4] = {1, 2, 4, 8};
+        uint32x4_t mask = vandq_u32(vcltq_f32(a, b), vld1q_u32(bits));
+        uint32x2_t sum = vpadd_u32(vget_low_u32(mask), vget_high_u32(mask));
+        return (int)vget_lane_u32(vpadd_u32(sum, sum), 0);
+    }
+};
+#endif
+
+#if defined(SIMD_LANES_SSE) && defined(__AVX__)
+typedef AvxLanes SimdLanes;
+#elif defined(SIMD_LANES_SSE)
+typedef SseLanes SimdLanes;
+#elif defined(SIMD_LANES_NEON)
+typedef NeonLanes SimdLanes;
+#else
+typedef ScalarLanes SimdLanes;
+#endif
+
+// Name of the SimdLanes set, for logs and benchmark output
+inline const char *GetSimdLanesName()
+{
+#if defined(SIMD_LANES_SSE) && defined(__AVX__)
+    return "AVX";
+#elif defined(SIMD_LANES_SSE)
+    return "SSE";
+#elif defined(SIMD_LANES_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+#endif
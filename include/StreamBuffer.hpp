@@ -0,0 +1,65 @@
+#ifndef STREAMBUFFER_HPP
+#define STREAMBUFFER_HPP
+
+#include <glad/glad.h>
+
+// Number of frame regions in the ring, the CPU writes one while the GPU
+// may still be reading the other two
+const int gStreamBufferFrames = 3;
+
+// Triple-buffered streaming buffer for per-frame dynamic data.
+// Uses a persistent, coherent mapping when GL_ARB_buffer_storage is
+// available and falls back to an unsynchronized map of the current
+// region on a plain 4.1 context. Every region is fenced after the frame
+// that used it so it is only rewritten once the GPU is done with it.
+class StreamBuffer
+{
+public:
+    StreamBuffer();
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer &) = delete;
+    StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+    void create(GLenum target, GLsizeiptr frameSize);
+    void destroy();
+
+    // Wait for this frame's region and map it for writing
+    void beginFrame();
+
+    // Reserve bytes in this frame's region, returns nullptr when full.
+    // offset receives the position of the allocation in the whole buffer.
+    void *allocate(GLsizeiptr size, GLsizeiptr alignment, GLintptr *offset);
+
+    // Make the writes visible to GL, call before drawing from the buffer
+    void commit();
+
+    // Fence the region after the draws that read it have been submitted
+    void endFrame();
+
+    GLuint getBuffer() const { return mBuffer; }
+    GLenum getTarget() const { return mTarget; }
+    GLsizeiptr getFrameSize() const { return mFrameSize; }
+    bool isPersistent() const { return mPersistent; }
+
+    // Number of times beginFrame() had to wait on a fence
+    unsigned long long getStallCount() const { return mStallCount; }
+
+private:
+    GLuint mBuffer = 0;
+    GLenum mTarget = GL_ARRAY_BUFFER;
+    GLsizeiptr mFrameSize = 0;
+    bool mPersistent = false;
+
+    // Whole buffer mapping when persistent, current region otherwise
+    unsigned char *mPersistentBase = nullptr;
+    unsigned char *mRegion = nullptr;
+
+    int mFrameIndex = 0;
+    GLsizeiptr mRegionUsed = 0;
+    GLsync mFences[gStreamBufferFrames] = {};
+
+    unsigned long long mStallCount = 0;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef TEXTUREFORMAT_HPP
+#define TEXTUREFORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Block-compressed 2D textures in DDS or KTX2 containers. Only the
+// headers are parsed: level data stays in the file and is uploaded
+// straight from a memory mapping, so formats the GL can't sample are
+// rejected rather than decoded.
+//
+// DDS: BC1-BC5 by FourCC, BC1-BC7 by DXGI format in a DX10 header.
+// KTX2: BC1-BC7, ETC2 and EAC, no supercompression.
+
+// Levels a texture can have, enough for 32768 texels across
+const uint32_t gTextureMaxLevels = 16;
+
+// One mip level, where its data sits in the file
+struct TextureLevel
+{
+    uint64_t mOffset;
+    uint64_t mSize;
+    uint32_t mWidth;
+    uint32_t mHeight;
+};
+
+struct TextureFileInfo
+{
+    // GL compressed internal format enum
+    uint32_t mInternalFormat;
+
+    // Bytes per 4x4 block, 8 or 16
+    uint32_t mBlockBytes;
+
+    uint32_t mWidth;
+    uint32_t mHeight;
+
+    // Level 0 is the full size image
+    uint32_t mLevelCount;
+    TextureLevel mLevels[gTextureMaxLevels];
+};
+
+// Bytes of one level of a 4x4 block format
+uint64_t GetCompressedLevelSize(uint32_t blockBytes, uint32_t width, uint32_t height);
+
+// Name of a format parsed by ParseTextureFile, for logs
+const char *GetTextureFormatName(uint32_t internalFormat);
+
+// Parses a whole .dds or .ktx2 file held in memory. Prints why and
+// returns false for anything but a single 2D compressed image with its
+// levels inside the file.
+bool ParseTextureFile(const unsigned char *data, size_t size, const std::string &name, TextureFileInfo &info);
+
+#endif
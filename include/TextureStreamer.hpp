@@ -0,0 +1,183 @@
+#ifndef TEXTURESTREAMER_HPP
+#define TEXTURESTREAMER_HPP
+
+#include "JobSystem.hpp"
+#include "MappedFile.hpp"
+#include "ObjectPool.hpp"
+#include "TextureFormat.hpp"
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Levels this size and smaller are uploaded when a texture loads and
+// stay resident, so every texture can be sampled from the first frame
+const uint32_t gTextureTailSize = 128;
+
+// Level uploads in flight, each with its own pixel unpack buffer
+const size_t gTextureStagingBuffers = 4;
+
+// Staging bytes started per frame. Levels are never split, a larger one
+// still goes alone.
+const size_t gTextureUploadBytesPerFrame = 8 * 1024 * 1024;
+
+// Streams mip levels of compressed textures by screen-space size.
+//
+// A job memory-maps and parses the file and the mip tail is uploaded.
+// After that each frame's largest requested size picks the finest level
+// a texture needs. Finer levels stream in one at a time: the GL thread
+// maps a staging buffer, a job copies the level from the file mapping
+// into it, and the next update() uploads from the buffer. Residency is
+// the range from GL_TEXTURE_BASE_LEVEL down to the tail, so dropping a
+// level frees its storage and raises the base level. When the budget is
+// full the least recently requested textures lose levels first.
+class TextureStreamer
+{
+public:
+    typedef uint32_t Texture;
+
+    struct Stats
+    {
+        size_t textures = 0;
+        size_t residentBytes = 0;
+        size_t budget = 0;
+        unsigned long long uploads = 0;
+        unsigned long long uploadedBytes = 0;
+        unsigned long long evictions = 0;
+    };
+
+    TextureStreamer();
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    // Work runs on the job system, which must outlive stop(). budget is
+    // in bytes of compressed level data.
+    void start(JobSystem &jobSystem, size_t budget);
+
+    // GL thread, deletes the textures
+    void stop();
+
+    // Any thread
+    Texture load(const std::string &path);
+
+    // Any thread, every frame the texture is drawn: it covers about
+    // pixels texels across on screen. The largest request of a frame wins.
+    void requestResidency(Texture texture, float pixels);
+
+    // Call once a frame on the GL thread. Returns true when it made GL
+    // calls, which leave the active unit's 2D texture and the pixel
+    // unpack buffer bindings at 0.
+    bool update();
+
+    // GL thread. 0 until the mip tail is resident.
+    GLuint getTextureObject(Texture texture) const;
+
+    // GL thread. Finest resident level, gTextureMaxLevels while none is.
+    uint32_t getResidentLevel(Texture texture) const;
+
+    // GL thread
+    Stats getStats() const;
+
+private:
+    enum class State
+    {
+        Mapping,
+        Ready,
+        Failed
+    };
+
+    struct Entry
+    {
+        Texture texture = 0;
+        std::string path;
+        State state = State::Mapping;
+        MappedFile file;
+        TextureFileInfo info = {};
+
+        // First level of the mip tail, set with info
+        uint32_t tailLevel = 0;
+
+        // Requests since the last update(), under mMutex
+        float requestedPixels = 0.0f;
+
+        // GL thread only from here
+        GLuint object = 0;
+        uint32_t residentLevel = 0;
+        uint32_t wantedLevel = 0;
+        unsigned long long lastUsedFrame = 0;
+        bool uploading = false;
+    };
+
+    // One staging buffer and the levels being copied into it
+    struct Upload
+    {
+        GLuint buffer = 0;
+        size_t capacity = 0;
+        Entry *entry = nullptr;
+        uint32_t firstLevel = 0;
+        uint32_t lastLevel = 0;
+        size_t bytes = 0;
+        unsigned char *destination = nullptr;
+        size_t offsets[gTextureMaxLevels] = {};
+        std::atomic<bool> copied{false};
+    };
+
+    struct UploadJob
+    {
+        TextureStreamer *streamer;
+        Upload *upload;
+    };
+
+    struct EntryJob
+    {
+        TextureStreamer *streamer;
+        Entry *entry;
+    };
+
+    static void mapFileJob(Job *job, const void *data);
+    static void copyLevelsJob(Job *job, const void *data);
+
+    void mapFile(Entry &entry);
+    void copyLevels(Upload &upload);
+
+    void createTexture(Entry &entry);
+    bool beginUpload(Upload &upload, Entry &entry, uint32_t firstLevel, uint32_t lastLevel);
+    void finishUpload(Upload &upload);
+    bool makeRoom(size_t bytes, const Entry *keep);
+    void evictLevel(Entry &entry);
+    Entry *pickUpload() const;
+    uint32_t getWantedLevel(const Entry &entry, float pixels) const;
+
+    Entry *findEntry(Texture texture) const;
+
+    mutable std::mutex mMutex;
+    bool mStopping = false;
+
+    JobSystem *mJobSystem = nullptr;
+    JobCounter mPending;
+
+    // Jobs hold Entry pointers, the pool keeps them stable. Handles
+    // index mEntries from 1.
+    ObjectPool<Entry, 16> mEntryPool;
+    std::vector<Entry *> mEntries;
+
+    // GL thread only
+    Upload mUploads[gTextureStagingBuffers];
+    std::vector<Entry *> mReady;
+    unsigned long long mFrame = 0;
+    size_t mBudget = 0;
+    size_t mResidentBytes = 0;
+    size_t mInFlightBytes = 0;
+    unsigned long long mUploadCount = 0;
+    unsigned long long mUploadedBytes = 0;
+    unsigned long long mEvictionCount = 0;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef TRANSFORMSYSTEM_HPP
+#define TRANSFORMSYSTEM_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Transforms are processed in blocks of this many entries, a multiple of
+// the widest SIMD path. Dirty tracking is per block.
+const size_t gTransformBlockSize = 8;
+
+// Position, rotation and scale components in structure-of-arrays layout.
+// World matrices are rebuilt in SIMD batches (AVX, SSE or NEON, with a
+// scalar fallback) for blocks that contain a changed entry, and are kept
+// in one contiguous array that can be copied straight into an instance
+// buffer.
+class TransformSystem
+{
+public:
+    typedef uint32_t Handle;
+
+    void reserve(size_t count);
+    void clear();
+
+    Handle create(const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale);
+
+    void setPosition(Handle handle, const glm::vec3 &position);
+    void setRotation(Handle handle, const glm::quat &rotation);
+    void setScale(Handle handle, const glm::vec3 &scale);
+
+    glm::vec3 getPosition(Handle handle) const;
+    glm::vec3 getScale(Handle handle) const;
+
+    size_t size() const { return mCount; }
+    size_t getBlockCount() const { return mDirtyBlocks.size(); }
+
+    void markAllDirty();
+
+    // Rebuild the world matrices of every dirty block
+    void update();
+
+    // Same on the blocks in [firstBlock, lastBlock), for splitting the
+    // work across threads. Ranges must not overlap. Returns the number
+    // of entries recomputed.
+    size_t updateBlocks(size_t firstBlock, size_t lastBlock);
+
+    // Reference path without SIMD, for comparison and benchmarking
+    void updateScalar();
+
+    // Valid for size() entries after update()
+    const glm::mat4 *getWorldMatrices() const { return mWorldMatrices.data(); }
+
+    // Component arrays, padded to a whole number of blocks
+    const float *getPositionsX() const { return mPositionX.data(); }
+    const float *getPositionsY() const { return mPositionY.data(); }
+    const float *getPositionsZ() const { return mPositionZ.data(); }
+
+    // Entries recomputed by the last update, including block padding
+    size_t getUpdatedCount() const { return mUpdatedCount; }
+
+    // Name of the SIMD path compiled in
+    static const char *getSimdName();
+
+private:
+    void markDirty(Handle handle) { mDirtyBlocks[handle / gTransformBlockSize] = 1; }
+
+    size_t mCount = 0;
+
+    std::vector<float> mPositionX, mPositionY, mPositionZ;
+    std::vector<float> mRotationX, mRotationY, mRotationZ, mRotationW;
+    std::vector<float> mScaleX, mScaleY, mScaleZ;
+
+    std::vector<uint8_t> mDirtyBlocks;
+    std::vector<glm::mat4> mWorldMatrices;
+    size_t mUpdatedCount = 0;
+};
+
+#endif
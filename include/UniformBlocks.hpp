@@ -0,0 +1,87 @@
+#ifndef UNIFORMBLOCKS_HPP
+#define UNIFORMBLOCKS_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// Uniform blocks shared by every program. The shaders declare them as
+// layout(std140) blocks with the same names and members, and each
+// program's blocks are bound to the fixed points below when it is
+// reflected. Per-frame and per-view data are bound once a frame, object
+// data as one range of a large buffer per draw.
+//
+// std140 puts vec4 and mat4 columns on 16 byte boundaries and scalars on
+// their own size, so the structs below use only those types with
+// scalars grouped into whole vec4 slots. The asserts catch any member
+// that would land somewhere else on the GPU.
+
+const GLuint gFrameBlockBinding = 0;
+const GLuint gViewBlockBinding = 1;
+const GLuint gObjectBlockBinding = 2;
+
+// uniform FrameData
+struct FrameBlock
+{
+    // x, y, width, height in pixels
+    glm::vec4 mViewport;
+
+    // Seconds since start and since the previous frame
+    float mTime;
+    float mDeltaTime;
+    uint32_t mFrameIndex;
+    float mPadding;
+};
+
+// uniform ViewData
+struct ViewBlock
+{
+    glm::mat4 mView;
+    glm::mat4 mProjection;
+    glm::mat4 mViewProjection;
+
+    // World space camera position, w is 1
+    glm::vec4 mEye;
+};
+
+// uniform ObjectData
+struct ObjectBlock
+{
+    glm::mat4 mModel;
+
+    // Undo position quantization, xyz used
+    glm::vec4 mPositionScale;
+    glm::vec4 mPositionOffset;
+};
+
+static_assert(offsetof(FrameBlock, mViewport) == 0, "FrameBlock must match std140");
+static_assert(offsetof(FrameBlock, mTime) == 16, "FrameBlock must match std140");
+static_assert(offsetof(FrameBlock, mDeltaTime) == 20, "FrameBlock must match std140");
+static_assert(offsetof(FrameBlock, mFrameIndex) == 24, "FrameBlock must match std140");
+static_assert(sizeof(FrameBlock) == 32, "FrameBlock must match std140");
+
+static_assert(offsetof(ViewBlock, mView) == 0, "ViewBlock must match std140");
+static_assert(offsetof(ViewBlock, mProjection) == 64, "ViewBlock must match std140");
+static_assert(offsetof(ViewBlock, mViewProjection) == 128, "ViewBlock must match std140");
+static_assert(offsetof(ViewBlock, mEye) == 192, "ViewBlock must match std140");
+static_assert(sizeof(ViewBlock) == 208, "ViewBlock must match std140");
+
+static_assert(offsetof(ObjectBlock, mModel) == 0, "ObjectBlock must match std140");
+static_assert(offsetof(ObjectBlock, mPositionScale) == 64, "ObjectBlock must match std140");
+static_assert(offsetof(ObjectBlock, mPositionOffset) == 80, "ObjectBlock must match std140");
+static_assert(sizeof(ObjectBlock) == 96, "ObjectBlock must match std140");
+
+// Bind the FrameData, ViewData and ObjectData blocks a program declares
+// to their binding points. Blocks the program doesn't use are skipped.
+void BindUniformBlocks(GLuint program);
+
+// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, queried once. Every range bound
+// with glBindBufferRange starts on a multiple of it.
+GLsizeiptr GetUniformBufferAlignment();
+
+// Bytes between consecutive ObjectBlocks in a buffer of ranges
+GLsizeiptr GetObjectBlockStride();
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef VERTEXLAYOUT_HPP
+#define VERTEXLAYOUT_HPP
+
+#include <glm/glm.hpp>
+
+#include "Bounds.hpp"
+#include "MeshFormat.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Attribute locations shared by every vertex shader
+const uint32_t gPositionAttributeLocation = 0;
+const uint32_t gColorAttributeLocation = 1;
+const uint32_t gNormalAttributeLocation = 6;
+
+enum class PositionFormat
+{
+    Float,  // 12 bytes
+    Half,   // 6 bytes, padded to 8
+    Snorm16 // 6 bytes padded to 8, relative to the mesh bounds
+};
+
+enum class ColorFormat
+{
+    Float, // 12 bytes
+    Unorm8 // 4 bytes, RGBA
+};
+
+enum class NormalFormat
+{
+    None,
+    Float,         // 12 bytes
+    Int2_10_10_10 // 4 bytes, GL_INT_2_10_10_10_REV
+};
+
+struct VertexFormat
+{
+    PositionFormat mPosition = PositionFormat::Float;
+    ColorFormat mColor = ColorFormat::Float;
+    NormalFormat mNormal = NormalFormat::None;
+};
+
+// All formats are turned into floats by the vertex fetch, so the shaders
+// declare vec3 inputs whatever the layout. Only snorm16 positions need
+// uPositionScale and uPositionOffset from ObjectData to undo the bounds
+// normalization.
+struct VertexLayout
+{
+    VertexAttribute mAttributes[gMeshMaxAttributes] = {};
+    uint32_t mAttributeCount = 0;
+    uint32_t mStride = 0;
+};
+
+// Attribute offsets are kept 4 byte aligned, as most drivers prefer
+VertexLayout MakeVertexLayout(const VertexFormat &format);
+
+// Interleave float positions, colors and optional normals, read every
+// stride floats, into the layout. Bounds are those of the positions and
+// are used by snorm16 positions.
+void PackVertices(const VertexFormat &format, const VertexLayout &layout, const Bounds &bounds,
+                  const float *positions, const float *colors, const float *normals,
+                  size_t vertexCount, size_t stride, std::vector<unsigned char> &out);
+
+// Scale and offset that map a fetched position back to model space,
+// identity unless the position attribute is normalized
+void GetPositionDequantization(const VertexAttribute &position, const Bounds &bounds, glm::vec3 *scale, glm::vec3 *offset);
+
+uint16_t FloatToHalf(float value);
+
+#endif
@@ -0,0 +1,27 @@
+#version 410 core
+
+// Emit only visible instances, transform feedback packs them densely
+layout(points) in;
+layout(points, max_vertices = 1) out;
+
+in vec4 cullModel0[];
+in vec4 cullModel1[];
+in vec4 cullModel2[];
+in vec4 cullModel3[];
+in float cullVisible[];
+
+out vec4 culledModel0;
+out vec4 culledModel1;
+out vec4 culledModel2;
+out vec4 culledModel3;
+
+void main(){
+    if (cullVisible[0] > 0.5){
+        culledModel0 = cullModel0[0];
+        culledModel1 = cullModel1[0];
+        culledModel2 = cullModel2[0];
+        culledModel3 = cullModel3[0];
+        EmitVertex();
+        EndPrimitive();
+    }
+}
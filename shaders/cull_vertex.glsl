@@ -0,0 +1,79 @@
+#version 410 core
+
+// One point per instance, the model matrix is the instance data
+layout(location=0) in vec4 model0;
+layout(location=1) in vec4 model1;
+layout(location=2) in vec4 model2;
+layout(location=3) in vec4 model3;
+
+// Captured directly when there is no geometry shader, culled instances
+// then get a zero matrix and collapse to a point
+out vec4 cullModel0;
+out vec4 cullModel1;
+out vec4 cullModel2;
+out vec4 cullModel3;
+out float cullVisible;
+
+uniform vec4 uFrustumPlanes[6];
+
+// Local bounding sphere shared by all instances, center and radius
+uniform vec4 uMeshSphere;
+
+// Max depth pyramid of the previous frame, with its view projection
+uniform sampler2D uHiZ;
+uniform int uUseHiZ;
+uniform vec2 uHiZSize;
+uniform int uHiZLevels;
+uniform mat4 uPreviousViewProjection;
+
+bool OutsideFrustum(vec3 center, float radius){
+    for (int i = 0; i < 6; i++){
+        if (dot(uFrustumPlanes[i].xyz, center) + uFrustumPlanes[i].w < -radius){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool OccludedByHiZ(vec3 center, float radius){
+    // Screen rectangle and nearest depth of the sphere's box last frame
+    vec2 minUv = vec2(1.0);
+    vec2 maxUv = vec2(0.0);
+    float minDepth = 1.0;
+    for (int i = 0; i < 8; i++){
+        vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = uPreviousViewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0){
+            // Reaches behind the camera, can't be tested
+            return false;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        minUv = min(minUv, ndc.xy * 0.5 + 0.5);
+        maxUv = max(maxUv, ndc.xy * 0.5 + 0.5);
+        minDepth = min(minDepth, ndc.z * 0.5 + 0.5);
+    }
+    minUv = clamp(minUv, vec2(0.0), vec2(1.0));
+    maxUv = clamp(maxUv, vec2(0.0), vec2(1.0));
+
+    // At this level the rectangle spans at most two texels per axis
+    vec2 size = (maxUv - minUv) * uHiZSize;
+    float level = min(ceil(log2(max(max(size.x, size.y), 1.0))), float(uHiZLevels - 1));
+
+    float depth = max(max(textureLod(uHiZ, minUv, level).r, textureLod(uHiZ, vec2(maxUv.x, minUv.y), level).r),
+                      max(textureLod(uHiZ, vec2(minUv.x, maxUv.y), level).r, textureLod(uHiZ, maxUv, level).r));
+    return minDepth > depth;
+}
+
+void main(){
+    mat4 model = mat4(model0, model1, model2, model3);
+    vec3 center = (model * vec4(uMeshSphere.xyz, 1.0)).xyz;
+    float radius = uMeshSphere.w * max(length(model0.xyz), max(length(model1.xyz), length(model2.xyz)));
+
+    bool visible = !OutsideFrustum(center, radius) && (uUseHiZ == 0 || !OccludedByHiZ(center, radius));
+
+    cullVisible = visible ? 1.0 : 0.0;
+    cullModel0 = visible ? model0 : vec4(0.0);
+    cullModel1 = visible ? model1 : vec4(0.0);
+    cullModel2 = visible ? model2 : vec4(0.0);
+    cullModel3 = visible ? model3 : vec4(0.0);
+}
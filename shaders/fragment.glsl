@@ -1,8 +1,33 @@
 #version 410 core
 
+// Permutations as in vertex.glsl. The color comes from exactly one of
+// FEATURE_VERTEX_COLOR and FEATURE_TEXTURE, FEATURE_DEPTH_ONLY writes none.
+
+#if defined(FEATURE_DEPTH_ONLY)
+
+void main(){
+}
+
+#elif defined(FEATURE_TEXTURE)
+
+in vec2 texCoord;
+out vec4 color;
+
+uniform sampler2D uBaseColor;
+
+void main(){
+    color = vec4(texture(uBaseColor, texCoord).rgb, 1.0f);
+}
+
+#elif defined(FEATURE_VERTEX_COLOR)
+
 in vec3 vertexColor;
 out vec4 color;
 
 void main(){
     color = vec4(vertexColor, 1.0f);
-}
\ No newline at end of file
+}
+
+#else
+#error "fragment.glsl needs FEATURE_VERTEX_COLOR, FEATURE_TEXTURE or FEATURE_DEPTH_ONLY"
+#endif
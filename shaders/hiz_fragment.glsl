@@ -0,0 +1,30 @@
+#version 410 core
+
+// One level of the max depth pyramid. With uReduce 0 the source is the
+// depth texture, copied as is, otherwise the previous level. The source
+// is sampled at its base level.
+uniform sampler2D uSource;
+uniform int uReduce;
+
+out float depth;
+
+void main(){
+    ivec2 target = ivec2(gl_FragCoord.xy);
+    if (uReduce == 0){
+        depth = texelFetch(uSource, target, 0).r;
+        return;
+    }
+
+    // Odd sizes leave a row or column over, the last texel takes it too
+    ivec2 last = textureSize(uSource, 0) - 1;
+    ivec2 source = target * 2;
+    ivec2 extent = ivec2(source.x + 2 == last.x ? 3 : 2, source.y + 2 == last.y ? 3 : 2);
+
+    float result = 0.0;
+    for (int y = 0; y < extent.y; y++){
+        for (int x = 0; x < extent.x; x++){
+            result = max(result, texelFetch(uSource, min(source + ivec2(x, y), last), 0).r);
+        }
+    }
+    depth = result;
+}
@@ -1,16 +1,67 @@
 #version 410 core
 
+// Permutations, defined by include/ShaderPermutation.hpp:
+//  FEATURE_INSTANCED         model matrix per instance from attribute 2
+//  FEATURE_PACKED_POSITIONS  undo the position quantization
+//  FEATURE_VERTEX_COLOR      pass the vertex color on
+//  FEATURE_TEXTURE           pass texture coordinates on
+//  FEATURE_DEPTH_ONLY        position only, for the depth pre-pass
+
 layout(location=0) in vec3 position;
+#ifdef FEATURE_VERTEX_COLOR
 layout(location=1) in vec3 colors;
+#endif
+#ifdef FEATURE_INSTANCED
+layout(location=2) in mat4 instanceModel;
+#endif
 
+#ifdef FEATURE_VERTEX_COLOR
 out vec3 vertexColor;
+#endif
+#ifdef FEATURE_TEXTURE
+out vec2 texCoord;
+#endif
+
+// Bit-identical depth between the pre-pass and the color pass, every
+// permutation computes the position the same way
+invariant gl_Position;
+
+// Shared blocks, std140 to match include/UniformBlocks.hpp
+layout(std140) uniform ViewData {
+    mat4 uView;
+    mat4 uProjection;
+    mat4 uViewProjection;
+    vec4 uEye;
+};
 
-uniform mat4 uTransform;
+// xyz undo position quantization. The instance matrix takes the place
+// of uModel when instanced.
+layout(std140) uniform ObjectData {
+    mat4 uModel;
+    vec4 uPositionScale;
+    vec4 uPositionOffset;
+};
 
 void main(){
-    vertexColor = colors;
+#ifdef FEATURE_PACKED_POSITIONS
+    vec3 modelPosition = position * uPositionScale.xyz + uPositionOffset.xyz;
+#else
+    vec3 modelPosition = position;
+#endif
+
+#ifdef FEATURE_INSTANCED
+    mat4 model = instanceModel;
+#else
+    mat4 model = uModel;
+#endif
 
-    vec4 newPosition = uTransform * vec4(position, 1.0f);
+#ifdef FEATURE_VERTEX_COLOR
+    vertexColor = colors;
+#endif
+#ifdef FEATURE_TEXTURE
+    // The meshes carry no texture coordinates, project along z
+    texCoord = modelPosition.xy + 0.5f;
+#endif
 
-    gl_Position = newPosition;
-}
\ No newline at end of file
+    gl_Position = uViewProjection * model * vec4(modelPosition, 1.0f);
+}
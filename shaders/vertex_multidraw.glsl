@@ -0,0 +1,29 @@
+#version 410 core
+
+layout(location=0) in vec3 position;
+layout(location=1) in vec3 colors;
+layout(location=7) in uint drawId;
+
+out vec3 vertexColor;
+
+// Shared block, std140 to match include/UniformBlocks.hpp
+layout(std140) uniform ViewData {
+    mat4 uView;
+    mat4 uProjection;
+    mat4 uViewProjection;
+    vec4 uEye;
+};
+
+// Per-draw model matrices, four texels each, with the position
+// dequantization of the draw's mesh already applied
+uniform samplerBuffer uDrawData;
+
+void main(){
+    vertexColor = colors;
+
+    int base = int(drawId) * 4;
+    mat4 drawModel = mat4(texelFetch(uDrawData, base), texelFetch(uDrawData, base + 1),
+                          texelFetch(uDrawData, base + 2), texelFetch(uDrawData, base + 3));
+
+    gl_Position = uViewProjection * drawModel * vec4(position, 1.0f);
+}
@@ -0,0 +1,302 @@
+#include "Benchmark.hpp"
+
+#include "ResolutionController.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static void PrintUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --benchmark           run a fixed number of uncapped frames and write the results\n"
+              << "  --frames N            measured frames, default 1000\n"
+              << "  --warmup N            frames run before measuring, default 60\n"
+              << "  --camera-path FILE    camera path to play back, default a scripted flyover\n"
+              << "  --record-path FILE    save the camera path of an interactive run\n"
+              << "  --output FILE         results, default benchmark.json\n"
+              << "  --instances N         instanced quads in the scene\n"
+              << "  --meshes M            distinct static meshes in the scene\n"
+              << "  --gpu-culling         cull the instances on the GPU\n"
+              << "  --depth-prepass       draw the instances into depth before color\n"
+              << "  --render-scale S      fraction of the output size to render at, 0.5 to 1\n"
+              << "  --gpu-budget MS       adjust the render scale to hold this GPU frame time\n"
+              << "  --offscreen           render into a framebuffer in a hidden window\n"
+              << "  --size WxH            window or framebuffer size" << std::endl;
+}
+
+// Whole argument as a non-negative integer
+static bool ParseCount(const char *text, int &value)
+{
+    char *end = nullptr;
+    long parsed = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || parsed < 0 || parsed > 100000000)
+    {
+        return false;
+    }
+    value = (int)parsed;
+    return true;
+}
+
+// Whole argument as a positive number
+static bool ParseNumber(const char *text, double &value)
+{
+    char *end = nullptr;
+    double parsed = std::strtod(text, &end);
+    if (end == text || *end != '\0' || !(parsed > 0.0) || parsed > 1000000.0)
+    {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool ParseBenchmarkOptions(int argc, char *argv[], BenchmarkOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *argument = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool valid = true;
+
+        if (std::strcmp(argument, "--benchmark") == 0)
+        {
+            options.mEnabled = true;
+            continue;
+        }
+        if (std::strcmp(argument, "--gpu-culling") == 0)
+        {
+            options.mGpuCulling = true;
+            continue;
+        }
+        if (std::strcmp(argument, "--depth-prepass") == 0)
+        {
+            options.mDepthPrepass = true;
+            continue;
+        }
+        if (std::strcmp(argument, "--offscreen") == 0)
+        {
+            options.mOffscreen = true;
+            continue;
+        }
+        if (std::strcmp(argument, "--help") == 0)
+        {
+            PrintUsage(argv[0]);
+            return false;
+        }
+
+        // The rest take a value
+        if (value == nullptr)
+        {
+            std::cout << "Missing value for " << argument << std::endl;
+            PrintUsage(argv[0]);
+            return false;
+        }
+        i++;
+
+        if (std::strcmp(argument, "--frames") == 0)
+        {
+            valid = ParseCount(value, options.mFrames) && options.mFrames > 0;
+        }
+        else if (std::strcmp(argument, "--warmup") == 0)
+        {
+            valid = ParseCount(value, options.mWarmupFrames);
+        }
+        else if (std::strcmp(argument, "--camera-path") == 0)
+        {
+            options.mCameraPath = value;
+        }
+        else if (std::strcmp(argument, "--record-path") == 0)
+        {
+            options.mRecordPath = value;
+        }
+        else if (std::strcmp(argument, "--output") == 0)
+        {
+            options.mOutputPath = value;
+        }
+        else if (std::strcmp(argument, "--instances") == 0)
+        {
+            valid = ParseCount(value, options.mInstances) && options.mInstances > 0;
+        }
+        else if (std::strcmp(argument, "--meshes") == 0)
+        {
+            valid = ParseCount(value, options.mStaticMeshes);
+        }
+        else if (std::strcmp(argument, "--render-scale") == 0)
+        {
+            double scale = 0.0;
+            valid = ParseNumber(value, scale) && scale >= gRenderScaleMin && scale <= gRenderScaleMax;
+            options.mRenderScale = (float)scale;
+        }
+        else if (std::strcmp(argument, "--gpu-budget") == 0)
+        {
+            valid = ParseNumber(value, options.mGpuBudget);
+        }
+        else if (std::strcmp(argument, "--size") == 0)
+        {
+            int width = 0;
+            int height = 0;
+            char separator = 0;
+            char extra = 0;
+            valid = std::sscanf(value, "%d%c%d%c", &width, &separator, &height, &extra) == 3 && separator == 'x' && width > 0 && height > 0;
+            options.mWidth = width;
+            options.mHeight = height;
+        }
+        else
+        {
+            std::cout << "Unknown option " << argument << std::endl;
+            PrintUsage(argv[0]);
+            return false;
+        }
+
+        if (!valid)
+        {
+            std::cout << "Bad value for " << argument << ": " << value << std::endl;
+            PrintUsage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+void BenchmarkRecorder::start(size_t frames)
+{
+    mFrames = frames;
+    mCpuTimes = RollingStats(frames);
+    mFrameTimes = RollingStats(frames);
+    mRenderTimes = RollingStats(frames);
+    mDrawCalls = RollingStats(frames);
+    mTriangles = RollingStats(frames);
+    mGpuScopes.clear();
+}
+
+void BenchmarkRecorder::addCpuFrame(double milliseconds)
+{
+    mCpuTimes.add(milliseconds);
+}
+
+void BenchmarkRecorder::addRenderFrame(double frameMilliseconds, double renderMilliseconds, size_t drawCalls, size_t triangles)
+{
+    mFrameTimes.add(frameMilliseconds);
+    mRenderTimes.add(renderMilliseconds);
+    mDrawCalls.add((double)drawCalls);
+    mTriangles.add((double)triangles);
+}
+
+void BenchmarkRecorder::addGpuScopes(const GpuProfiler &profiler)
+{
+    // Profiler scopes only ever get appended, so indices line up
+    const std::vector<GpuProfiler::Scope> &scopes = profiler.getScopes();
+    for (size_t i = 0; i < scopes.size(); i++)
+    {
+        if (i == mGpuScopes.size())
+        {
+            GpuScopeTimes times;
+            times.mName = scopes[i].name;
+            times.mTimes = RollingStats(mFrames);
+            times.mSeen = scopes[i].times.getTotalCount();
+            mGpuScopes.push_back(times);
+            continue;
+        }
+
+        GpuScopeTimes &times = mGpuScopes[i];
+        if (scopes[i].times.getTotalCount() != times.mSeen)
+        {
+            times.mTimes.add(scopes[i].times.getLast());
+            times.mSeen = scopes[i].times.getTotalCount();
+        }
+    }
+}
+
+// Quoted and escaped, renderer strings come from the driver
+static std::string JsonString(const std::string &text)
+{
+    std::string result = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            result += ' ';
+        }
+        else
+        {
+            result += c;
+        }
+    }
+    return result + "\"";
+}
+
+static void WriteStats(std::ostream &out, const RollingStats &stats)
+{
+    out << "{\"samples\": " << stats.getCount()
+        << ", \"min\": " << stats.getMin()
+        << ", \"mean\": " << stats.getAverage()
+        << ", \"p50\": " << stats.getPercentile(50.0)
+        << ", \"p90\": " << stats.getPercentile(90.0)
+        << ", \"p95\": " << stats.getPercentile(95.0)
+        << ", \"p99\": " << stats.getPercentile(99.0)
+        << ", \"max\": " << stats.getMax() << "}";
+}
+
+bool BenchmarkRecorder::writeJson(const std::string &path, const BenchmarkOptions &options, const BenchmarkInfo &info) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "Could not write benchmark results to " << path << std::endl;
+        return false;
+    }
+
+    double averageFrame = mFrameTimes.getAverage();
+
+    file << "{\n";
+    file << "  \"renderer\": " << JsonString(info.mRenderer) << ",\n";
+    file << "  \"gl_version\": " << JsonString(info.mVersion) << ",\n";
+    file << "  \"simd\": " << JsonString(info.mSimd) << ",\n";
+    file << "  \"settings\": {\"frames\": " << options.mFrames
+         << ", \"warmup_frames\": " << options.mWarmupFrames
+         << ", \"width\": " << options.mWidth
+         << ", \"height\": " << options.mHeight
+         << ", \"offscreen\": " << (options.mOffscreen ? "true" : "false")
+         << ", \"gpu_culling\": " << (options.mGpuCulling ? "true" : "false")
+         << ", \"depth_prepass\": " << (options.mDepthPrepass ? "true" : "false")
+         << ", \"render_scale\": " << options.mRenderScale
+         << ", \"gpu_budget_ms\": " << options.mGpuBudget
+         << ", \"multi_draw\": " << (info.mMultiDraw ? "true" : "false")
+         << ", \"instances\": " << info.mInstances
+         << ", \"static_meshes\": " << info.mStaticMeshes
+         << ", \"job_threads\": " << info.mJobThreads
+         << ", \"camera_path\": " << JsonString(info.mCameraPath) << "},\n";
+    file << "  \"average_fps\": " << (averageFrame > 0.0 ? 1000.0 / averageFrame : 0.0) << ",\n";
+
+    file << "  \"frame_ms\": ";
+    WriteStats(file, mFrameTimes);
+    file << ",\n  \"cpu_main_ms\": ";
+    WriteStats(file, mCpuTimes);
+    file << ",\n  \"cpu_render_ms\": ";
+    WriteStats(file, mRenderTimes);
+    file << ",\n  \"draw_calls\": ";
+    WriteStats(file, mDrawCalls);
+    file << ",\n  \"triangles\": ";
+    WriteStats(file, mTriangles);
+
+    file << ",\n  \"gpu_ms\": {";
+    for (size_t i = 0; i < mGpuScopes.size(); i++)
+    {
+        file << (i == 0 ? "\n    " : ",\n    ") << JsonString(mGpuScopes[i].mName) << ": ";
+        WriteStats(file, mGpuScopes[i].mTimes);
+    }
+    file << (mGpuScopes.empty() ? "}\n" : "\n  }\n");
+    file << "}\n";
+
+    std::cout << "Benchmark: " << mFrameTimes.getCount() << " frames, " << averageFrame << " ms average, p99 "
+              << mFrameTimes.getPercentile(99.0) << " ms, written to " << path << std::endl;
+    return (bool)file;
+}
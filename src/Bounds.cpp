@@ -0,0 +1,82 @@
+#include "Bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+Bounds ComputeBounds(const float *positions, size_t vertexCount, size_t stride)
+{
+    Bounds bounds;
+    if (vertexCount == 0)
+    {
+        return bounds;
+    }
+
+    bounds.mMin = glm::vec3(positions[0], positions[1], positions[2]);
+    bounds.mMax = bounds.mMin;
+
+    for (size_t i = 1; i < vertexCount; i++)
+    {
+        const float *p = positions + i * stride;
+        glm::vec3 position(p[0], p[1], p[2]);
+        bounds.mMin = glm::min(bounds.mMin, position);
+        bounds.mMax = glm::max(bounds.mMax, position);
+    }
+
+    bounds.mCenter = (bounds.mMin + bounds.mMax) * 0.5f;
+
+    // Tighter than the box diagonal for most meshes
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        const float *p = positions + i * stride;
+        glm::vec3 offset = glm::vec3(p[0], p[1], p[2]) - bounds.mCenter;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    bounds.mRadius = std::sqrt(radiusSquared);
+
+    return bounds;
+}
+
+Bounds MakeBounds(const glm::vec3 &center, const glm::vec3 &halfExtents)
+{
+    Bounds bounds;
+    bounds.mMin = center - halfExtents;
+    bounds.mMax = center + halfExtents;
+    bounds.mCenter = center;
+    bounds.mRadius = glm::length(halfExtents);
+    return bounds;
+}
+
+Bounds TransformBounds(const Bounds &bounds, const glm::mat4 &transform)
+{
+    // Arvo's method, the extent along each axis is the sum of the
+    // absolute rotated half extents
+    glm::vec3 center = glm::vec3(transform * glm::vec4((bounds.mMin + bounds.mMax) * 0.5f, 1.0f));
+    glm::vec3 halfExtents = (bounds.mMax - bounds.mMin) * 0.5f;
+
+    glm::vec3 extents(0.0f);
+    for (int column = 0; column < 3; column++)
+    {
+        extents += glm::abs(glm::vec3(transform[column])) * halfExtents[column];
+    }
+
+    Bounds result;
+    result.mMin = center - extents;
+    result.mMax = center + extents;
+    result.mCenter = glm::vec3(transform * glm::vec4(bounds.mCenter, 1.0f));
+
+    float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    result.mRadius = bounds.mRadius * scale;
+
+    return result;
+}
+
+Bounds MergeBounds(const Bounds &a, const Bounds &b)
+{
+    Bounds result;
+    result.mMin = glm::min(a.mMin, b.mMin);
+    result.mMax = glm::max(a.mMax, b.mMax);
+    result.mCenter = (result.mMin + result.mMax) * 0.5f;
+    result.mRadius = std::max(glm::distance(result.mCenter, a.mCenter) + a.mRadius, glm::distance(result.mCenter, b.mCenter) + b.mRadius);
+    return result;
+}
@@ -21,9 +21,86 @@ Camera::Camera()
     rightVector = glm::normalize(glm::cross(viewDirection, upVector));
 }
 
-glm::mat4 Camera::getViewMatrix()
+void Camera::setProjection(float fovY, float aspect, float nearPlane, float farPlane)
 {
-    return glm::lookAt(eye, eye + viewDirection, upVector);
+    this->fovY = fovY;
+    this->aspect = aspect;
+    this->nearPlane = nearPlane;
+    this->farPlane = farPlane;
+    markProjectionDirty();
+}
+
+void Camera::setAspect(float aspect)
+{
+    if (this->aspect != aspect)
+    {
+        this->aspect = aspect;
+        markProjectionDirty();
+    }
+}
+
+const glm::mat4 &Camera::getViewMatrix()
+{
+    if (viewDirty)
+    {
+        viewMatrix = glm::lookAt(eye, eye + viewDirection, upVector);
+        viewDirty = false;
+    }
+    return viewMatrix;
+}
+
+const glm::mat4 &Camera::getProjectionMatrix()
+{
+    if (projectionDirty)
+    {
+        projectionMatrix = glm::perspective(fovY, aspect, nearPlane, farPlane);
+        projectionDirty = false;
+    }
+    return projectionMatrix;
+}
+
+const glm::mat4 &Camera::getViewProjectionMatrix()
+{
+    if (viewProjectionDirty)
+    {
+        viewProjectionMatrix = getProjectionMatrix() * getViewMatrix();
+        viewProjectionDirty = false;
+    }
+    return viewProjectionMatrix;
+}
+
+const Frustum &Camera::getFrustum()
+{
+    if (frustumDirty)
+    {
+        frustum = ExtractFrustum(getViewProjectionMatrix());
+        frustumDirty = false;
+    }
+    return frustum;
+}
+
+void Camera::markViewDirty()
+{
+    viewDirty = true;
+    viewProjectionDirty = true;
+    frustumDirty = true;
+    version++;
+}
+
+void Camera::markProjectionDirty()
+{
+    projectionDirty = true;
+    viewProjectionDirty = true;
+    frustumDirty = true;
+    version++;
+}
+
+void Camera::setView(const glm::vec3 &eye, const glm::vec3 &viewDirection)
+{
+    this->eye = eye;
+    this->viewDirection = glm::normalize(viewDirection);
+    rightVector = glm::normalize(glm::cross(this->viewDirection, upVector));
+    markViewDirty();
 }
 
 void Camera::mouseLook(int deltaX, int deltaY)
@@ -39,21 +116,27 @@ void Camera::mouseLook(int deltaX, int deltaY)
     viewDirection = glm::normalize(viewDirection);
 
     rightVector = glm::normalize(glm::cross(viewDirection, upVector));
+
+    markViewDirty();
 }
 
 void Camera::moveForward(float speed)
 {
     eye += viewDirection * speed;
+    markViewDirty();
 }
 void Camera::moveBackward(float speed)
 {
     eye -= viewDirection * speed;
+    markViewDirty();
 }
 void Camera::moveLeft(float speed)
 {
     eye -= rightVector * speed;
+    markViewDirty();
 }
 void Camera::moveRight(float speed)
 {
     eye += rightVector * speed;
+    markViewDirty();
 }
\ No newline at end of file
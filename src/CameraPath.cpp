@@ -0,0 +1,123 @@
+#include "CameraPath.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool CameraPath::load(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "Camera path " << path << " could not be opened" << std::endl;
+        return false;
+    }
+
+    mKeys.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        Key key;
+        if (!(fields >> key.mFrame >> key.mEye.x >> key.mEye.y >> key.mEye.z >> key.mDirection.x >> key.mDirection.y >> key.mDirection.z))
+        {
+            std::cout << "Camera path " << path << ": bad key on line " << lineNumber << std::endl;
+            mKeys.clear();
+            return false;
+        }
+        if (!mKeys.empty() && key.mFrame < mKeys.back().mFrame)
+        {
+            std::cout << "Camera path " << path << ": keys out of order on line " << lineNumber << std::endl;
+            mKeys.clear();
+            return false;
+        }
+        mKeys.push_back(key);
+    }
+
+    if (mKeys.empty())
+    {
+        std::cout << "Camera path " << path << " has no keys" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CameraPath::save(const std::string &path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "Camera path " << path << " could not be written" << std::endl;
+        return false;
+    }
+
+    file << "# frame eye.x eye.y eye.z direction.x direction.y direction.z\n";
+    for (const Key &key : mKeys)
+    {
+        file << key.mFrame << " " << key.mEye.x << " " << key.mEye.y << " " << key.mEye.z << " "
+             << key.mDirection.x << " " << key.mDirection.y << " " << key.mDirection.z << "\n";
+    }
+    return (bool)file;
+}
+
+void CameraPath::addKey(float frame, const glm::vec3 &eye, const glm::vec3 &direction)
+{
+    Key key = {frame, eye, direction};
+    mKeys.push_back(key);
+}
+
+void CameraPath::makeFlyover(float length)
+{
+    mKeys.clear();
+
+    // Down the middle, pulling up to see the whole field, across the far
+    // end, then looking back toward the start. Neighbouring directions
+    // are never opposite, so blends never pass straight up or down.
+    addKey(0.0f, glm::vec3(0.0f, 2.0f, 5.0f), glm::vec3(0.0f, -0.15f, -1.0f));
+    addKey(1.0f, glm::vec3(0.2f * length, 6.0f, -0.25f * length), glm::vec3(-0.5f, -0.3f, -1.0f));
+    addKey(2.0f, glm::vec3(0.0f, 12.0f, -0.5f * length), glm::vec3(0.0f, -0.5f, -1.0f));
+    addKey(3.0f, glm::vec3(-0.25f * length, 4.0f, -0.9f * length), glm::vec3(1.0f, -0.1f, 0.2f));
+    addKey(4.0f, glm::vec3(0.0f, 2.0f, -1.05f * length), glm::vec3(0.0f, -0.1f, 1.0f));
+}
+
+void CameraPath::sample(float t, glm::vec3 &eye, glm::vec3 &direction) const
+{
+    if (mKeys.empty())
+    {
+        return;
+    }
+
+    const Key &first = mKeys.front();
+    const Key &last = mKeys.back();
+    float frame = first.mFrame + std::min(std::max(t, 0.0f), 1.0f) * (last.mFrame - first.mFrame);
+
+    // First key after the frame, the segment ends there
+    std::vector<Key>::const_iterator next = std::upper_bound(mKeys.begin(), mKeys.end(), frame, [](float value, const Key &key)
+                                                             { return value < key.mFrame; });
+    if (next == mKeys.end())
+    {
+        eye = last.mEye;
+        direction = glm::normalize(last.mDirection);
+        return;
+    }
+    if (next == mKeys.begin())
+    {
+        eye = first.mEye;
+        direction = glm::normalize(first.mDirection);
+        return;
+    }
+
+    const Key &a = *(next - 1);
+    const Key &b = *next;
+    float blend = (frame - a.mFrame) / (b.mFrame - a.mFrame);
+    eye = glm::mix(a.mEye, b.mEye, blend);
+    direction = glm::normalize(glm::mix(glm::normalize(a.mDirection), glm::normalize(b.mDirection), blend));
+}
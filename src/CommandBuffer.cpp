@@ -0,0 +1,235 @@
+#include "CommandBuffer.hpp"
+#include "RenderQueue.hpp"
+#include "ShaderProgram.hpp"
+#include "StreamBuffer.hpp"
+
+#include <cstring>
+#include <iostream>
+
+void CommandBuffer::reset()
+{
+    mStateCommands.clear();
+    mDraws.clear();
+    mInstances.clear();
+    mObjects.clear();
+}
+
+StateCommand &CommandBuffer::addState(StateCommand::Type type)
+{
+    mStateCommands.emplace_back();
+    mStateCommands.back().mType = type;
+    return mStateCommands.back();
+}
+
+void CommandBuffer::setCapability(uint32_t capability, bool enabled)
+{
+    StateCommand &command = addState(StateCommand::Type::Capability);
+    command.mValue = capability;
+    command.mInts[0] = enabled ? 1 : 0;
+}
+
+void CommandBuffer::setCullFace(uint32_t face)
+{
+    addState(StateCommand::Type::CullFace).mValue = face;
+}
+
+void CommandBuffer::setFrontFace(uint32_t mode)
+{
+    addState(StateCommand::Type::FrontFace).mValue = mode;
+}
+
+void CommandBuffer::setViewport(int x, int y, int width, int height)
+{
+    StateCommand &command = addState(StateCommand::Type::Viewport);
+    command.mInts[0] = x;
+    command.mInts[1] = y;
+    command.mInts[2] = width;
+    command.mInts[3] = height;
+}
+
+void CommandBuffer::setClearColor(float r, float g, float b, float a)
+{
+    StateCommand &command = addState(StateCommand::Type::ClearColor);
+    command.mFloats[0] = r;
+    command.mFloats[1] = g;
+    command.mFloats[2] = b;
+    command.mFloats[3] = a;
+}
+
+void CommandBuffer::clear(uint32_t mask)
+{
+    addState(StateCommand::Type::Clear).mValue = mask;
+}
+
+void CommandBuffer::useProgram(ShaderProgram *program)
+{
+    addState(StateCommand::Type::UseProgram).mProgram = program;
+}
+
+void CommandBuffer::setUniform(ShaderProgram *program, int uniform, const glm::vec3 &value)
+{
+    StateCommand &command = addState(StateCommand::Type::UniformVec3);
+    command.mProgram = program;
+    command.mUniform = uniform;
+    std::memcpy(command.mFloats, &value[0], sizeof(float) * 3);
+}
+
+void CommandBuffer::setUniform(ShaderProgram *program, int uniform, const glm::mat4 &value)
+{
+    StateCommand &command = addState(StateCommand::Type::UniformMat4);
+    command.mProgram = program;
+    command.mUniform = uniform;
+    std::memcpy(command.mFloats, &value[0][0], sizeof(float) * 16);
+}
+
+glm::mat4 *CommandBuffer::allocateInstances(uint32_t count, uint32_t *first)
+{
+    *first = (uint32_t)mInstances.size();
+    mInstances.resize(mInstances.size() + count);
+    return mInstances.data() + *first;
+}
+
+int32_t CommandBuffer::addObject(const ObjectBlock &object)
+{
+    mObjects.push_back(object);
+    return (int32_t)mObjects.size() - 1;
+}
+
+void CommandBuffer::draw(const DrawCommand &command)
+{
+    mDraws.push_back(command);
+}
+
+static void ApplyState(const StateCommand &command, GLStateCache &state)
+{
+    switch (command.mType)
+    {
+    case StateCommand::Type::Capability:
+        state.setEnabled(command.mValue, command.mInts[0] != 0);
+        break;
+    case StateCommand::Type::CullFace:
+        state.setCullFace(command.mValue);
+        break;
+    case StateCommand::Type::FrontFace:
+        state.setFrontFace(command.mValue);
+        break;
+    case StateCommand::Type::Viewport:
+        state.setViewport(command.mInts[0], command.mInts[1], command.mInts[2], command.mInts[3]);
+        break;
+    case StateCommand::Type::ClearColor:
+        state.setClearColor(command.mFloats[0], command.mFloats[1], command.mFloats[2], command.mFloats[3]);
+        break;
+    case StateCommand::Type::Clear:
+        glClear(command.mValue);
+        break;
+    case StateCommand::Type::UseProgram:
+        state.useProgram(command.mProgram->getProgram());
+        break;
+    case StateCommand::Type::UniformVec3:
+        // Uniform uploads go to the bound program
+        state.useProgram(command.mProgram->getProgram());
+        command.mProgram->setVec3(command.mUniform, glm::vec3(command.mFloats[0], command.mFloats[1], command.mFloats[2]));
+        break;
+    case StateCommand::Type::UniformMat4:
+    {
+        state.useProgram(command.mProgram->getProgram());
+        glm::mat4 value;
+        std::memcpy(&value[0][0], command.mFloats, sizeof(float) * 16);
+        command.mProgram->setMat4(command.mUniform, value);
+        break;
+    }
+    }
+}
+
+void ReplayCommandBuffers(const CommandBuffer *buffers, size_t count, RenderQueue &queue, RenderBackend &backend, StreamBuffer &instances, StreamBuffer &uniforms)
+{
+    size_t instanceCount = 0;
+    size_t objectCount = 0;
+    for (size_t b = 0; b < count; b++)
+    {
+        for (const StateCommand &command : buffers[b].getStateCommands())
+        {
+            ApplyState(command, backend.getState());
+        }
+        instanceCount += buffers[b].getInstances().size();
+        objectCount += buffers[b].getObjects().size();
+    }
+
+    // One allocation for the frame, buffers are laid out back to back
+    GLintptr instanceBase = 0;
+    unsigned char *instanceData = nullptr;
+    if (instanceCount > 0)
+    {
+        instanceData = (unsigned char *)instances.allocate(sizeof(glm::mat4) * instanceCount, sizeof(glm::vec4), &instanceBase);
+        if (instanceData == nullptr)
+        {
+            std::cout << "Instance data doesn't fit the stream buffer, instanced draws skipped" << std::endl;
+        }
+    }
+
+    // Objects get a range each, padded to the binding alignment
+    GLsizeiptr objectStride = GetObjectBlockStride();
+    GLintptr objectBase = 0;
+    unsigned char *objectData = nullptr;
+    if (objectCount > 0)
+    {
+        objectData = (unsigned char *)uniforms.allocate(objectStride * objectCount, GetUniformBufferAlignment(), &objectBase);
+        if (objectData == nullptr)
+        {
+            std::cout << "Object data doesn't fit the uniform buffer, draws with object data skipped" << std::endl;
+        }
+    }
+
+    queue.clear();
+    GLintptr bufferOffset = 0;
+    GLintptr objectOffset = 0;
+    for (size_t b = 0; b < count; b++)
+    {
+        const std::vector<glm::mat4> &bufferInstances = buffers[b].getInstances();
+        if (instanceData != nullptr && !bufferInstances.empty())
+        {
+            std::memcpy(instanceData + bufferOffset, bufferInstances.data(), sizeof(glm::mat4) * bufferInstances.size());
+        }
+
+        const std::vector<ObjectBlock> &bufferObjects = buffers[b].getObjects();
+        for (size_t i = 0; objectData != nullptr && i < bufferObjects.size(); i++)
+        {
+            std::memcpy(objectData + objectOffset + objectStride * i, &bufferObjects[i], sizeof(ObjectBlock));
+        }
+
+        for (const DrawCommand &draw : buffers[b].getDraws())
+        {
+            if ((draw.mInstanceCount > 0 && instanceData == nullptr) || (draw.mObject >= 0 && objectData == nullptr))
+            {
+                continue;
+            }
+
+            DrawPacket packet;
+            packet.mKey = draw.mKey;
+            packet.mProgram = draw.mProgram;
+            packet.mVertexArray = draw.mVertexArray;
+            packet.mIndexType = draw.mIndexType;
+            packet.mIndexCount = draw.mIndexCount;
+            packet.mIndexOffset = draw.mIndexOffset;
+            packet.mCullBackFaces = draw.mCullBackFaces;
+            packet.mInstanceCount = draw.mInstanceCount;
+            packet.mInstanceBuffer = draw.mInstanceCount > 0 ? instances.getBuffer() : 0;
+            packet.mInstanceOffset = instanceBase + bufferOffset + sizeof(glm::mat4) * draw.mFirstInstance;
+            packet.mObjectBuffer = draw.mObject >= 0 ? uniforms.getBuffer() : 0;
+            packet.mObjectOffset = objectBase + objectOffset + objectStride * draw.mObject;
+            queue.submit(packet);
+        }
+
+        bufferOffset += sizeof(glm::mat4) * bufferInstances.size();
+        objectOffset += objectStride * bufferObjects.size();
+    }
+
+    if (instanceData != nullptr)
+    {
+        instances.commit();
+    }
+    uniforms.commit();
+
+    queue.sort();
+    backend.execute(queue);
+}
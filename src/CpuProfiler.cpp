@@ -0,0 +1,157 @@
+#include "CpuProfiler.hpp"
+
+#ifdef ENABLE_CPU_PROFILER
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// One zone. mSequence is the zone's index plus one once it is complete,
+// and 0 while the slot is being rewritten.
+struct CpuZoneSlot
+{
+    std::atomic<uint64_t> mSequence{0};
+    std::atomic<const char *> mName{nullptr};
+    std::atomic<uint64_t> mBegin{0};
+    std::atomic<uint64_t> mEnd{0};
+};
+
+struct CpuThreadRing
+{
+    // Guarded by gRingMutex
+    std::string mName;
+
+    // Only written by the owning thread
+    uint64_t mWritten = 0;
+    std::unique_ptr<CpuZoneSlot[]> mSlots{new CpuZoneSlot[gCpuProfilerEvents]};
+};
+
+struct CpuZone
+{
+    const char *mName;
+    uint64_t mBegin;
+    uint64_t mEnd;
+};
+
+static const std::chrono::steady_clock::time_point gCpuProfilerEpoch = std::chrono::steady_clock::now();
+
+// Rings live until exit, threads that finished still show in traces
+static std::mutex gRingMutex;
+static std::vector<std::unique_ptr<CpuThreadRing>> gRings;
+
+static thread_local CpuThreadRing *tRing = nullptr;
+
+static CpuThreadRing *GetThreadRing()
+{
+    if (tRing == nullptr)
+    {
+        std::unique_ptr<CpuThreadRing> ring(new CpuThreadRing());
+        std::lock_guard<std::mutex> lock(gRingMutex);
+        ring->mName = "Thread " + std::to_string(gRings.size());
+        tRing = ring.get();
+        gRings.push_back(std::move(ring));
+    }
+    return tRing;
+}
+
+uint64_t CpuProfilerNow()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - gCpuProfilerEpoch).count();
+}
+
+void CpuProfilerRecord(const char *name, uint64_t begin, uint64_t end)
+{
+    CpuThreadRing *ring = GetThreadRing();
+    uint64_t index = ring->mWritten++;
+    CpuZoneSlot &slot = ring->mSlots[index & (gCpuProfilerEvents - 1)];
+
+    // Readers that see the old sequence after their copy drop the slot
+    slot.mSequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.mName.store(name, std::memory_order_relaxed);
+    slot.mBegin.store(begin, std::memory_order_relaxed);
+    slot.mEnd.store(end, std::memory_order_relaxed);
+    slot.mSequence.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfilerSetThreadName(const std::string &name)
+{
+    CpuThreadRing *ring = GetThreadRing();
+    std::lock_guard<std::mutex> lock(gRingMutex);
+    ring->mName = name;
+}
+
+// Complete zones of a ring, in no particular order
+static void CopyZones(const CpuThreadRing &ring, uint64_t since, std::vector<CpuZone> &zones)
+{
+    for (uint32_t i = 0; i < gCpuProfilerEvents; i++)
+    {
+        const CpuZoneSlot &slot = ring.mSlots[i];
+        uint64_t sequence = slot.mSequence.load(std::memory_order_acquire);
+        if (sequence == 0)
+        {
+            continue;
+        }
+
+        CpuZone zone;
+        zone.mName = slot.mName.load(std::memory_order_relaxed);
+        zone.mBegin = slot.mBegin.load(std::memory_order_relaxed);
+        zone.mEnd = slot.mEnd.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.mSequence.load(std::memory_order_relaxed) != sequence || zone.mEnd < since)
+        {
+            continue;
+        }
+        zones.push_back(zone);
+    }
+}
+
+bool CpuProfilerWriteTrace(const std::string &path, double lastMilliseconds)
+{
+    uint64_t now = CpuProfilerNow();
+    uint64_t window = (uint64_t)(lastMilliseconds * 1000000.0);
+    uint64_t since = lastMilliseconds > 0.0 && window < now ? now - window : 0;
+
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "Could not write CPU trace to " << path << std::endl;
+        return false;
+    }
+
+    // Timestamps in microseconds, the trace_event unit
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    std::vector<CpuZone> zones;
+
+    std::lock_guard<std::mutex> lock(gRingMutex);
+    for (size_t thread = 0; thread < gRings.size(); thread++)
+    {
+        const CpuThreadRing &ring = *gRings[thread];
+        file << (first ? "" : ",\n") << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": " << thread
+             << ", \"args\": {\"name\": \"" << ring.mName << "\"}}";
+        first = false;
+
+        zones.clear();
+        CopyZones(ring, since, zones);
+        std::sort(zones.begin(), zones.end(), [](const CpuZone &a, const CpuZone &b)
+                  { return a.mBegin < b.mBegin; });
+
+        for (const CpuZone &zone : zones)
+        {
+            file << ",\n{\"ph\": \"X\", \"name\": \"" << zone.mName << "\", \"pid\": 1, \"tid\": " << thread
+                 << ", \"ts\": " << zone.mBegin / 1000.0 << ", \"dur\": " << (zone.mEnd - zone.mBegin) / 1000.0 << "}";
+        }
+    }
+    file << "\n]}\n";
+    return (bool)file;
+}
+
+#endif
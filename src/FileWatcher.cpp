@@ -0,0 +1,147 @@
+#include "FileWatcher.hpp"
+
+#include <chrono>
+#include <iostream>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// How often the thread checks for stop() or polls the write times
+const int gFileWatchIntervalMs = 250;
+
+FileWatcher::FileWatcher()
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+    stop();
+}
+
+bool FileWatcher::start(const std::string &directory)
+{
+    stop();
+    mDirectory = directory;
+    mStopping = false;
+
+#if defined(__linux__)
+    mInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mInotify < 0)
+    {
+        std::cout << "Could not create inotify instance" << std::endl;
+        return false;
+    }
+
+    // Editors often save by renaming a temporary file over the original
+    if (inotify_add_watch(mInotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        std::cout << "Could not watch " << directory << std::endl;
+        close(mInotify);
+        mInotify = -1;
+        return false;
+    }
+#else
+    std::error_code error;
+    for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        mWriteTimes[entry.path().filename().string()] = entry.last_write_time(error);
+    }
+    if (error)
+    {
+        std::cout << "Could not watch " << directory << std::endl;
+        return false;
+    }
+#endif
+
+    mThread = std::thread(&FileWatcher::threadMain, this);
+    return true;
+}
+
+void FileWatcher::stop()
+{
+    mStopping = true;
+    if (mThread.joinable())
+    {
+        mThread.join();
+    }
+
+#if defined(__linux__)
+    if (mInotify >= 0)
+    {
+        close(mInotify);
+        mInotify = -1;
+    }
+#else
+    mWriteTimes.clear();
+#endif
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mChanged.clear();
+}
+
+void FileWatcher::takeChanges(std::vector<std::string> &files)
+{
+    files.clear();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    files.assign(mChanged.begin(), mChanged.end());
+    mChanged.clear();
+}
+
+void FileWatcher::addChange(const std::string &file)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mChanged.insert(file);
+}
+
+void FileWatcher::threadMain()
+{
+#if defined(__linux__)
+    alignas(inotify_event) char buffer[4096];
+
+    while (!mStopping)
+    {
+        pollfd descriptor = {mInotify, POLLIN, 0};
+        if (poll(&descriptor, 1, gFileWatchIntervalMs) <= 0)
+        {
+            continue;
+        }
+
+        ssize_t length;
+        while ((length = read(mInotify, buffer, sizeof(buffer))) > 0)
+        {
+            for (char *next = buffer; next < buffer + length;)
+            {
+                const inotify_event *event = (const inotify_event *)next;
+                if (event->len > 0)
+                {
+                    addChange(event->name);
+                }
+                next += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+#else
+    while (!mStopping)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(gFileWatchIntervalMs));
+
+        std::error_code error;
+        for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(mDirectory, error))
+        {
+            std::filesystem::file_time_type time = entry.last_write_time(error);
+            std::string name = entry.path().filename().string();
+
+            std::map<std::string, std::filesystem::file_time_type>::iterator it = mWriteTimes.find(name);
+            if (it == mWriteTimes.end() || it->second != time)
+            {
+                mWriteTimes[name] = time;
+                addChange(name);
+            }
+        }
+    }
+#endif
+}
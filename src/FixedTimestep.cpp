@@ -0,0 +1,34 @@
+#include "FixedTimestep.hpp"
+
+#include <cmath>
+
+FixedTimestep::FixedTimestep(double step, int maxSteps)
+    : mStep(step), mMaxSteps(maxSteps)
+{
+}
+
+int FixedTimestep::advance(double elapsed)
+{
+    if (elapsed > 0.0)
+    {
+        mAccumulator += elapsed;
+    }
+
+    int steps = 0;
+    while (mAccumulator >= mStep && steps < mMaxSteps)
+    {
+        mAccumulator -= mStep;
+        steps++;
+    }
+
+    // Only the part of a step past the last whole one is kept
+    if (mAccumulator >= mStep)
+    {
+        double remainder = std::fmod(mAccumulator, mStep);
+        mDroppedTime += mAccumulator - remainder;
+        mAccumulator = remainder;
+    }
+
+    mStepCount += steps;
+    return steps;
+}
@@ -0,0 +1,116 @@
+#include "FrameArena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena()
+{
+}
+
+FrameArena::~FrameArena()
+{
+    destroy();
+}
+
+void FrameArena::create(size_t capacity)
+{
+    destroy();
+
+    mMemory.reset(new unsigned char[capacity]);
+    mCapacity = capacity;
+}
+
+void FrameArena::destroy()
+{
+    mMemory.reset();
+    mCapacity = 0;
+    mUsed = 0;
+    mOverflow.clear();
+    mOverflowUsed = 0;
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment)
+{
+    uintptr_t base = (uintptr_t)mMemory.get();
+    size_t offset = (size_t)(((base + mUsed + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base);
+    if (mMemory && offset + size <= mCapacity)
+    {
+        mUsed = offset + size;
+        return mMemory.get() + offset;
+    }
+
+    // Too big for what is left, a block of its own until the reset
+    mOverflow.emplace_back(new unsigned char[size + alignment]);
+    mOverflowUsed += size;
+    uintptr_t address = (uintptr_t)mOverflow.back().get();
+    return (void *)((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+void FrameArena::reset()
+{
+    size_t used = mUsed + mOverflowUsed;
+    mPeak = std::max(mPeak, used);
+
+    if (!mOverflow.empty())
+    {
+        // Grow with headroom, alignment padding isn't counted in used
+        mOverflowCount++;
+        mOverflow.clear();
+        mOverflowUsed = 0;
+        create(used + used / 4);
+    }
+    mUsed = 0;
+}
+
+void FrameArenas::create(size_t threadCount, size_t capacity)
+{
+    mArenas.clear();
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        mArenas.emplace_back(new FrameArena());
+        mArenas.back()->create(capacity);
+    }
+}
+
+void FrameArenas::destroy()
+{
+    mArenas.clear();
+}
+
+void FrameArenas::reset()
+{
+    for (std::unique_ptr<FrameArena> &arena : mArenas)
+    {
+        arena->reset();
+    }
+}
+
+size_t FrameArenas::getCapacity() const
+{
+    size_t capacity = 0;
+    for (const std::unique_ptr<FrameArena> &arena : mArenas)
+    {
+        capacity += arena->getCapacity();
+    }
+    return capacity;
+}
+
+size_t FrameArenas::getPeak() const
+{
+    size_t peak = 0;
+    for (const std::unique_ptr<FrameArena> &arena : mArenas)
+    {
+        peak += arena->getPeak();
+    }
+    return peak;
+}
+
+unsigned long long FrameArenas::getOverflowCount() const
+{
+    unsigned long long count = 0;
+    for (const std::unique_ptr<FrameArena> &arena : mArenas)
+    {
+        count += arena->getOverflowCount();
+    }
+    return count;
+}
@@ -0,0 +1,162 @@
+#include "FramePacer.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <iostream>
+#include <thread>
+
+// Below this much remaining time the limiter spins instead of sleeping,
+// OS sleeps routinely overshoot by a millisecond or more
+const std::chrono::microseconds gSpinThreshold(2000);
+
+FramePacer::FramePacer()
+    : mFramePeriod(std::chrono::microseconds(16667))
+{
+}
+
+void FramePacer::initialize(Mode mode, double targetFPS)
+{
+    mTargetFPS = targetFPS;
+    mFrameBudget = 1000.0 / targetFPS;
+    mFramePeriod = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(mFrameBudget));
+
+    setMode(mode);
+}
+
+void FramePacer::setMode(Mode mode)
+{
+    mMode = mode;
+    mHasDeadline = false;
+
+    int interval = 0;
+    if (mode == Mode::VSync)
+    {
+        interval = 1;
+    }
+    else if (mode == Mode::AdaptiveVSync)
+    {
+        interval = -1;
+    }
+
+    if (SDL_GL_SetSwapInterval(interval) != 0)
+    {
+        if (mode == Mode::AdaptiveVSync)
+        {
+            std::cout << "Adaptive vsync not supported, using vsync" << std::endl;
+            mMode = Mode::VSync;
+            SDL_GL_SetSwapInterval(1);
+        }
+        else
+        {
+            std::cout << "Could not set swap interval: " << SDL_GetError() << std::endl;
+        }
+    }
+
+    std::cout << "Frame pacing: " << getModeName(mMode) << std::endl;
+}
+
+void FramePacer::cycleMode()
+{
+    switch (mMode)
+    {
+    case Mode::VSync:
+        setMode(Mode::AdaptiveVSync);
+        break;
+    case Mode::AdaptiveVSync:
+        setMode(Mode::Limited);
+        break;
+    case Mode::Limited:
+        setMode(Mode::Uncapped);
+        break;
+    case Mode::Uncapped:
+        setMode(Mode::VSync);
+        break;
+    }
+}
+
+void FramePacer::beginFrame()
+{
+    Clock::time_point now = Clock::now();
+    if (mHasFrameStart)
+    {
+        double frameTime = std::chrono::duration<double, std::milli>(now - mFrameStart).count();
+        mFrameTimes.add(frameTime);
+
+        // Allow a small tolerance so vsync jitter isn't counted as a miss
+        if (frameTime > mFrameBudget * 1.05)
+        {
+            mFramesOverBudget++;
+        }
+    }
+    mFrameStart = now;
+    mHasFrameStart = true;
+
+    if (!mHasDeadline)
+    {
+        mDeadline = mFrameStart + mFramePeriod;
+        mHasDeadline = true;
+    }
+}
+
+void FramePacer::endFrame()
+{
+    Clock::time_point workEnd = Clock::now();
+    mWorkTimes.add(std::chrono::duration<double, std::milli>(workEnd - mFrameStart).count());
+
+    if (mMode == Mode::Limited)
+    {
+        if (workEnd < mDeadline)
+        {
+            waitUntil(mDeadline);
+            mDeadline += mFramePeriod;
+        }
+        else
+        {
+            // Too late to catch up, restart the schedule from now
+            mDeadline = workEnd + mFramePeriod;
+        }
+    }
+}
+
+void FramePacer::waitUntil(Clock::time_point deadline)
+{
+    Clock::time_point now = Clock::now();
+
+    if (deadline - now > gSpinThreshold)
+    {
+        std::this_thread::sleep_for(deadline - now - gSpinThreshold);
+    }
+
+    while (Clock::now() < deadline)
+    {
+        std::this_thread::yield();
+    }
+}
+
+void FramePacer::printReport(std::ostream &out) const
+{
+    out << "Frame times (" << getModeName(mMode) << ", last " << mFrameTimes.getCount() << " frames): "
+        << "min " << mFrameTimes.getMin() << " ms, "
+        << "avg " << mFrameTimes.getAverage() << " ms, "
+        << "p99 " << mFrameTimes.getPercentile(99.0) << " ms, "
+        << "max " << mFrameTimes.getMax() << " ms, "
+        << "work avg " << mWorkTimes.getAverage() << " ms, "
+        << mFramesOverBudget << " of " << mFrameTimes.getTotalCount() << " frames over " << mFrameBudget << " ms"
+        << std::endl;
+}
+
+const char *FramePacer::getModeName(Mode mode)
+{
+    switch (mode)
+    {
+    case Mode::VSync:
+        return "vsync";
+    case Mode::AdaptiveVSync:
+        return "adaptive vsync";
+    case Mode::Limited:
+        return "limited";
+    case Mode::Uncapped:
+        return "uncapped";
+    }
+    return "unknown";
+}
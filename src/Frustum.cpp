@@ -0,0 +1,29 @@
+#include "Frustum.hpp"
+
+Frustum ExtractFrustum(const glm::mat4 &viewProjection)
+{
+    const glm::mat4 &m = viewProjection;
+
+    // Rows of the column-major matrix
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.mPlanes[Frustum::Left] = row3 + row0;
+    frustum.mPlanes[Frustum::Right] = row3 - row0;
+    frustum.mPlanes[Frustum::Bottom] = row3 + row1;
+    frustum.mPlanes[Frustum::Top] = row3 - row1;
+    frustum.mPlanes[Frustum::Near] = row3 + row2;
+    frustum.mPlanes[Frustum::Far] = row3 - row2;
+
+    // Normalize so plane distances are in world units
+    for (glm::vec4 &plane : frustum.mPlanes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        plane = plane / length;
+    }
+
+    return frustum;
+}
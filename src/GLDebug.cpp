@@ -0,0 +1,109 @@
+#include "GLDebug.hpp"
+
+#ifdef ENABLE_GL_DEBUG
+
+#include <iostream>
+#include <string>
+
+bool gGLDebugCallbackActive = false;
+
+void GLClearError()
+{
+    while (glGetError() != GL_NO_ERROR)
+        ;
+}
+
+bool GLCheckError(const char *function, const char *file, int line)
+{
+    bool hadError = false;
+    while (GLenum error = glGetError())
+    {
+        std::cout << "OpenGL Error: " << error << ", File: " << file << ", Line: " << line << ", Function: " << function << std::endl;
+        hadError = true;
+    }
+    return hadError;
+}
+
+static const char *DebugSourceName(GLenum source)
+{
+    switch (source)
+    {
+    case GL_DEBUG_SOURCE_API:
+        return "API";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
+        return "Window System";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER:
+        return "Shader Compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY:
+        return "Third Party";
+    case GL_DEBUG_SOURCE_APPLICATION:
+        return "Application";
+    default:
+        return "Other";
+    }
+}
+
+static const char *DebugTypeName(GLenum type)
+{
+    switch (type)
+    {
+    case GL_DEBUG_TYPE_ERROR:
+        return "Error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+        return "Deprecated";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+        return "Undefined Behavior";
+    case GL_DEBUG_TYPE_PORTABILITY:
+        return "Portability";
+    case GL_DEBUG_TYPE_PERFORMANCE:
+        return "Performance";
+    default:
+        return "Other";
+    }
+}
+
+static const char *DebugSeverityName(GLenum severity)
+{
+    switch (severity)
+    {
+    case GL_DEBUG_SEVERITY_HIGH:
+        return "High";
+    case GL_DEBUG_SEVERITY_MEDIUM:
+        return "Medium";
+    case GL_DEBUG_SEVERITY_LOW:
+        return "Low";
+    default:
+        return "Notification";
+    }
+}
+
+static void APIENTRY GLDebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *message, const void *)
+{
+    std::cout << "OpenGL " << DebugSeverityName(severity) << " " << DebugTypeName(type)
+              << " (" << DebugSourceName(source) << ", " << id << "): "
+              << std::string(message, length) << std::endl;
+}
+
+bool InitializeGLDebug()
+{
+    if (!GLAD_GL_KHR_debug)
+    {
+        std::cout << "GL_KHR_debug not available, GLCheck uses glGetError" << std::endl;
+        gGLDebugCallbackActive = false;
+        return false;
+    }
+
+    glEnable(GL_DEBUG_OUTPUT);
+
+    // Report from inside the failing call so a breakpoint shows the caller
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDebugMessageCallback(GLDebugCallback, nullptr);
+
+    // Notifications are mostly buffer placement chatter
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+
+    gGLDebugCallbackActive = true;
+    return true;
+}
+
+#endif
@@ -0,0 +1,168 @@
+#include "GLStateCache.hpp"
+
+#include <cstring>
+
+void GLStateCache::invalidate()
+{
+    for (int i = 0; i < CapabilityCount; i++)
+    {
+        mEnabledKnown[i] = false;
+    }
+    mCullFaceKnown = false;
+    mFrontFaceKnown = false;
+    mDepthFuncKnown = false;
+    mDepthMaskKnown = false;
+    mColorMaskKnown = false;
+    mViewportKnown = false;
+    mClearColorKnown = false;
+    mProgramKnown = false;
+    mVertexArrayKnown = false;
+}
+
+void GLStateCache::resetCounters()
+{
+    mCalls = 0;
+    mSkipped = 0;
+}
+
+template <typename T>
+bool GLStateCache::change(T &current, bool &known, const T &value)
+{
+    if (known && current == value)
+    {
+        mSkipped++;
+        return false;
+    }
+    current = value;
+    known = true;
+    mCalls++;
+    return true;
+}
+
+int GLStateCache::getCapabilityIndex(GLenum capability)
+{
+    switch (capability)
+    {
+    case GL_DEPTH_TEST:
+        return DepthTest;
+    case GL_CULL_FACE:
+        return CullFace;
+    case GL_BLEND:
+        return Blend;
+    case GL_SCISSOR_TEST:
+        return ScissorTest;
+    case GL_POLYGON_OFFSET_FILL:
+        return PolygonOffsetFill;
+    default:
+        return -1;
+    }
+}
+
+void GLStateCache::setEnabled(GLenum capability, bool enabled)
+{
+    int index = getCapabilityIndex(capability);
+
+    // Capabilities that aren't shadowed always go through
+    if (index >= 0 && !change(mEnabled[index], mEnabledKnown[index], enabled))
+    {
+        return;
+    }
+    if (index < 0)
+    {
+        mCalls++;
+    }
+
+    if (enabled)
+    {
+        glEnable(capability);
+    }
+    else
+    {
+        glDisable(capability);
+    }
+}
+
+void GLStateCache::setCullFace(GLenum face)
+{
+    if (change(mCullFace, mCullFaceKnown, face))
+    {
+        glCullFace(face);
+    }
+}
+
+void GLStateCache::setFrontFace(GLenum mode)
+{
+    if (change(mFrontFace, mFrontFaceKnown, mode))
+    {
+        glFrontFace(mode);
+    }
+}
+
+void GLStateCache::setDepthFunc(GLenum func)
+{
+    if (change(mDepthFunc, mDepthFuncKnown, func))
+    {
+        glDepthFunc(func);
+    }
+}
+
+void GLStateCache::setDepthMask(bool write)
+{
+    if (change(mDepthMask, mDepthMaskKnown, write))
+    {
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+}
+
+void GLStateCache::setColorMask(bool write)
+{
+    if (change(mColorMask, mColorMaskKnown, write))
+    {
+        GLboolean mask = write ? GL_TRUE : GL_FALSE;
+        glColorMask(mask, mask, mask, mask);
+    }
+}
+
+void GLStateCache::setViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GLint viewport[4] = {x, y, width, height};
+    if (mViewportKnown && std::memcmp(mViewport, viewport, sizeof(viewport)) == 0)
+    {
+        mSkipped++;
+        return;
+    }
+    std::memcpy(mViewport, viewport, sizeof(viewport));
+    mViewportKnown = true;
+    mCalls++;
+    glViewport(x, y, width, height);
+}
+
+void GLStateCache::setClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+    GLfloat color[4] = {r, g, b, a};
+    if (mClearColorKnown && std::memcmp(mClearColor, color, sizeof(color)) == 0)
+    {
+        mSkipped++;
+        return;
+    }
+    std::memcpy(mClearColor, color, sizeof(color));
+    mClearColorKnown = true;
+    mCalls++;
+    glClearColor(r, g, b, a);
+}
+
+void GLStateCache::useProgram(GLuint program)
+{
+    if (change(mProgram, mProgramKnown, program))
+    {
+        glUseProgram(program);
+    }
+}
+
+void GLStateCache::bindVertexArray(GLuint vertexArray)
+{
+    if (change(mVertexArray, mVertexArrayKnown, vertexArray))
+    {
+        glBindVertexArray(vertexArray);
+    }
+}
@@ -0,0 +1,351 @@
+#include "GpuCuller.hpp"
+#include "Frustum.hpp"
+#include "GLStateCache.hpp"
+#include "ShaderProgram.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+GpuCuller::GpuCuller()
+{
+}
+
+GpuCuller::~GpuCuller()
+{
+    destroy();
+}
+
+GLuint GpuCuller::linkCullProgram(const std::string &vertexSource, const std::string &geometrySource) const
+{
+    GLuint program = glCreateProgram();
+    GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource);
+    glAttachShader(program, vertexShader);
+
+    GLuint geometryShader = 0;
+    if (mCompact)
+    {
+        geometryShader = CompileShader(GL_GEOMETRY_SHADER, geometrySource);
+        glAttachShader(program, geometryShader);
+    }
+
+    // Captured interleaved, one mat4 per instance
+    const char *vertexVaryings[] = {"cullModel0", "cullModel1", "cullModel2", "cullModel3"};
+    const char *geometryVaryings[] = {"culledModel0", "culledModel1", "culledModel2", "culledModel3"};
+    glTransformFeedbackVaryings(program, 4, mCompact ? geometryVaryings : vertexVaryings, GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(program);
+
+    glDetachShader(program, vertexShader);
+    glDeleteShader(vertexShader);
+    if (geometryShader != 0)
+    {
+        glDetachShader(program, geometryShader);
+        glDeleteShader(geometryShader);
+    }
+
+    GLint isLinked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+    if (isLinked == GL_FALSE)
+    {
+        GLint maxLength = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+
+        std::vector<char> infoLog(std::max(maxLength, 1));
+        glGetProgramInfoLog(program, maxLength, &maxLength, &infoLog[0]);
+        glDeleteProgram(program);
+
+        std::cout << "Cull program linking error: " << std::string(infoLog.begin(), infoLog.end()) << std::endl;
+        exit(1);
+    }
+    return program;
+}
+
+void GpuCuller::create(const GpuCullSources &sources, int width, int height)
+{
+    destroy();
+
+    mCompact = GLAD_GL_ARB_query_buffer_object != 0;
+    mCullProgram = linkCullProgram(sources.mCullVertex, sources.mCullGeometry);
+    mFrustumPlanesUniform = glGetUniformLocation(mCullProgram, "uFrustumPlanes");
+    mMeshSphereUniform = glGetUniformLocation(mCullProgram, "uMeshSphere");
+    mUseHiZUniform = glGetUniformLocation(mCullProgram, "uUseHiZ");
+    mHiZSizeUniform = glGetUniformLocation(mCullProgram, "uHiZSize");
+    mHiZLevelsUniform = glGetUniformLocation(mCullProgram, "uHiZLevels");
+    mPreviousViewProjectionUniform = glGetUniformLocation(mCullProgram, "uPreviousViewProjection");
+    glUseProgram(mCullProgram);
+    glUniform1i(glGetUniformLocation(mCullProgram, "uHiZ"), (GLint)gHiZTextureUnit);
+
+    mHiZProgram = CreateShaderProgram(sources.mHiZVertex, sources.mHiZFragment);
+    mHiZReduceUniform = glGetUniformLocation(mHiZProgram, "uReduce");
+    glUseProgram(mHiZProgram);
+    glUniform1i(glGetUniformLocation(mHiZProgram, "uSource"), (GLint)gHiZTextureUnit);
+    glUseProgram(0);
+
+    glGenVertexArrays(1, &mCullVertexArray);
+    glGenVertexArrays(1, &mEmptyVertexArray);
+    glGenBuffers(1, &mInputBuffer);
+    glGenBuffers(1, &mCulledBuffer);
+
+    // One point per instance, its four matrix columns are the attributes
+    glBindVertexArray(mCullVertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, mInputBuffer);
+    for (GLuint column = 0; column < 4; column++)
+    {
+        glVertexAttribPointer(column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void *)(sizeof(glm::vec4) * column));
+        glEnableVertexAttribArray(column);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &mIndirectBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    if (mCompact)
+    {
+        glGenQueries(1, &mWrittenQuery);
+    }
+
+    createPyramid(width, height);
+    std::cout << "GPU culling: " << (mCompact ? "compacted with query buffer" : "collapsed instances") << ", Hi-Z levels " << mHiZLevels << std::endl;
+}
+
+void GpuCuller::resize(int width, int height)
+{
+    if (mCullProgram == 0 || (width == mWidth && height == mHeight))
+    {
+        return;
+    }
+    destroyPyramid();
+    createPyramid(width, height);
+}
+
+void GpuCuller::createPyramid(int width, int height)
+{
+    // Depth is copied with a blit, the default framebuffer can't be sampled
+    mWidth = width;
+    mHeight = height;
+    glGenTextures(1, &mDepthTexture);
+    glBindTexture(GL_TEXTURE_2D, mDepthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+    glGenFramebuffers(1, &mDepthFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, mDepthFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mDepthTexture, 0);
+
+    mHiZLevels = 1;
+    while ((std::max(width, height) >> mHiZLevels) > 0)
+    {
+        mHiZLevels++;
+    }
+
+    glGenTextures(1, &mHiZTexture);
+    glBindTexture(GL_TEXTURE_2D, mHiZTexture);
+    for (int level = 0; level < mHiZLevels; level++)
+    {
+        glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, std::max(width >> level, 1), std::max(height >> level, 1), 0, GL_RED, GL_FLOAT, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mHiZLevels - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &mHiZFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    mHiZValid = false;
+}
+
+void GpuCuller::destroyPyramid()
+{
+    glDeleteFramebuffers(1, &mDepthFramebuffer);
+    glDeleteFramebuffers(1, &mHiZFramebuffer);
+    glDeleteTextures(1, &mDepthTexture);
+    glDeleteTextures(1, &mHiZTexture);
+
+    mDepthFramebuffer = 0;
+    mHiZFramebuffer = 0;
+    mDepthTexture = 0;
+    mHiZTexture = 0;
+    mWidth = 0;
+    mHeight = 0;
+    mHiZLevels = 0;
+    mHiZValid = false;
+}
+
+void GpuCuller::destroy()
+{
+    if (mCullProgram == 0)
+    {
+        return;
+    }
+
+    glDeleteProgram(mCullProgram);
+    glDeleteProgram(mHiZProgram);
+    glDeleteVertexArrays(1, &mCullVertexArray);
+    glDeleteVertexArrays(1, &mEmptyVertexArray);
+    glDeleteBuffers(1, &mInputBuffer);
+    glDeleteBuffers(1, &mCulledBuffer);
+    glDeleteBuffers(1, &mIndirectBuffer);
+    glDeleteQueries(1, &mWrittenQuery);
+    destroyPyramid();
+
+    mCullProgram = 0;
+    mHiZProgram = 0;
+    mCullVertexArray = 0;
+    mEmptyVertexArray = 0;
+    mInputBuffer = 0;
+    mCulledBuffer = 0;
+    mCapacity = 0;
+    mIndirectBuffer = 0;
+    mWrittenQuery = 0;
+}
+
+void GpuCuller::reserve(GLsizei count)
+{
+    if (count <= mCapacity)
+    {
+        return;
+    }
+    mCapacity = std::max(count, mCapacity * 2);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mCulledBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * mCapacity, nullptr, GL_DYNAMIC_COPY);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mInputBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * mCapacity, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GpuCuller::cull(GLStateCache &state, const Mesh3D &mesh, const glm::mat4 *models, GLsizei count, const glm::mat4 &viewProjection)
+{
+    reserve(count);
+
+    // Orphan last frame's input so the upload doesn't wait on it
+    glBindBuffer(GL_ARRAY_BUFFER, mInputBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * mCapacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::mat4) * count, models);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // LOD 0 of the mesh. The instance count is final here unless the
+    // query below overwrites it.
+    GLsizei indexCount = 0;
+    uintptr_t indexOffset = 0;
+    GetMeshLodRange(mesh, 0, &indexCount, &indexOffset);
+    DrawElementsIndirectCommand command;
+    command.mCount = (GLuint)indexCount;
+    command.mInstanceCount = (GLuint)count;
+    command.mFirstIndex = (GLuint)(indexOffset / GetIndexSize(mesh.mIndexType));
+    command.mBaseVertex = 0;
+    command.mBaseInstance = 0;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), &command);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    Frustum frustum = ExtractFrustum(viewProjection);
+    glm::vec4 sphere(mesh.mBounds.mCenter, mesh.mBounds.mRadius);
+
+    state.useProgram(mCullProgram);
+    glUniform4fv(mFrustumPlanesUniform, Frustum::PlaneCount, &frustum.mPlanes[0][0]);
+    glUniform4fv(mMeshSphereUniform, 1, &sphere[0]);
+    glUniform1i(mUseHiZUniform, mHiZValid ? 1 : 0);
+    glUniform2f(mHiZSizeUniform, (float)mWidth, (float)mHeight);
+    glUniform1i(mHiZLevelsUniform, mHiZLevels);
+    glUniformMatrix4fv(mPreviousViewProjectionUniform, 1, GL_FALSE, &mHiZViewProjection[0][0]);
+
+    glActiveTexture(GL_TEXTURE0 + gHiZTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, mHiZTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    state.bindVertexArray(mCullVertexArray);
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, mCulledBuffer);
+    if (mCompact)
+    {
+        glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, mWrittenQuery);
+    }
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, count);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    if (mCompact)
+    {
+        // The visible count goes straight into the draw arguments, the
+        // CPU never waits for it
+        glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+        glBindBuffer(GL_QUERY_BUFFER, mIndirectBuffer);
+        glGetQueryObjectuiv(mWrittenQuery, GL_QUERY_RESULT, (GLuint *)offsetof(DrawElementsIndirectCommand, mInstanceCount));
+        glBindBuffer(GL_QUERY_BUFFER, 0);
+    }
+}
+
+void GpuCuller::draw(GLStateCache &state, const Mesh3D &mesh) const
+{
+    state.bindVertexArray(mesh.mVertexArrayObject);
+    glBindBuffer(GL_ARRAY_BUFFER, mCulledBuffer);
+    SetInstanceAttributes(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+    glDrawElementsIndirect(GL_TRIANGLES, mesh.mIndexType, nullptr);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void GpuCuller::buildHiZ(GLStateCache &state, GLuint framebuffer, int width, int height, const glm::mat4 &viewProjection)
+{
+    // A scaled frame is stretched to the pyramid's size, depth blits
+    // may scale as long as they are nearest
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mDepthFramebuffer);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, mWidth, mHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    state.setEnabled(GL_DEPTH_TEST, false);
+    state.setEnabled(GL_CULL_FACE, false);
+    state.useProgram(mHiZProgram);
+    state.bindVertexArray(mEmptyVertexArray);
+    glBindFramebuffer(GL_FRAMEBUFFER, mHiZFramebuffer);
+    glActiveTexture(GL_TEXTURE0 + gHiZTextureUnit);
+
+    for (int level = 0; level < mHiZLevels; level++)
+    {
+        // Level 0 copies the depth, the others reduce the level above.
+        // Sampling is limited to that level so it never reads the target.
+        if (level == 0)
+        {
+            glBindTexture(GL_TEXTURE_2D, mDepthTexture);
+        }
+        else
+        {
+            glBindTexture(GL_TEXTURE_2D, mHiZTexture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+        }
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mHiZTexture, level);
+        state.setViewport(0, 0, std::max(mWidth >> level, 1), std::max(mHeight >> level, 1));
+        glUniform1i(mHiZReduceUniform, level == 0 ? 0 : 1);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, mHiZTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mHiZLevels - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    state.setViewport(0, 0, width, height);
+    state.setEnabled(GL_DEPTH_TEST, true);
+
+    mHiZViewProjection = viewProjection;
+    mHiZValid = true;
+}
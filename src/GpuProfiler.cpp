@@ -0,0 +1,218 @@
+#include "GpuProfiler.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+GpuProfiler::GpuProfiler()
+{
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    destroy();
+}
+
+void GpuProfiler::initialize()
+{
+    GLint counterBits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counterBits);
+
+    if (counterBits == 0)
+    {
+        std::cout << "GL_TIMESTAMP queries not supported, GPU profiling disabled" << std::endl;
+        return;
+    }
+
+    mInitialized = true;
+}
+
+void GpuProfiler::destroy()
+{
+    for (Frame &frame : mFrames)
+    {
+        if (!frame.queries.empty())
+        {
+            glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+        }
+        frame = Frame();
+    }
+    mInitialized = false;
+}
+
+void GpuProfiler::beginFrame()
+{
+    if (!mInitialized)
+    {
+        return;
+    }
+
+    // The slot being reused holds the queries from gGpuProfilerFrames ago
+    Frame &frame = mFrames[mFrameIndex];
+    collect(frame);
+
+    frame.usedQueries = 0;
+    frame.markers.clear();
+}
+
+void GpuProfiler::endFrame()
+{
+    if (!mInitialized)
+    {
+        return;
+    }
+
+    mFrameIndex = (mFrameIndex + 1) % gGpuProfilerFrames;
+}
+
+int GpuProfiler::beginScope(const char *name)
+{
+    if (!mInitialized)
+    {
+        return -1;
+    }
+
+    Frame &frame = mFrames[mFrameIndex];
+
+    Marker marker = {findScope(name), acquireQuery(frame), 0};
+    glQueryCounter(marker.beginQuery, GL_TIMESTAMP);
+
+    frame.markers.push_back(marker);
+    return (int)frame.markers.size() - 1;
+}
+
+void GpuProfiler::endScope(int marker)
+{
+    if (!mInitialized || marker < 0)
+    {
+        return;
+    }
+
+    Frame &frame = mFrames[mFrameIndex];
+    if (marker >= (int)frame.markers.size())
+    {
+        return;
+    }
+
+    GLuint query = acquireQuery(frame);
+    glQueryCounter(query, GL_TIMESTAMP);
+    frame.markers[marker].endQuery = query;
+}
+
+GLuint GpuProfiler::acquireQuery(Frame &frame)
+{
+    if (frame.usedQueries == frame.queries.size())
+    {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+    return frame.queries[frame.usedQueries++];
+}
+
+void GpuProfiler::collect(Frame &frame)
+{
+    if (frame.markers.empty())
+    {
+        return;
+    }
+
+    // The last query issued finishes last, if it's ready they all are
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+    {
+        mDroppedFrames++;
+        return;
+    }
+
+    for (const Marker &marker : frame.markers)
+    {
+        if (marker.endQuery == 0)
+        {
+            continue;
+        }
+
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(marker.beginQuery, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(marker.endQuery, GL_QUERY_RESULT, &end);
+
+        mScopes[marker.scope].times.add((end - begin) / 1000000.0);
+    }
+}
+
+int GpuProfiler::findScope(const char *name)
+{
+    std::unordered_map<std::string, int>::iterator it = mScopeTable.find(name);
+    if (it != mScopeTable.end())
+    {
+        return it->second;
+    }
+
+    int index = (int)mScopes.size();
+    mScopes.push_back({name, RollingStats()});
+    mScopeTable[name] = index;
+    return index;
+}
+
+const RollingStats *GpuProfiler::getScopeTimes(const char *name) const
+{
+    std::unordered_map<std::string, int>::const_iterator it = mScopeTable.find(name);
+    if (it == mScopeTable.end())
+    {
+        return nullptr;
+    }
+    return &mScopes[it->second].times;
+}
+
+void GpuProfiler::printReport(std::ostream &out) const
+{
+    for (const Scope &scope : mScopes)
+    {
+        out << "GPU " << scope.name << ": "
+            << "min " << scope.times.getMin() << " ms, "
+            << "avg " << scope.times.getAverage() << " ms, "
+            << "p99 " << scope.times.getPercentile(99.0) << " ms"
+            << std::endl;
+    }
+}
+
+std::string GpuProfiler::getSummary() const
+{
+    std::ostringstream summary;
+    summary.precision(2);
+    summary << std::fixed;
+
+    for (size_t i = 0; i < mScopes.size(); i++)
+    {
+        if (i > 0)
+        {
+            summary << ", ";
+        }
+        summary << mScopes[i].name << " " << mScopes[i].times.getAverage() << " ms";
+    }
+    return summary.str();
+}
+
+bool GpuProfiler::writeCsv(const std::string &path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "Could not write GPU profile to " << path << std::endl;
+        return false;
+    }
+
+    file << "scope,samples,min_ms,avg_ms,p99_ms,max_ms\n";
+    for (const Scope &scope : mScopes)
+    {
+        file << scope.name << ","
+             << scope.times.getTotalCount() << ","
+             << scope.times.getMin() << ","
+             << scope.times.getAverage() << ","
+             << scope.times.getPercentile(99.0) << ","
+             << scope.times.getMax() << "\n";
+    }
+    return true;
+}
@@ -0,0 +1,366 @@
+#include "JobSystem.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <string>
+
+// Per-thread job storage and the index of the thread's deque
+struct JobSystem::ThreadState
+{
+    Job mJobs[gJobCapacity];
+    size_t mNext = 0;
+    size_t mIndex = 0;
+    uint32_t mRandom = 1;
+};
+
+// Deque index of the current thread in the running system, -1 elsewhere
+static thread_local const JobSystem *tJobSystem = nullptr;
+static thread_local size_t tJobThread = 0;
+
+bool JobDeque::push(Job *job)
+{
+    int64_t bottom = mBottom.load(std::memory_order_relaxed);
+    int64_t top = mTop.load(std::memory_order_acquire);
+    if (bottom - top >= (int64_t)gJobCapacity)
+    {
+        return false;
+    }
+
+    mJobs[bottom & (gJobCapacity - 1)].store(job, std::memory_order_relaxed);
+    mBottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+Job *JobDeque::pop()
+{
+    int64_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+    mBottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = mTop.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        // Empty
+        mBottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job *job = mJobs[bottom & (gJobCapacity - 1)].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        // Last job, race thieves for it
+        if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+        mBottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job *JobDeque::steal()
+{
+    int64_t top = mTop.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = mBottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+        return nullptr;
+    }
+
+    Job *job = mJobs[top & (gJobCapacity - 1)].load(std::memory_order_relaxed);
+    if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+    return job;
+}
+
+JobSystem::JobSystem()
+{
+}
+
+JobSystem::~JobSystem()
+{
+    stop();
+}
+
+void JobSystem::start(size_t workerCount)
+{
+    stop();
+
+    if (workerCount == 0)
+    {
+        size_t cores = std::thread::hardware_concurrency();
+        workerCount = cores > 2 ? cores - 2 : 1;
+    }
+
+    mStopping = false;
+    mExternalState = new ThreadState();
+    for (size_t i = 0; i <= workerCount; i++)
+    {
+        mDeques.push_back(new JobDeque());
+        mThreadStates.push_back(new ThreadState());
+        mThreadStates.back()->mIndex = i;
+        mThreadStates.back()->mRandom = (uint32_t)(i * 2654435761u + 1);
+    }
+
+    // The caller is thread 0
+    tJobSystem = this;
+    tJobThread = 0;
+
+    for (size_t i = 1; i <= workerCount; i++)
+    {
+        mThreads.emplace_back(&JobSystem::workerMain, this, i);
+    }
+}
+
+void JobSystem::stop()
+{
+    if (mDeques.empty())
+    {
+        return;
+    }
+
+    mStopping = true;
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mWake.notify_all();
+    }
+    for (std::thread &thread : mThreads)
+    {
+        thread.join();
+    }
+    mThreads.clear();
+
+    for (JobDeque *deque : mDeques)
+    {
+        delete deque;
+    }
+    for (ThreadState *state : mThreadStates)
+    {
+        delete state;
+    }
+    mDeques.clear();
+    mThreadStates.clear();
+    mExternalJobs.clear();
+    delete mExternalState;
+    mExternalState = nullptr;
+
+    if (tJobSystem == this)
+    {
+        tJobSystem = nullptr;
+    }
+}
+
+JobSystem::ThreadState *JobSystem::getThreadState()
+{
+    return tJobSystem == this ? mThreadStates[tJobThread] : nullptr;
+}
+
+Job *JobSystem::create(JobFunction function, const void *data, size_t size, Job *parent)
+{
+    ThreadState *state = getThreadState();
+
+    Job *job;
+    if (state != nullptr)
+    {
+        job = &state->mJobs[state->mNext++ & (gJobCapacity - 1)];
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(mExternalMutex);
+        job = &mExternalState->mJobs[mExternalState->mNext++ & (gJobCapacity - 1)];
+    }
+
+    // The ring wrapped onto a job still queued or running, help until it
+    // finishes rather than overwrite it
+    while (job->mUnfinished.load(std::memory_order_acquire) != 0)
+    {
+        Job *other = findJob();
+        if (other != nullptr)
+        {
+            execute(other);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    job->mFunction = function;
+    job->mParent = parent;
+    job->mCounter = nullptr;
+    job->mUnfinished.store(1, std::memory_order_relaxed);
+    std::memcpy(job->mData, data, std::min(size, gJobDataSize));
+
+    if (parent != nullptr)
+    {
+        parent->mUnfinished.fetch_add(1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+void JobSystem::run(Job *job, JobCounter *counter)
+{
+    job->mCounter = counter;
+    if (counter != nullptr)
+    {
+        counter->mValue.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ThreadState *state = getThreadState();
+    if (state == nullptr || !mDeques[state->mIndex]->push(job))
+    {
+        if (state != nullptr)
+        {
+            // Deque full, run it here rather than fail
+            execute(job);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mExternalMutex);
+        mExternalJobs.push_back(job);
+        mExternalCount.store(mExternalJobs.size(), std::memory_order_relaxed);
+    }
+
+    mQueued.fetch_add(1, std::memory_order_seq_cst);
+    if (mSleeping.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mWake.notify_one();
+    }
+}
+
+Job *JobSystem::findJob()
+{
+    ThreadState *state = getThreadState();
+    Job *job = nullptr;
+
+    if (state != nullptr)
+    {
+        job = mDeques[state->mIndex]->pop();
+    }
+
+    if (job == nullptr && mExternalCount.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard<std::mutex> lock(mExternalMutex);
+        if (!mExternalJobs.empty())
+        {
+            job = mExternalJobs.back();
+            mExternalJobs.pop_back();
+            mExternalCount.store(mExternalJobs.size(), std::memory_order_relaxed);
+        }
+    }
+
+    // Steal from a random victim, then everyone in turn
+    if (job == nullptr)
+    {
+        size_t count = mDeques.size();
+        size_t start = 0;
+        if (state != nullptr)
+        {
+            state->mRandom ^= state->mRandom << 13;
+            state->mRandom ^= state->mRandom >> 17;
+            state->mRandom ^= state->mRandom << 5;
+            start = state->mRandom % count;
+        }
+        for (size_t i = 0; i < count && job == nullptr; i++)
+        {
+            size_t victim = (start + i) % count;
+            if (state == nullptr || victim != state->mIndex)
+            {
+                job = mDeques[victim]->steal();
+            }
+        }
+    }
+
+    if (job != nullptr)
+    {
+        mQueued.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+void JobSystem::execute(Job *job)
+{
+    job->mFunction(job, job->mData);
+    finish(job);
+}
+
+void JobSystem::finish(Job *job)
+{
+    // Read before the job counts as finished, create() may reuse it after
+    Job *parent = job->mParent;
+    JobCounter *counter = job->mCounter;
+    if (job->mUnfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+
+    if (counter != nullptr)
+    {
+        counter->mValue.fetch_sub(1, std::memory_order_release);
+    }
+    if (parent != nullptr)
+    {
+        finish(parent);
+    }
+}
+
+size_t JobSystem::getThreadIndex() const
+{
+    return tJobSystem == this ? tJobThread : 0;
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+    CpuScope scope("Wait");
+    while (!counter.isDone())
+    {
+        Job *job = findJob();
+        if (job != nullptr)
+        {
+            execute(job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerMain(size_t index)
+{
+    tJobSystem = this;
+    tJobThread = index;
+    CpuProfilerSetThreadName("Worker " + std::to_string(index));
+
+    while (!mStopping.load(std::memory_order_relaxed))
+    {
+        Job *job = findJob();
+        if (job != nullptr)
+        {
+            execute(job);
+            continue;
+        }
+
+        // Spin briefly before sleeping, frames queue jobs in bursts
+        bool found = false;
+        for (int spin = 0; spin < 64 && !found; spin++)
+        {
+            std::this_thread::yield();
+            found = mQueued.load(std::memory_order_relaxed) > 0;
+        }
+        if (found)
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mSleepMutex);
+        mSleeping.fetch_add(1, std::memory_order_seq_cst);
+        mWake.wait(lock, [this]
+                   { return mStopping.load() || mQueued.load(std::memory_order_seq_cst) > 0; });
+        mSleeping.fetch_sub(1, std::memory_order_seq_cst);
+    }
+}
@@ -0,0 +1,142 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+    mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (mFile == INVALID_HANDLE_VALUE)
+    {
+        mFile = nullptr;
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mFile, &size) || size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+
+    mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mMapping == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    mData = (const unsigned char *)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+    if (mData == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    mSize = (size_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mData != nullptr)
+    {
+        UnmapViewOfFile(mData);
+    }
+    if (mMapping != nullptr)
+    {
+        CloseHandle(mMapping);
+    }
+    if (mFile != nullptr)
+    {
+        CloseHandle(mFile);
+    }
+    mData = nullptr;
+    mMapping = nullptr;
+    mFile = nullptr;
+    mSize = 0;
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const
+{
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = (void *)(mData + offset);
+    range.NumberOfBytes = size;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+    mFile = ::open(path.c_str(), O_RDONLY);
+    if (mFile < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(mFile, &info) != 0 || info.st_size == 0)
+    {
+        close();
+        return false;
+    }
+
+    void *data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, mFile, 0);
+    if (data == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+
+    mData = (const unsigned char *)data;
+    mSize = (size_t)info.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mData != nullptr)
+    {
+        munmap((void *)mData, mSize);
+    }
+    if (mFile >= 0)
+    {
+        ::close(mFile);
+    }
+    mData = nullptr;
+    mSize = 0;
+    mFile = -1;
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const
+{
+    // madvise wants a page aligned start
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = offset / pageSize * pageSize;
+    madvise((void *)(mData + start), size + (offset - start), MADV_WILLNEED);
+}
+
+#endif
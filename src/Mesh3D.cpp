@@ -0,0 +1,109 @@
+#include "Mesh3D.hpp"
+#include "GLDebug.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+void SetInstanceAttributes(GLintptr offset)
+{
+    // A mat4 attribute is four vec4 columns, each advancing once per instance
+    for (GLuint column = 0; column < 4; column++)
+    {
+        GLuint location = gInstanceAttributeLocation + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void *)(offset + sizeof(glm::vec4) * column));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+}
+
+void SetVertexAttributes(Mesh3D *mesh, const VertexAttribute *attributes, uint32_t count, GLsizei stride)
+{
+    glBindVertexArray(mesh->mVertexArrayObject);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->mVertexBufferObject);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const VertexAttribute &attribute = attributes[i];
+        glVertexAttribPointer(attribute.mLocation, attribute.mComponents, attribute.mType, attribute.mNormalized ? GL_TRUE : GL_FALSE, stride, (void *)(uintptr_t)attribute.mOffset);
+        glEnableVertexAttribArray(attribute.mLocation);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SetInstanceSource(Mesh3D *mesh, GLuint buffer, GLintptr offset, GLsizei count)
+{
+    mesh->mInstanceCount = count;
+
+    glBindVertexArray(mesh->mVertexArrayObject);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    SetInstanceAttributes(offset);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GetMeshLodRange(const Mesh3D &mesh, uint32_t lod, GLsizei *count, uintptr_t *offset)
+{
+    if (lod >= mesh.mLodCount)
+    {
+        *count = mesh.mIndexCount;
+        *offset = 0;
+        return;
+    }
+    *count = (GLsizei)mesh.mLods[lod].mIndexCount;
+    *offset = mesh.mLods[lod].mIndexOffset * GetIndexSize(mesh.mIndexType);
+}
+
+uint32_t SelectMeshLod(const Mesh3D &mesh, float distance, float pixelsPerUnit, float maxPixelError)
+{
+    uint32_t lod = 0;
+    distance = std::max(distance, 1e-4f);
+
+    for (uint32_t i = 1; i < mesh.mLodCount; i++)
+    {
+        if (mesh.mLods[i].mError * pixelsPerUnit / distance > maxPixelError)
+        {
+            break;
+        }
+        lod = i;
+    }
+    return lod;
+}
+
+void DrawMesh(const Mesh3D &mesh, uint32_t lod)
+{
+    GLsizei count;
+    uintptr_t offset;
+    GetMeshLodRange(mesh, lod, &count, &offset);
+
+    glBindVertexArray(mesh.mVertexArrayObject);
+    GLCheck(glDrawElements(GL_TRIANGLES, count, mesh.mIndexType, (const void *)offset));
+    glBindVertexArray(0);
+}
+
+void DrawMeshInstanced(const Mesh3D &mesh, uint32_t lod)
+{
+    if (mesh.mInstanceCount == 0)
+    {
+        return;
+    }
+
+    GLsizei count;
+    uintptr_t offset;
+    GetMeshLodRange(mesh, lod, &count, &offset);
+
+    glBindVertexArray(mesh.mVertexArrayObject);
+    GLCheck(glDrawElementsInstanced(GL_TRIANGLES, count, mesh.mIndexType, (const void *)offset, mesh.mInstanceCount));
+    glBindVertexArray(0);
+}
+
+void DestroyMesh(Mesh3D *mesh)
+{
+    glDeleteBuffers(1, &mesh->mIndexBufferObject);
+    glDeleteBuffers(1, &mesh->mVertexBufferObject);
+    glDeleteVertexArrays(1, &mesh->mVertexArrayObject);
+    *mesh = Mesh3D();
+}
@@ -0,0 +1,175 @@
+#include "MeshArena.hpp"
+#include "GLStateCache.hpp"
+
+#include <glm/ext.hpp>
+
+MeshArena::MeshArena()
+{
+}
+
+MeshArena::~MeshArena()
+{
+    destroy();
+}
+
+void MeshArena::initialize(const VertexLayout &layout)
+{
+    destroy();
+    mLayout = layout;
+}
+
+uint32_t MeshArena::addMesh(const unsigned char *vertices, uint32_t vertexCount, const uint32_t *indices, uint32_t indexCount,
+                            const glm::vec3 &positionScale, const glm::vec3 &positionOffset)
+{
+    Range range;
+    range.mFirstIndex = (GLuint)mIndices.size();
+    range.mIndexCount = indexCount;
+    range.mBaseVertex = (GLint)mVertexCount;
+    range.mDequantize = glm::scale(glm::translate(glm::mat4(1.0f), positionOffset), positionScale);
+
+    mVertices.insert(mVertices.end(), vertices, vertices + (size_t)vertexCount * mLayout.mStride);
+    mIndices.insert(mIndices.end(), indices, indices + indexCount);
+    mVertexCount += vertexCount;
+
+    mMeshes.push_back(range);
+    return (uint32_t)mMeshes.size() - 1;
+}
+
+void MeshArena::addDraw(uint32_t mesh, const glm::mat4 &model)
+{
+    const Range &range = mMeshes[mesh];
+
+    DrawElementsIndirectCommand command;
+    command.mCount = range.mIndexCount;
+    command.mInstanceCount = 1;
+    command.mFirstIndex = range.mFirstIndex;
+    command.mBaseVertex = range.mBaseVertex;
+    command.mBaseInstance = (GLuint)mCommands.size();
+    mCommands.push_back(command);
+    mTriangleCount += range.mIndexCount / 3;
+
+    mDrawData.push_back(model * range.mDequantize);
+}
+
+void MeshArena::upload()
+{
+    mUseMultiDraw = GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_base_instance;
+
+    glGenVertexArrays(1, &mMesh.mVertexArrayObject);
+
+    glGenBuffers(1, &mMesh.mVertexBufferObject);
+    glBindBuffer(GL_ARRAY_BUFFER, mMesh.mVertexBufferObject);
+    glBufferData(GL_ARRAY_BUFFER, mVertices.size(), mVertices.data(), GL_STATIC_DRAW);
+    SetVertexAttributes(&mMesh, mLayout.mAttributes, mLayout.mAttributeCount, mLayout.mStride);
+
+    glBindVertexArray(mMesh.mVertexArrayObject);
+    glGenBuffers(1, &mMesh.mIndexBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mMesh.mIndexBufferObject);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * mIndices.size(), mIndices.data(), GL_STATIC_DRAW);
+    mMesh.mIndexCount = (GLsizei)mIndices.size();
+
+    if (mUseMultiDraw)
+    {
+        // Draw i is instance 0 with base instance i, so it reads element i
+        std::vector<GLuint> drawIds(mCommands.size());
+        for (size_t i = 0; i < drawIds.size(); i++)
+        {
+            drawIds[i] = (GLuint)i;
+        }
+        glGenBuffers(1, &mDrawIdBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, mDrawIdBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLuint) * drawIds.size(), drawIds.data(), GL_STATIC_DRAW);
+        glVertexAttribIPointer(gDrawIdAttributeLocation, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void *)0);
+        glEnableVertexAttribArray(gDrawIdAttributeLocation);
+        glVertexAttribDivisor(gDrawIdAttributeLocation, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glGenBuffers(1, &mIndirectBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * mCommands.size(), mCommands.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    glBindVertexArray(0);
+
+    // One RGBA32F texel per matrix column
+    glGenBuffers(1, &mDrawDataBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, mDrawDataBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::mat4) * mDrawData.size(), mDrawData.data(), GL_STATIC_DRAW);
+    glGenTextures(1, &mDrawDataTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, mDrawDataTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, mDrawDataBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // The commands stay for the fallback loop
+    mVertices = std::vector<unsigned char>();
+    mIndices = std::vector<uint32_t>();
+    mDrawData = std::vector<glm::mat4>();
+}
+
+size_t MeshArena::draw(GLStateCache &state) const
+{
+    if (mCommands.empty())
+    {
+        return 0;
+    }
+
+    state.bindVertexArray(mMesh.mVertexArrayObject);
+    glActiveTexture(GL_TEXTURE0 + gDrawDataTextureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, mDrawDataTexture);
+
+    if (mUseMultiDraw)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)mCommands.size(), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        return 1;
+    }
+
+    // The draw ID array is disabled here, so the attribute reads its
+    // current value, which is context state and cheap to change
+    for (size_t i = 0; i < mCommands.size(); i++)
+    {
+        const DrawElementsIndirectCommand &command = mCommands[i];
+        glVertexAttribI1ui(gDrawIdAttributeLocation, (GLuint)i);
+        glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)command.mCount, GL_UNSIGNED_INT,
+                                 (void *)(sizeof(uint32_t) * command.mFirstIndex), command.mBaseVertex);
+    }
+    return mCommands.size();
+}
+
+void MeshArena::destroy()
+{
+    if (mMesh.mVertexArrayObject != 0)
+    {
+        DestroyMesh(&mMesh);
+    }
+    if (mDrawIdBuffer != 0)
+    {
+        glDeleteBuffers(1, &mDrawIdBuffer);
+        mDrawIdBuffer = 0;
+    }
+    if (mIndirectBuffer != 0)
+    {
+        glDeleteBuffers(1, &mIndirectBuffer);
+        mIndirectBuffer = 0;
+    }
+    if (mDrawDataTexture != 0)
+    {
+        glDeleteTextures(1, &mDrawDataTexture);
+        mDrawDataTexture = 0;
+    }
+    if (mDrawDataBuffer != 0)
+    {
+        glDeleteBuffers(1, &mDrawDataBuffer);
+        mDrawDataBuffer = 0;
+    }
+
+    mVertices.clear();
+    mIndices.clear();
+    mVertexCount = 0;
+    mMeshes.clear();
+    mCommands.clear();
+    mDrawData.clear();
+    mTriangleCount = 0;
+}
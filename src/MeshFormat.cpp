@@ -0,0 +1,152 @@
+#include "MeshFormat.hpp"
+
+#include <glad/glad.h>
+
+#include <fstream>
+
+static uint64_t AlignOffset(uint64_t offset)
+{
+    return (offset + gMeshDataAlignment - 1) / gMeshDataAlignment * gMeshDataAlignment;
+}
+
+size_t GetIndexSize(uint32_t indexType)
+{
+    if (indexType == GL_UNSIGNED_SHORT)
+    {
+        return sizeof(uint16_t);
+    }
+    if (indexType == GL_UNSIGNED_INT)
+    {
+        return sizeof(uint32_t);
+    }
+    return 0;
+}
+
+uint64_t GetVertexDataSize(const MeshFileHeader &header)
+{
+    return (uint64_t)header.mVertexCount * header.mVertexStride;
+}
+
+uint64_t GetIndexDataSize(const MeshFileHeader &header)
+{
+    return (uint64_t)header.mIndexCount * GetIndexSize(header.mIndexType);
+}
+
+uint32_t GetAttributeSize(const VertexAttribute &attribute)
+{
+    if (attribute.mComponents == 0 || attribute.mComponents > 4)
+    {
+        return 0;
+    }
+
+    switch (attribute.mType)
+    {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return attribute.mComponents;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+        return attribute.mComponents * 2;
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+        return attribute.mComponents * 4;
+    case GL_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+        // Packed into one 32 bit word, always four components
+        return attribute.mComponents == 4 ? 4 : 0;
+    default:
+        return 0;
+    }
+}
+
+// Size of one component, or of the packed word, which the attribute
+// offset must be a multiple of
+static uint32_t GetAttributeAlignment(const VertexAttribute &attribute)
+{
+    if (attribute.mType == GL_INT_2_10_10_10_REV || attribute.mType == GL_UNSIGNED_INT_2_10_10_10_REV)
+    {
+        return 4;
+    }
+    return GetAttributeSize(attribute) / attribute.mComponents;
+}
+
+// Written so that offset + size can't wrap around
+static bool FitsInFile(uint64_t offset, uint64_t size, size_t fileSize)
+{
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+bool ValidateMeshHeader(const MeshFileHeader &header, size_t fileSize)
+{
+    if (fileSize < sizeof(MeshFileHeader) || header.mMagic != gMeshFileMagic || header.mVersion != gMeshFileVersion)
+    {
+        return false;
+    }
+
+    if (header.mAttributeCount == 0 || header.mAttributeCount > gMeshMaxAttributes || GetIndexSize(header.mIndexType) == 0)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header.mAttributeCount; i++)
+    {
+        const VertexAttribute &attribute = header.mAttributes[i];
+        uint32_t size = GetAttributeSize(attribute);
+        if (size == 0 || attribute.mLocation >= gMeshMaxAttributeLocation || attribute.mNormalized > 1)
+        {
+            return false;
+        }
+        if (attribute.mOffset % GetAttributeAlignment(attribute) != 0 || (uint64_t)attribute.mOffset + size > header.mVertexStride)
+        {
+            return false;
+        }
+    }
+
+    if (header.mLodCount > gMeshMaxLods)
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < header.mLodCount; i++)
+    {
+        const MeshFileLod &lod = header.mLods[i];
+        if (lod.mIndexCount == 0 || lod.mIndexCount % 3 != 0 || lod.mIndexOffset > header.mIndexCount ||
+            lod.mIndexCount > header.mIndexCount - lod.mIndexOffset)
+        {
+            return false;
+        }
+    }
+
+    if (header.mVertexDataOffset % gMeshDataAlignment != 0 || header.mIndexDataOffset % gMeshDataAlignment != 0)
+    {
+        return false;
+    }
+
+    return FitsInFile(header.mVertexDataOffset, GetVertexDataSize(header), fileSize) &&
+           FitsInFile(header.mIndexDataOffset, GetIndexDataSize(header), fileSize);
+}
+
+bool WriteMeshFile(const std::string &path, MeshFileHeader header, const void *vertices, const void *indices)
+{
+    header.mMagic = gMeshFileMagic;
+    header.mVersion = gMeshFileVersion;
+    header.mVertexDataOffset = AlignOffset(sizeof(MeshFileHeader));
+    header.mIndexDataOffset = AlignOffset(header.mVertexDataOffset + GetVertexDataSize(header));
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    const char padding[gMeshDataAlignment] = {};
+
+    file.write((const char *)&header, sizeof(header));
+    file.write(padding, header.mVertexDataOffset - sizeof(header));
+    file.write((const char *)vertices, GetVertexDataSize(header));
+    file.write(padding, header.mIndexDataOffset - header.mVertexDataOffset - GetVertexDataSize(header));
+    file.write((const char *)indices, GetIndexDataSize(header));
+
+    return (bool)file;
+}
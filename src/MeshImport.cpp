@@ -0,0 +1,55 @@
+#include "MeshImport.hpp"
+#include "MeshFormat.hpp"
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+void ImportMesh(const VertexFormat &format, std::vector<float> &vertices, size_t strideFloats, std::vector<uint32_t> &indices, ImportedMesh &mesh)
+{
+    // Weld, reorder for the vertex cache, overdraw and vertex fetch
+    mesh.mStats = OptimizeMesh(vertices, strideFloats, indices);
+    mesh.mVertexCount = vertices.size() / strideFloats;
+    mesh.mBounds = ComputeBounds(vertices.data(), mesh.mVertexCount, strideFloats);
+
+    // Simplified index ranges appended after LOD 0, sharing the vertices
+    mesh.mLodCount = BuildLodChain(vertices.data(), mesh.mVertexCount, strideFloats, indices, mesh.mLods, gMeshMaxLods);
+
+    const float *normals = format.mNormal != NormalFormat::None && strideFloats >= 9 ? vertices.data() + 6 : nullptr;
+    mesh.mLayout = MakeVertexLayout(format);
+    PackVertices(format, mesh.mLayout, mesh.mBounds, vertices.data(), vertices.data() + 3, normals, mesh.mVertexCount, strideFloats, mesh.mVertices);
+    mesh.mIndices = indices;
+}
+
+bool WriteImportedMesh(const std::string &path, const ImportedMesh &mesh)
+{
+    MeshFileHeader header = {};
+    header.mVertexCount = (uint32_t)mesh.mVertexCount;
+    header.mIndexCount = (uint32_t)mesh.mIndices.size();
+    header.mVertexStride = mesh.mLayout.mStride;
+    header.mAttributeCount = mesh.mLayout.mAttributeCount;
+    std::memcpy(header.mAttributes, mesh.mLayout.mAttributes, sizeof(header.mAttributes));
+
+    std::memcpy(header.mBoundsMin, &mesh.mBounds.mMin[0], sizeof(header.mBoundsMin));
+    std::memcpy(header.mBoundsMax, &mesh.mBounds.mMax[0], sizeof(header.mBoundsMax));
+    std::memcpy(header.mBoundsCenter, &mesh.mBounds.mCenter[0], sizeof(header.mBoundsCenter));
+    header.mBoundsRadius = mesh.mBounds.mRadius;
+
+    header.mLodCount = mesh.mLodCount;
+    for (uint32_t i = 0; i < mesh.mLodCount; i++)
+    {
+        header.mLods[i].mIndexOffset = mesh.mLods[i].mIndexOffset;
+        header.mLods[i].mIndexCount = mesh.mLods[i].mIndexCount;
+        header.mLods[i].mError = mesh.mLods[i].mError;
+    }
+
+    if (mesh.mVertexCount > 0xFFFF)
+    {
+        header.mIndexType = GL_UNSIGNED_INT;
+        return WriteMeshFile(path, header, mesh.mVertices.data(), mesh.mIndices.data());
+    }
+
+    std::vector<uint16_t> shortIndices(mesh.mIndices.begin(), mesh.mIndices.end());
+    header.mIndexType = GL_UNSIGNED_SHORT;
+    return WriteMeshFile(path, header, mesh.mVertices.data(), shortIndices.data());
+}
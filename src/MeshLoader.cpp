@@ -0,0 +1,350 @@
+#include "CpuProfiler.hpp"
+#include "MeshLoader.hpp"
+#include "VertexLayout.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Copy in slices so stop() doesn't wait for a whole large asset
+const size_t gMeshCopyChunk = 4 * 1024 * 1024;
+
+MeshLoader::MeshLoader()
+{
+}
+
+MeshLoader::~MeshLoader()
+{
+    stop();
+}
+
+void MeshLoader::start(JobSystem &jobSystem)
+{
+    mJobSystem = &jobSystem;
+    mStopping = false;
+}
+
+void MeshLoader::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+
+    // Copies check mStopping between slices, so this returns quickly
+    if (mJobSystem != nullptr)
+    {
+        mJobSystem->wait(mPending);
+    }
+
+    // Release anything still mapped, needs the GL thread like update()
+    for (Asset *asset : mAssets)
+    {
+        if (asset->state == State::Copying || asset->state == State::Uploading)
+        {
+            asset->state = State::Uploading;
+            finishUpload(*asset);
+        }
+        DestroyMesh(&asset->mesh);
+        mAssetPool.destroy(asset);
+    }
+    mAssets.clear();
+}
+
+MeshLoader::Request MeshLoader::load(const std::string &path)
+{
+    Asset *queued = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        queued = mAssetPool.create();
+        queued->path = path;
+        queued->request = mNextRequest++;
+        mAssets.push_back(queued);
+    }
+
+    AssetJob data = {this, queued, 0};
+    mJobSystem->run(mJobSystem->create(&MeshLoader::mapFileJob, data), &mPending);
+
+    return queued->request;
+}
+
+void MeshLoader::mapFileJob(Job *, const void *data)
+{
+    CpuScope scope("MapMesh");
+    const AssetJob *assetJob = (const AssetJob *)data;
+    assetJob->loader->mapFile(*assetJob->asset);
+}
+
+void MeshLoader::copyChunkJob(Job *, const void *data)
+{
+    CpuScope scope("CopyMeshChunk");
+    const AssetJob *assetJob = (const AssetJob *)data;
+    assetJob->loader->copyChunk(*assetJob->asset, assetJob->offset);
+}
+
+void MeshLoader::mapFile(Asset &asset)
+{
+    State next = State::WaitingForBuffers;
+
+    if (!asset.file.open(asset.path))
+    {
+        std::cout << "Could not open mesh " << asset.path << std::endl;
+        next = State::Failed;
+    }
+    else
+    {
+        std::memcpy(&asset.header, asset.file.getData(), std::min(sizeof(asset.header), asset.file.getSize()));
+
+        if (!ValidateMeshHeader(asset.header, asset.file.getSize()))
+        {
+            std::cout << "Invalid mesh file " << asset.path << std::endl;
+            asset.file.close();
+            next = State::Failed;
+        }
+        else
+        {
+            // Start paging the data in while the GL thread creates buffers
+            asset.file.prefetch((size_t)asset.header.mVertexDataOffset, (size_t)(asset.file.getSize() - asset.header.mVertexDataOffset));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    asset.state = next;
+}
+
+void MeshLoader::queueCopy(Asset &asset)
+{
+    // Offsets run through the vertex block and then the index block, no
+    // slice crosses from one to the other
+    uint64_t vertexSize = GetVertexDataSize(asset.header);
+    uint64_t indexSize = GetIndexDataSize(asset.header);
+    uint64_t vertexChunks = (vertexSize + gMeshCopyChunk - 1) / gMeshCopyChunk;
+    uint64_t indexChunks = (indexSize + gMeshCopyChunk - 1) / gMeshCopyChunk;
+
+    // One extra count so slices finishing early can't complete the copy
+    asset.chunksLeft.store((uint32_t)(vertexChunks + indexChunks + 1));
+
+    for (uint64_t chunk = 0; chunk < vertexChunks + indexChunks; chunk++)
+    {
+        uint64_t offset = chunk < vertexChunks ? chunk * gMeshCopyChunk : vertexSize + (chunk - vertexChunks) * gMeshCopyChunk;
+        AssetJob data = {this, &asset, offset};
+        mJobSystem->run(mJobSystem->create(&MeshLoader::copyChunkJob, data), &mPending);
+    }
+
+    copyChunk(asset, UINT64_MAX);
+}
+
+void MeshLoader::copyChunk(Asset &asset, uint64_t offset)
+{
+    bool stopping;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        stopping = mStopping;
+    }
+
+    uint64_t vertexSize = GetVertexDataSize(asset.header);
+    if (!stopping && offset != UINT64_MAX)
+    {
+        unsigned char *destination = (unsigned char *)asset.vertexDestination;
+        const unsigned char *source = asset.file.getData() + asset.header.mVertexDataOffset;
+        uint64_t blockSize = vertexSize;
+        if (offset >= vertexSize)
+        {
+            destination = (unsigned char *)asset.indexDestination;
+            source = asset.file.getData() + asset.header.mIndexDataOffset;
+            blockSize = GetIndexDataSize(asset.header);
+            offset -= vertexSize;
+        }
+
+        size_t size = (size_t)std::min<uint64_t>(gMeshCopyChunk, blockSize - offset);
+        std::memcpy(destination + offset, source + offset, size);
+    }
+
+    if (asset.chunksLeft.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+
+    asset.file.close();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    asset.state = State::Uploading;
+}
+
+bool MeshLoader::update()
+{
+    std::vector<Asset *> &needBuffers = mNeedBuffers;
+    std::vector<Asset *> &needFinish = mNeedFinish;
+    needBuffers.clear();
+    needFinish.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (Asset *asset : mAssets)
+        {
+            if (asset->state == State::WaitingForBuffers)
+            {
+                needBuffers.push_back(asset);
+            }
+            else if (asset->state == State::Uploading)
+            {
+                needFinish.push_back(asset);
+            }
+        }
+    }
+
+    for (Asset *asset : needBuffers)
+    {
+        createBuffers(*asset);
+    }
+    for (Asset *asset : needFinish)
+    {
+        finishUpload(*asset);
+    }
+
+    // The GL mappings are ready, spread the copy over the job system
+    for (Asset *asset : needBuffers)
+    {
+        if (asset->state == State::Copying)
+        {
+            queueCopy(*asset);
+        }
+    }
+
+    return !needBuffers.empty() || !needFinish.empty();
+}
+
+void MeshLoader::createBuffers(Asset &asset)
+{
+    GLsizeiptr vertexSize = (GLsizeiptr)GetVertexDataSize(asset.header);
+    GLsizeiptr indexSize = (GLsizeiptr)GetIndexDataSize(asset.header);
+    GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+
+    glGenVertexArrays(1, &asset.mesh.mVertexArrayObject);
+
+    glGenBuffers(1, &asset.mesh.mVertexBufferObject);
+    glBindBuffer(GL_ARRAY_BUFFER, asset.mesh.mVertexBufferObject);
+    glBufferData(GL_ARRAY_BUFFER, vertexSize, nullptr, GL_STATIC_DRAW);
+    asset.vertexDestination = glMapBufferRange(GL_ARRAY_BUFFER, 0, vertexSize, access);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Not bound to a VAO yet, so the element binding is safe to change
+    glBindVertexArray(0);
+    glGenBuffers(1, &asset.mesh.mIndexBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, asset.mesh.mIndexBufferObject);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexSize, nullptr, GL_STATIC_DRAW);
+    asset.indexDestination = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, indexSize, access);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (asset.vertexDestination == nullptr || asset.indexDestination == nullptr)
+    {
+        std::cout << "Could not map buffers for mesh " << asset.path << std::endl;
+        asset.state = State::Uploading;
+        asset.vertexDestination = nullptr;
+        asset.indexDestination = nullptr;
+        return;
+    }
+    asset.state = State::Copying;
+}
+
+void MeshLoader::finishUpload(Asset &asset)
+{
+    bool valid = asset.vertexDestination != nullptr && asset.indexDestination != nullptr;
+
+    glBindBuffer(GL_ARRAY_BUFFER, asset.mesh.mVertexBufferObject);
+    valid = glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE && valid;
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, asset.mesh.mIndexBufferObject);
+    valid = glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER) == GL_TRUE && valid;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    asset.vertexDestination = nullptr;
+    asset.indexDestination = nullptr;
+
+    if (!valid)
+    {
+        // Unmap can fail if the driver lost the storage, e.g. a mode switch
+        DestroyMesh(&asset.mesh);
+        std::lock_guard<std::mutex> lock(mMutex);
+        asset.state = State::Failed;
+        return;
+    }
+
+    const MeshFileHeader &header = asset.header;
+
+    SetVertexAttributes(&asset.mesh, header.mAttributes, header.mAttributeCount, header.mVertexStride);
+
+    glBindVertexArray(asset.mesh.mVertexArrayObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, asset.mesh.mIndexBufferObject);
+    glBindVertexArray(0);
+
+    asset.mesh.mIndexCount = header.mIndexCount;
+    asset.mesh.mIndexType = header.mIndexType;
+
+    // LOD 0 is the first range, the simplified levels follow it
+    asset.mesh.mLodCount = header.mLodCount;
+    for (uint32_t i = 0; i < header.mLodCount; i++)
+    {
+        asset.mesh.mLods[i].mIndexOffset = header.mLods[i].mIndexOffset;
+        asset.mesh.mLods[i].mIndexCount = header.mLods[i].mIndexCount;
+        asset.mesh.mLods[i].mError = header.mLods[i].mError;
+    }
+    if (header.mLodCount > 0)
+    {
+        asset.mesh.mIndexCount = (GLsizei)header.mLods[0].mIndexCount;
+    }
+    asset.mesh.mBounds.mMin = glm::vec3(header.mBoundsMin[0], header.mBoundsMin[1], header.mBoundsMin[2]);
+    asset.mesh.mBounds.mMax = glm::vec3(header.mBoundsMax[0], header.mBoundsMax[1], header.mBoundsMax[2]);
+    asset.mesh.mBounds.mCenter = glm::vec3(header.mBoundsCenter[0], header.mBoundsCenter[1], header.mBoundsCenter[2]);
+    asset.mesh.mBounds.mRadius = header.mBoundsRadius;
+
+    for (uint32_t i = 0; i < header.mAttributeCount; i++)
+    {
+        if (header.mAttributes[i].mLocation == gPositionAttributeLocation)
+        {
+            GetPositionDequantization(header.mAttributes[i], asset.mesh.mBounds, &asset.mesh.mPositionScale, &asset.mesh.mPositionOffset);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    asset.state = State::Ready;
+}
+
+MeshLoader::Asset *MeshLoader::findAsset(Request request) const
+{
+    for (Asset *asset : mAssets)
+    {
+        if (asset->request == request)
+        {
+            return asset;
+        }
+    }
+    return nullptr;
+}
+
+MeshLoader::State MeshLoader::getState(Request request) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Asset *asset = findAsset(request);
+    return asset ? asset->state : State::Unknown;
+}
+
+bool MeshLoader::takeMesh(Request request, Mesh3D *mesh)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (std::vector<Asset *>::iterator it = mAssets.begin(); it != mAssets.end(); ++it)
+    {
+        if ((*it)->request == request && (*it)->state == State::Ready)
+        {
+            *mesh = (*it)->mesh;
+            mAssetPool.destroy(*it);
+            mAssets.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
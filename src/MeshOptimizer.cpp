@@ -0,0 +1,356 @@
+#include "MeshOptimizer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+float ComputeACMR(const uint32_t *indices, size_t indexCount, size_t vertexCount, size_t cacheSize)
+{
+    if (indexCount < 3)
+    {
+        return 0.0f;
+    }
+
+    // A vertex is cached while fewer than cacheSize misses happened since it was loaded
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    size_t misses = 0;
+
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        uint32_t v = indices[i];
+        if (loadedAt[v] == 0 || misses - loadedAt[v] >= cacheSize)
+        {
+            misses++;
+            loadedAt[v] = misses;
+        }
+    }
+
+    return (float)misses / (float)(indexCount / 3);
+}
+
+size_t WeldVertices(const void *vertices, size_t vertexCount, size_t stride, std::vector<uint32_t> &remap)
+{
+    const unsigned char *bytes = (const unsigned char *)vertices;
+
+    struct VertexHash
+    {
+        const unsigned char *bytes;
+        size_t stride;
+        size_t operator()(uint32_t v) const
+        {
+            // FNV-1a over the vertex bytes
+            size_t hash = 2166136261u;
+            for (size_t i = 0; i < stride; i++)
+            {
+                hash = (hash ^ bytes[v * stride + i]) * 16777619u;
+            }
+            return hash;
+        }
+    };
+    struct VertexEqual
+    {
+        const unsigned char *bytes;
+        size_t stride;
+        bool operator()(uint32_t a, uint32_t b) const
+        {
+            return std::memcmp(bytes + a * stride, bytes + b * stride, stride) == 0;
+        }
+    };
+
+    std::unordered_map<uint32_t, uint32_t, VertexHash, VertexEqual> unique(vertexCount, VertexHash{bytes, stride}, VertexEqual{bytes, stride});
+
+    remap.resize(vertexCount);
+    for (uint32_t v = 0; v < (uint32_t)vertexCount; v++)
+    {
+        std::pair<std::unordered_map<uint32_t, uint32_t, VertexHash, VertexEqual>::iterator, bool> result =
+            unique.insert(std::make_pair(v, (uint32_t)unique.size()));
+        remap[v] = result.first->second;
+    }
+
+    return unique.size();
+}
+
+void OptimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount, size_t cacheSize)
+{
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangles using each vertex, compressed rows
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        live[indices[i]]++;
+    }
+    std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+    }
+    std::vector<uint32_t> adjacency(indexCount);
+    std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indexCount);
+
+    uint32_t time = (uint32_t)cacheSize + 1;
+    size_t cursor = 0;
+    int64_t fan = indices[0];
+
+    while (fan >= 0)
+    {
+        candidates.clear();
+
+        // Emit every remaining triangle around the fanning vertex
+        for (uint32_t a = adjacencyStart[fan]; a < adjacencyStart[fan + 1]; a++)
+        {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle])
+            {
+                continue;
+            }
+            emitted[triangle] = 1;
+
+            for (int corner = 0; corner < 3; corner++)
+            {
+                uint32_t v = indices[triangle * 3 + corner];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = time++;
+                }
+            }
+        }
+
+        // Next fan: the candidate that stays in cache longest after its
+        // remaining triangles are emitted
+        fan = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates)
+        {
+            if (live[v] == 0)
+            {
+                continue;
+            }
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+            {
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                fan = v;
+            }
+        }
+
+        // Dead end, go back through recently used vertices, then scan
+        while (fan < 0 && !deadEnd.empty())
+        {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0)
+            {
+                fan = v;
+            }
+        }
+        while (fan < 0 && cursor < vertexCount)
+        {
+            if (live[cursor] > 0)
+            {
+                fan = (int64_t)cursor;
+            }
+            cursor++;
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void OptimizeOverdraw(uint32_t *indices, size_t indexCount, const float *positions, size_t vertexCount, size_t stride,
+                      float threshold, size_t cacheSize)
+{
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+    {
+        return;
+    }
+
+    float limit = ComputeACMR(indices, indexCount, vertexCount, cacheSize) * threshold;
+
+    // Cut where the cache would be cold anyway: a triangle that misses on
+    // all three vertices, once the cluster so far is within the limit
+    std::vector<size_t> clusterStart;
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    size_t misses = 0;
+    size_t clusterMisses = 0;
+    size_t clusterTriangles = 0;
+
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        size_t triangleMisses = 0;
+        for (int corner = 0; corner < 3; corner++)
+        {
+            uint32_t v = indices[t * 3 + corner];
+            if (loadedAt[v] == 0 || misses - loadedAt[v] >= cacheSize)
+            {
+                misses++;
+                loadedAt[v] = misses;
+                triangleMisses++;
+            }
+        }
+
+        bool cut = clusterTriangles == 0 ||
+                   (triangleMisses == 3 && (float)clusterMisses / (float)clusterTriangles <= limit);
+        if (cut)
+        {
+            clusterStart.push_back(t);
+            clusterMisses = 0;
+            clusterTriangles = 0;
+        }
+        clusterMisses += triangleMisses;
+        clusterTriangles++;
+    }
+    clusterStart.push_back(triangleCount);
+
+    size_t clusterCount = clusterStart.size() - 1;
+    if (clusterCount < 2)
+    {
+        return;
+    }
+
+    glm::vec3 meshCentroid(0.0f);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        meshCentroid += glm::vec3(positions[v * stride], positions[v * stride + 1], positions[v * stride + 2]);
+    }
+    meshCentroid /= (float)vertexCount;
+
+    // Outward facing clusters first, they are the ones likely to occlude
+    std::vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+
+        for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+        {
+            const float *a = positions + indices[t * 3] * stride;
+            const float *b = positions + indices[t * 3 + 1] * stride;
+            const float *d = positions + indices[t * 3 + 2] * stride;
+            glm::vec3 p0(a[0], a[1], a[2]);
+            glm::vec3 p1(b[0], b[1], b[2]);
+            glm::vec3 p2(d[0], d[1], d[2]);
+
+            glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(cross);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += cross;
+            area += triangleArea;
+        }
+
+        centroid = area > 0.0f ? centroid / area : meshCentroid;
+        float normalLength = glm::length(normal);
+        sortKey[c] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        order[c] = (uint32_t)c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sortKey](uint32_t a, uint32_t b)
+                     { return sortKey[a] > sortKey[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    for (uint32_t c : order)
+    {
+        output.insert(output.end(), indices + clusterStart[c] * 3, indices + clusterStart[c + 1] * 3);
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+size_t OptimizeVertexFetch(uint32_t *indices, size_t indexCount, void *vertices, size_t vertexCount, size_t stride)
+{
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(vertexCount, unused);
+    uint32_t next = 0;
+
+    for (size_t i = 0; i < indexCount; i++)
+    {
+        uint32_t &target = remap[indices[i]];
+        if (target == unused)
+        {
+            target = next++;
+        }
+        indices[i] = target;
+    }
+
+    unsigned char *bytes = (unsigned char *)vertices;
+    std::vector<unsigned char> reordered(next * stride);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        if (remap[v] != unused)
+        {
+            std::memcpy(reordered.data() + remap[v] * stride, bytes + v * stride, stride);
+        }
+    }
+    std::memcpy(bytes, reordered.data(), reordered.size());
+
+    return next;
+}
+
+MeshOptimizeStats OptimizeMesh(std::vector<float> &vertices, size_t strideFloats, std::vector<uint32_t> &indices)
+{
+    MeshOptimizeStats stats;
+    size_t stride = strideFloats * sizeof(float);
+    size_t vertexCount = vertices.size() / strideFloats;
+
+    stats.mVerticesBefore = vertexCount;
+    stats.mAcmrBefore = ComputeACMR(indices.data(), indices.size(), vertexCount);
+
+    // Weld first so shared corners are shared in the cache too
+    std::vector<uint32_t> remap;
+    size_t uniqueCount = WeldVertices(vertices.data(), vertexCount, stride, remap);
+    if (uniqueCount < vertexCount)
+    {
+        std::vector<float> welded(uniqueCount * strideFloats);
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            std::memcpy(&welded[remap[v] * strideFloats], &vertices[v * strideFloats], stride);
+        }
+        vertices.swap(welded);
+        for (uint32_t &index : indices)
+        {
+            index = remap[index];
+        }
+        vertexCount = uniqueCount;
+    }
+
+    OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+    OptimizeOverdraw(indices.data(), indices.size(), vertices.data(), vertexCount, strideFloats);
+
+    vertexCount = OptimizeVertexFetch(indices.data(), indices.size(), vertices.data(), vertexCount, stride);
+    vertices.resize(vertexCount * strideFloats);
+
+    stats.mVerticesAfter = vertexCount;
+    stats.mAcmrAfter = ComputeACMR(indices.data(), indices.size(), vertexCount);
+    return stats;
+}
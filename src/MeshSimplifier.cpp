@@ -0,0 +1,359 @@
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+// Symmetric 4x4 error quadric, upper triangle, plus the total plane weight
+// so the error can be turned back into a distance
+struct Quadric
+{
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+    double weight = 0;
+};
+
+static void AddPlane(Quadric &q, const glm::vec3 &normal, float distance, double weight)
+{
+    double a = normal.x, b = normal.y, c = normal.z, d = distance;
+    q.a00 += a * a * weight;
+    q.a01 += a * b * weight;
+    q.a02 += a * c * weight;
+    q.a03 += a * d * weight;
+    q.a11 += b * b * weight;
+    q.a12 += b * c * weight;
+    q.a13 += b * d * weight;
+    q.a22 += c * c * weight;
+    q.a23 += c * d * weight;
+    q.a33 += d * d * weight;
+    q.weight += weight;
+}
+
+static void AddQuadric(Quadric &q, const Quadric &o)
+{
+    q.a00 += o.a00;
+    q.a01 += o.a01;
+    q.a02 += o.a02;
+    q.a03 += o.a03;
+    q.a11 += o.a11;
+    q.a12 += o.a12;
+    q.a13 += o.a13;
+    q.a22 += o.a22;
+    q.a23 += o.a23;
+    q.a33 += o.a33;
+    q.weight += o.weight;
+}
+
+// Weighted mean squared distance of p to the planes
+static double EvaluateQuadric(const Quadric &q, const glm::vec3 &p)
+{
+    double x = p.x, y = p.y, z = p.z;
+    double error = q.a00 * x * x + 2 * q.a01 * x * y + 2 * q.a02 * x * z + 2 * q.a03 * x +
+                   q.a11 * y * y + 2 * q.a12 * y * z + 2 * q.a13 * y +
+                   q.a22 * z * z + 2 * q.a23 * z +
+                   q.a33;
+    return q.weight > 0 ? std::max(error, 0.0) / q.weight : 0.0;
+}
+
+static uint64_t EdgeKey(uint32_t a, uint32_t b)
+{
+    return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+static glm::vec3 GetPosition(const float *positions, size_t stride, uint32_t v)
+{
+    const float *p = positions + v * stride;
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    double error;
+};
+
+std::vector<uint32_t> SimplifyMesh(const float *positions, size_t vertexCount, size_t stride,
+                                   const uint32_t *indices, size_t indexCount,
+                                   size_t targetIndexCount, float maxError, float *resultError)
+{
+    std::vector<uint32_t> result(indices, indices + indexCount);
+    float reachedError = 0.0f;
+
+    // Vertices sharing a position with another vertex are attribute seams,
+    // moving one side would open a crack
+    std::vector<uint8_t> locked(vertexCount, 0);
+    {
+        std::unordered_map<uint64_t, uint32_t> firstAtPosition;
+        for (uint32_t v = 0; v < (uint32_t)vertexCount; v++)
+        {
+            glm::vec3 p = GetPosition(positions, stride, v);
+            uint64_t key = 1469598103934665603ull;
+            for (int i = 0; i < 3; i++)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &p[i], sizeof(bits));
+                key = (key ^ bits) * 1099511628211ull;
+            }
+            std::pair<std::unordered_map<uint64_t, uint32_t>::iterator, bool> inserted = firstAtPosition.insert(std::make_pair(key, v));
+            if (!inserted.second && GetPosition(positions, stride, inserted.first->second) == p)
+            {
+                locked[v] = 1;
+                locked[inserted.first->second] = 1;
+            }
+        }
+    }
+
+    // Face quadrics weighted by area, and border edges locked
+    std::vector<Quadric> quadrics(vertexCount);
+    std::unordered_map<uint64_t, uint32_t> edgeUse;
+    for (size_t t = 0; t + 2 < indexCount; t += 3)
+    {
+        uint32_t v[3] = {indices[t], indices[t + 1], indices[t + 2]};
+        glm::vec3 p0 = GetPosition(positions, stride, v[0]);
+        glm::vec3 p1 = GetPosition(positions, stride, v[1]);
+        glm::vec3 p2 = GetPosition(positions, stride, v[2]);
+
+        glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(cross);
+        if (length > 0.0f)
+        {
+            glm::vec3 normal = cross / length;
+            for (uint32_t corner : v)
+            {
+                AddPlane(quadrics[corner], normal, -glm::dot(normal, p0), length * 0.5);
+            }
+        }
+
+        for (int e = 0; e < 3; e++)
+        {
+            edgeUse[EdgeKey(v[e], v[(e + 1) % 3])]++;
+        }
+    }
+    for (size_t t = 0; t + 2 < indexCount; t += 3)
+    {
+        for (int e = 0; e < 3; e++)
+        {
+            if (edgeUse[EdgeKey(indices[t + e], indices[t + (e + 1) % 3])] == 1)
+            {
+                locked[indices[t + e]] = 1;
+                locked[indices[t + (e + 1) % 3]] = 1;
+            }
+        }
+    }
+
+    std::vector<uint32_t> remap(vertexCount);
+    for (uint32_t v = 0; v < (uint32_t)vertexCount; v++)
+    {
+        remap[v] = v;
+    }
+
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> triangleStart(vertexCount + 1);
+    std::vector<uint32_t> vertexTriangles;
+    std::vector<uint8_t> touched(vertexCount);
+
+    while (result.size() > targetIndexCount)
+    {
+        // Candidate collapses along every edge of the current mesh
+        collapses.clear();
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            for (int e = 0; e < 3; e++)
+            {
+                uint32_t a = result[t + e];
+                uint32_t b = result[t + (e + 1) % 3];
+                for (int direction = 0; direction < 2; direction++)
+                {
+                    uint32_t from = direction ? b : a;
+                    uint32_t to = direction ? a : b;
+                    if (locked[from])
+                    {
+                        continue;
+                    }
+                    Quadric q = quadrics[from];
+                    AddQuadric(q, quadrics[to]);
+                    collapses.push_back({from, to, EvaluateQuadric(q, GetPosition(positions, stride, to))});
+                }
+            }
+        }
+        if (collapses.empty())
+        {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y)
+                  { return x.error < y.error; });
+
+        // Triangles around each vertex, for the flip test
+        std::fill(triangleStart.begin(), triangleStart.end(), 0);
+        for (uint32_t v : result)
+        {
+            triangleStart[v + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            triangleStart[v + 1] += triangleStart[v];
+        }
+        vertexTriangles.resize(result.size());
+        std::vector<uint32_t> fill(triangleStart.begin(), triangleStart.end() - 1);
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            vertexTriangles[fill[result[i]]++] = (uint32_t)(i / 3);
+        }
+
+        // Apply independent collapses, cheapest first. Each one touches
+        // the triangle fan of its source vertex only.
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t trianglesLeft = result.size() / 3;
+        size_t applied = 0;
+        bool errorLimitHit = false;
+
+        for (const Collapse &collapse : collapses)
+        {
+            if (trianglesLeft * 3 <= targetIndexCount)
+            {
+                break;
+            }
+            double distance = std::sqrt(collapse.error);
+            if (distance > maxError)
+            {
+                errorLimitHit = true;
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to])
+            {
+                continue;
+            }
+
+            glm::vec3 target = GetPosition(positions, stride, collapse.to);
+            bool flips = false;
+            size_t removed = 0;
+
+            for (uint32_t i = triangleStart[collapse.from]; i < triangleStart[collapse.from + 1] && !flips; i++)
+            {
+                const uint32_t *triangle = &result[vertexTriangles[i] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                {
+                    removed++;
+                    continue;
+                }
+
+                glm::vec3 before[3];
+                glm::vec3 after[3];
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    before[corner] = GetPosition(positions, stride, triangle[corner]);
+                    after[corner] = triangle[corner] == collapse.from ? target : before[corner];
+                }
+                glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                flips = glm::dot(normalBefore, normalAfter) <= 0.0f;
+            }
+            if (flips)
+            {
+                continue;
+            }
+
+            for (uint32_t i = triangleStart[collapse.from]; i < triangleStart[collapse.from + 1]; i++)
+            {
+                const uint32_t *triangle = &result[vertexTriangles[i] * 3];
+                touched[triangle[0]] = 1;
+                touched[triangle[1]] = 1;
+                touched[triangle[2]] = 1;
+            }
+
+            remap[collapse.from] = collapse.to;
+            AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+            reachedError = std::max(reachedError, (float)distance);
+            trianglesLeft -= removed;
+            applied++;
+        }
+
+        if (applied == 0)
+        {
+            break;
+        }
+
+        // Rewrite the triangles and drop the ones that collapsed
+        size_t write = 0;
+        for (size_t t = 0; t < result.size(); t += 3)
+        {
+            uint32_t v0 = remap[result[t]];
+            uint32_t v1 = remap[result[t + 1]];
+            uint32_t v2 = remap[result[t + 2]];
+            if (v0 != v1 && v1 != v2 && v0 != v2)
+            {
+                result[write++] = v0;
+                result[write++] = v1;
+                result[write++] = v2;
+            }
+        }
+        result.resize(write);
+
+        // Targets are never sources in the same pass, so one step is enough
+        for (uint32_t v = 0; v < (uint32_t)vertexCount; v++)
+        {
+            remap[v] = v;
+        }
+
+        if (errorLimitHit)
+        {
+            break;
+        }
+    }
+
+    if (resultError)
+    {
+        *resultError = reachedError;
+    }
+    return result;
+}
+
+uint32_t BuildLodChain(const float *positions, size_t vertexCount, size_t stride, std::vector<uint32_t> &indices,
+                       MeshLod *lods, uint32_t maxLods, float reduction)
+{
+    if (maxLods == 0)
+    {
+        return 0;
+    }
+
+    size_t baseCount = indices.size();
+    lods[0].mIndexOffset = 0;
+    lods[0].mIndexCount = (uint32_t)baseCount;
+    lods[0].mError = 0.0f;
+
+    uint32_t lodCount = 1;
+    while (lodCount < maxLods)
+    {
+        const MeshLod &previous = lods[lodCount - 1];
+        size_t target = (size_t)(previous.mIndexCount * reduction) / 3 * 3;
+
+        // Always simplify the full mesh, errors don't compound between levels
+        float error = 0.0f;
+        std::vector<uint32_t> simplified = SimplifyMesh(positions, vertexCount, stride, indices.data(), baseCount,
+                                                        target, std::numeric_limits<float>::max(), &error);
+
+        // Not worth a level if it barely got smaller
+        if (simplified.empty() || simplified.size() > previous.mIndexCount * 0.9f)
+        {
+            break;
+        }
+
+        OptimizeVertexCache(simplified.data(), simplified.size(), vertexCount);
+
+        MeshLod &lod = lods[lodCount++];
+        lod.mIndexOffset = (uint32_t)indices.size();
+        lod.mIndexCount = (uint32_t)simplified.size();
+        lod.mError = std::max(error, previous.mError);
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+    }
+
+    return lodCount;
+}
@@ -0,0 +1,101 @@
+#include "OffscreenTarget.hpp"
+
+#include <iostream>
+
+OffscreenTarget::OffscreenTarget()
+{
+}
+
+OffscreenTarget::~OffscreenTarget()
+{
+    destroy();
+}
+
+bool OffscreenTarget::create(int width, int height)
+{
+    destroy();
+
+    mWidth = width;
+    mHeight = height;
+
+    glGenRenderbuffers(1, &mColorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, mColorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &mDepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, mDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &mFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, mColorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepthBuffer);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Offscreen framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+bool OffscreenTarget::resize(int width, int height)
+{
+    if (mFramebuffer != 0 && width == mWidth && height == mHeight)
+    {
+        return true;
+    }
+    return create(width, height);
+}
+
+void OffscreenTarget::destroy()
+{
+    for (GLsync &fence : mFences)
+    {
+        if (fence != nullptr)
+        {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    mFrameIndex = 0;
+
+    if (mFramebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &mFramebuffer);
+        mFramebuffer = 0;
+    }
+    if (mColorBuffer != 0)
+    {
+        glDeleteRenderbuffers(1, &mColorBuffer);
+        mColorBuffer = 0;
+    }
+    if (mDepthBuffer != 0)
+    {
+        glDeleteRenderbuffers(1, &mDepthBuffer);
+        mDepthBuffer = 0;
+    }
+}
+
+void OffscreenTarget::endFrame()
+{
+    mFences[mFrameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    mFrameIndex = (mFrameIndex + 1) % gOffscreenFrames;
+
+    // The oldest frame has to finish before the next one starts
+    GLsync &fence = mFences[mFrameIndex];
+    if (fence != nullptr)
+    {
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED)
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
@@ -0,0 +1,155 @@
+#include "ProgramCache.hpp"
+#include "ShaderProgram.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// Header in front of every cache entry
+struct ProgramBinaryHeader
+{
+    unsigned int mMagic;
+    GLenum mFormat;
+    GLint mLength;
+};
+
+const unsigned int gProgramBinaryMagic = 0x4E49424Fu;
+
+unsigned long long HashString(const std::string &text, unsigned long long seed)
+{
+    unsigned long long hash = seed;
+    for (unsigned char c : text)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void ProgramCache::initialize(const std::string &directory)
+{
+    mDirectory = directory;
+
+    const char *renderer = (const char *)glGetString(GL_RENDERER);
+    const char *version = (const char *)glGetString(GL_VERSION);
+    mDriverString = std::string(renderer ? renderer : "") + "\n" + (version ? version : "");
+
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    mSupported = formatCount > 0;
+
+    if (!mSupported)
+    {
+        std::cout << "Program binaries not supported, shaders are compiled every run" << std::endl;
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(mDirectory, error);
+    if (error)
+    {
+        std::cout << "Could not create shader cache directory " << mDirectory << std::endl;
+        mSupported = false;
+    }
+}
+
+unsigned long long ProgramCache::makeKey(const std::string &vertexShaderSource, const std::string &fragmentShaderSource) const
+{
+    unsigned long long key = HashString(vertexShaderSource);
+    key = HashString(std::string(1, '\0'), key);
+    key = HashString(fragmentShaderSource, key);
+    return HashString(mDriverString, key);
+}
+
+std::string ProgramCache::getEntryPath(unsigned long long key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", key);
+    return (std::filesystem::path(mDirectory) / name).string();
+}
+
+GLuint ProgramCache::load(const std::string &vertexShaderSource, const std::string &fragmentShaderSource)
+{
+    if (!mSupported)
+    {
+        return CreateShaderProgram(vertexShaderSource, fragmentShaderSource);
+    }
+
+    std::string path = getEntryPath(makeKey(vertexShaderSource, fragmentShaderSource));
+
+    GLuint program = loadBinary(path);
+    if (program != 0)
+    {
+        mHits++;
+        return program;
+    }
+
+    mMisses++;
+    program = CreateShaderProgram(vertexShaderSource, fragmentShaderSource, true);
+    storeBinary(path, program);
+
+    return program;
+}
+
+GLuint ProgramCache::loadBinary(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return 0;
+    }
+
+    ProgramBinaryHeader header = {};
+    file.read((char *)&header, sizeof(header));
+    if (!file || header.mMagic != gProgramBinaryMagic || header.mLength <= 0)
+    {
+        return 0;
+    }
+
+    std::vector<char> binary(header.mLength);
+    file.read(binary.data(), header.mLength);
+    if (!file)
+    {
+        return 0;
+    }
+    file.close();
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.mFormat, binary.data(), header.mLength);
+
+    // Drivers may reject binaries from an older build of themselves
+    GLint isLinked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+    if (isLinked == GL_FALSE)
+    {
+        glDeleteProgram(program);
+        std::remove(path.c_str());
+        return 0;
+    }
+
+    return program;
+}
+
+void ProgramCache::storeBinary(const std::string &path, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+
+    ProgramBinaryHeader header = {gProgramBinaryMagic, GL_NONE, 0};
+    std::vector<char> binary(length);
+    glGetProgramBinary(program, length, &header.mLength, &header.mFormat, binary.data());
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return;
+    }
+    file.write((const char *)&header, sizeof(header));
+    file.write(binary.data(), header.mLength);
+}
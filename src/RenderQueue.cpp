@@ -0,0 +1,153 @@
+#include "RenderQueue.hpp"
+#include "GLDebug.hpp"
+#include "Mesh3D.hpp"
+#include "UniformBlocks.hpp"
+
+#include <algorithm>
+
+uint64_t MakeSortKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t vertexArray, uint32_t depth)
+{
+    return ((uint64_t)(pass & 0xF) << 60) |
+           ((uint64_t)(program & 0xFFF) << 48) |
+           ((uint64_t)(material & 0xFFF) << 36) |
+           ((uint64_t)(vertexArray & 0xFFF) << 24) |
+           (uint64_t)(depth & 0xFFFFFF);
+}
+
+uint64_t MakeDepthSortKey(uint32_t pass, uint32_t depth, uint32_t program, uint32_t vertexArray, uint32_t material)
+{
+    return ((uint64_t)(pass & 0xF) << 60) |
+           ((uint64_t)(depth & 0xFFFFFF) << 36) |
+           ((uint64_t)(program & 0xFFF) << 24) |
+           ((uint64_t)(vertexArray & 0xFFF) << 12) |
+           (uint64_t)(material & 0xFFF);
+}
+
+uint32_t QuantizeDepth(float depth, float farPlane)
+{
+    float normalized = farPlane > 0.0f ? depth / farPlane : 0.0f;
+    normalized = std::min(std::max(normalized, 0.0f), 1.0f);
+    return (uint32_t)(normalized * 0xFFFFFF);
+}
+
+void RenderQueue::clear()
+{
+    mPackets.clear();
+}
+
+void RenderQueue::submit(const DrawPacket &packet)
+{
+    mPackets.push_back(packet);
+}
+
+void RenderQueue::sort()
+{
+    size_t count = mPackets.size();
+    mOrder.resize(count);
+    mScratch.resize(count);
+    mKeys.resize(count);
+    mScratchKeys.resize(count);
+
+    uint64_t differing = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        mOrder[i] = (uint32_t)i;
+        mKeys[i] = mPackets[i].mKey;
+        differing |= mKeys[i] ^ mKeys[0];
+    }
+
+    // Least significant digit first, 8 bits a pass. Digits that are the
+    // same in every key are skipped, most frames only sort a few.
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        if (((differing >> shift) & 0xFF) == 0)
+        {
+            continue;
+        }
+
+        size_t offsets[256] = {};
+        for (size_t i = 0; i < count; i++)
+        {
+            offsets[(mKeys[i] >> shift) & 0xFF]++;
+        }
+        size_t total = 0;
+        for (size_t &offset : offsets)
+        {
+            size_t digitCount = offset;
+            offset = total;
+            total += digitCount;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t destination = offsets[(mKeys[i] >> shift) & 0xFF]++;
+            mScratch[destination] = mOrder[i];
+            mScratchKeys[destination] = mKeys[i];
+        }
+        mOrder.swap(mScratch);
+        mKeys.swap(mScratchKeys);
+    }
+}
+
+void RenderBackend::execute(const RenderQueue &queue)
+{
+    mStats = Stats();
+
+    // Sources written by earlier frames are likely overwritten by now
+    mInstanceOffset = -1;
+    mObjectOffset = -1;
+
+    uint32_t pass = PassCount;
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        const DrawPacket &packet = queue[i];
+
+        if (GetSortKeyPass(packet.mKey) != pass)
+        {
+            pass = GetSortKeyPass(packet.mKey);
+            mState.setDepthFunc(mPassStates[pass].mDepthFunc);
+            mState.setDepthMask(mPassStates[pass].mDepthWrite);
+            mState.setColorMask(mPassStates[pass].mColorWrite);
+        }
+
+        mState.setEnabled(GL_CULL_FACE, packet.mCullBackFaces);
+        mState.useProgram(packet.mProgram);
+        mState.bindVertexArray(packet.mVertexArray);
+
+        if (packet.mObjectBuffer != 0 && (packet.mObjectBuffer != mObjectBuffer || packet.mObjectOffset != mObjectOffset))
+        {
+            glBindBufferRange(GL_UNIFORM_BUFFER, gObjectBlockBinding, packet.mObjectBuffer, packet.mObjectOffset, sizeof(ObjectBlock));
+            mObjectBuffer = packet.mObjectBuffer;
+            mObjectOffset = packet.mObjectOffset;
+            mStats.objectRangeChanges++;
+        }
+
+        if (packet.mInstanceCount == 0)
+        {
+            GLCheck(glDrawElements(GL_TRIANGLES, packet.mIndexCount, packet.mIndexType, (const void *)packet.mIndexOffset));
+            mStats.draws++;
+            mStats.triangles += packet.mIndexCount / 3;
+            continue;
+        }
+
+        if (packet.mVertexArray != mInstanceVertexArray || packet.mInstanceBuffer != mInstanceBuffer || packet.mInstanceOffset != mInstanceOffset)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, packet.mInstanceBuffer);
+            SetInstanceAttributes(packet.mInstanceOffset);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            mInstanceVertexArray = packet.mVertexArray;
+            mInstanceBuffer = packet.mInstanceBuffer;
+            mInstanceOffset = packet.mInstanceOffset;
+            mStats.instanceSourceChanges++;
+        }
+
+        GLCheck(glDrawElementsInstanced(GL_TRIANGLES, packet.mIndexCount, packet.mIndexType, (const void *)packet.mIndexOffset, packet.mInstanceCount));
+        mStats.draws++;
+        mStats.triangles += (size_t)(packet.mIndexCount / 3) * packet.mInstanceCount;
+    }
+
+    // Clears and draws outside the queue expect the defaults
+    mState.setDepthFunc(GL_LESS);
+    mState.setDepthMask(true);
+    mState.setColorMask(true);
+}
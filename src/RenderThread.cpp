@@ -0,0 +1,120 @@
+#include "RenderThread.hpp"
+#include "CpuProfiler.hpp"
+
+#include <chrono>
+#include <iostream>
+
+RenderThread::RenderThread()
+{
+}
+
+RenderThread::~RenderThread()
+{
+    stop();
+}
+
+void RenderThread::start(SDL_Window *window, SDL_GLContext context, RenderFunction render)
+{
+    mWindow = window;
+    mContext = context;
+    mRender = render;
+    mStopping = false;
+    mWriteIndex = 0;
+    mReadIndex = 0;
+    mQueued = 0;
+
+    // A context can only be current on one thread
+    SDL_GL_MakeCurrent(mWindow, nullptr);
+    mThread = std::thread(&RenderThread::threadMain, this);
+}
+
+void RenderThread::stop()
+{
+    if (!mThread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mChanged.notify_all();
+    mThread.join();
+
+    SDL_GL_MakeCurrent(mWindow, mContext);
+}
+
+FrameCommands &RenderThread::beginFrame()
+{
+    CpuScope scope("WaitForRender");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mChanged.wait(lock, [this]
+                  { return mQueued < gFramesInFlight; });
+
+    mLastWaitTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // The render thread is done with this slot
+    FrameCommands &frame = mFrames[mWriteIndex];
+    for (CommandBuffer &buffer : frame.mBuffers)
+    {
+        buffer.reset();
+    }
+    frame.mTasks.clear();
+    frame.mCullModels.clear();
+    return frame;
+}
+
+void RenderThread::submitFrame()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mWriteIndex = (mWriteIndex + 1) % gFramesInFlight;
+        mQueued++;
+    }
+    mChanged.notify_all();
+}
+
+void RenderThread::threadMain()
+{
+    if (SDL_GL_MakeCurrent(mWindow, mContext) != 0)
+    {
+        std::cout << "Render thread could not make the GL context current: " << SDL_GetError() << std::endl;
+        exit(1);
+    }
+    CpuProfilerSetThreadName("Render");
+
+    while (true)
+    {
+        FrameCommands *frame = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mChanged.wait(lock, [this]
+                          { return mStopping || mQueued > 0; });
+
+            // Frames already submitted are still replayed on the way out
+            if (mQueued == 0)
+            {
+                break;
+            }
+            frame = &mFrames[mReadIndex];
+        }
+
+        for (std::function<void()> &task : frame->mTasks)
+        {
+            task();
+        }
+        mRender(*frame);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mReadIndex = (mReadIndex + 1) % gFramesInFlight;
+            mQueued--;
+        }
+        mChanged.notify_all();
+    }
+
+    SDL_GL_MakeCurrent(mWindow, nullptr);
+}
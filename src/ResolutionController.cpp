@@ -0,0 +1,108 @@
+#include "ResolutionController.hpp"
+
+#include "GpuProfiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Fraction of the budget the smoothed time is steered towards, and the
+// band around it that is left alone
+const double gTargetHeadroom = 0.85;
+const double gUpperHeadroom = 0.95;
+const double gLowerHeadroom = 0.70;
+
+// Weight of each new sample in the smoothed time
+const double gSmoothing = 0.2;
+
+// Largest change per adjustment
+const float gMaxScaleDrop = 0.15f;
+const float gMaxScaleRise = 0.05f;
+
+// New samples to skip after a change. Results arrive gGpuProfilerFrames
+// late, so the first few still show the old scale.
+const int gSettleSamples = gGpuProfilerFrames + 3;
+
+int ScaleRenderSize(int size, float scale)
+{
+    return std::max((int)std::lround(size * scale), 1);
+}
+
+static float ClampScale(float scale)
+{
+    // Snap, then clamp so the range ends are reachable whatever the step
+    scale = std::round(scale / gRenderScaleStep) * gRenderScaleStep;
+    return std::min(std::max(scale, gRenderScaleMin), gRenderScaleMax);
+}
+
+ResolutionController::ResolutionController()
+{
+}
+
+void ResolutionController::initialize(float scale, double budget)
+{
+    mBudget = budget;
+    setScale(scale);
+}
+
+void ResolutionController::setEnabled(bool enabled)
+{
+    mEnabled = enabled;
+    mHasTime = false;
+    mSettleFrames = 0;
+}
+
+void ResolutionController::setScale(float scale)
+{
+    mScale = ClampScale(scale);
+    mHasTime = false;
+    mSettleFrames = gSettleSamples;
+}
+
+bool ResolutionController::update(const RollingStats &gpuFrameTimes)
+{
+    if (gpuFrameTimes.getTotalCount() == mSeen)
+    {
+        return false;
+    }
+    mSeen = gpuFrameTimes.getTotalCount();
+    double time = gpuFrameTimes.getLast();
+
+    if (!mEnabled || mBudget <= 0.0)
+    {
+        return false;
+    }
+    if (mSettleFrames > 0)
+    {
+        mSettleFrames--;
+        return false;
+    }
+
+    if (!mHasTime)
+    {
+        mSmoothedTime = time;
+        mHasTime = true;
+    }
+    else
+    {
+        mSmoothedTime += (time - mSmoothedTime) * gSmoothing;
+    }
+
+    if (mSmoothedTime <= 0.0 || (mSmoothedTime < mBudget * gUpperHeadroom && mSmoothedTime > mBudget * gLowerHeadroom))
+    {
+        return false;
+    }
+
+    // Pixels go with the square of the scale
+    float wanted = mScale * (float)std::sqrt(mBudget * gTargetHeadroom / mSmoothedTime);
+    wanted = std::min(std::max(wanted, mScale - gMaxScaleDrop), mScale + gMaxScaleRise);
+    wanted = ClampScale(wanted);
+    if (wanted == mScale)
+    {
+        return false;
+    }
+
+    mScale = wanted;
+    mHasTime = false;
+    mSettleFrames = gSettleSamples;
+    return true;
+}
@@ -0,0 +1,73 @@
+#include "RollingStats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+RollingStats::RollingStats(size_t windowSize)
+    : mWindowSize(windowSize > 0 ? windowSize : 1)
+{
+    mSamples.reserve(mWindowSize);
+}
+
+void RollingStats::add(double value)
+{
+    if (mSamples.size() < mWindowSize)
+    {
+        mSamples.push_back(value);
+    }
+    else
+    {
+        mSamples[mNext] = value;
+    }
+    mNext = (mNext + 1) % mWindowSize;
+    mLast = value;
+    mTotalCount++;
+}
+
+void RollingStats::clear()
+{
+    mSamples.clear();
+    mNext = 0;
+    mLast = 0.0;
+    mTotalCount = 0;
+}
+
+double RollingStats::getMin() const
+{
+    return mSamples.empty() ? 0.0 : *std::min_element(mSamples.begin(), mSamples.end());
+}
+
+double RollingStats::getMax() const
+{
+    return mSamples.empty() ? 0.0 : *std::max_element(mSamples.begin(), mSamples.end());
+}
+
+double RollingStats::getAverage() const
+{
+    if (mSamples.empty())
+    {
+        return 0.0;
+    }
+
+    double sum = 0.0;
+    for (double sample : mSamples)
+    {
+        sum += sample;
+    }
+    return sum / mSamples.size();
+}
+
+double RollingStats::getPercentile(double percentile) const
+{
+    if (mSamples.empty())
+    {
+        return 0.0;
+    }
+
+    std::vector<double> sorted = mSamples;
+    size_t rank = (size_t)std::ceil(percentile / 100.0 * sorted.size());
+    rank = std::min(std::max(rank, (size_t)1), sorted.size()) - 1;
+
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+}
@@ -0,0 +1,423 @@
+#include "SceneIndex.hpp"
+#include "SimdLanes.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+
+// Rebuild once refits have grown the root surface area by this factor
+const float gSceneRebuildGrowth = 1.5f;
+
+static float SurfaceArea(const glm::vec3 &min, const glm::vec3 &max)
+{
+    glm::vec3 size = max - min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+SceneIndex::ObjectId SceneIndex::insert(const Bounds &bounds)
+{
+    ObjectId object = (ObjectId)mObjectBounds.size();
+    mObjectBounds.push_back(bounds);
+    mObjectSlot.push_back(0);
+    mObjectLeaf.push_back(0);
+    mNeedsBuild = true;
+    return object;
+}
+
+void SceneIndex::update(ObjectId object, const Bounds &bounds)
+{
+    mObjectBounds[object] = bounds;
+
+    if (mNeedsBuild)
+    {
+        return;
+    }
+
+    uint32_t slot = mObjectSlot[object];
+    mSlotMinX[slot] = bounds.mMin.x;
+    mSlotMinY[slot] = bounds.mMin.y;
+    mSlotMinZ[slot] = bounds.mMin.z;
+    mSlotMaxX[slot] = bounds.mMax.x;
+    mSlotMaxY[slot] = bounds.mMax.y;
+    mSlotMaxZ[slot] = bounds.mMax.z;
+
+    mDirtyNodes[mObjectLeaf[object]] = 1;
+    mHasDirty = true;
+}
+
+void SceneIndex::clear()
+{
+    mObjectBounds.clear();
+    mObjectSlot.clear();
+    mObjectLeaf.clear();
+    mNodes.clear();
+    mDirtyNodes.clear();
+    for (std::vector<float> *array : {&mSlotMinX, &mSlotMinY, &mSlotMinZ, &mSlotMaxX, &mSlotMaxY, &mSlotMaxZ})
+    {
+        array->clear();
+    }
+    mSlotObject.clear();
+    mNeedsBuild = true;
+    mHasDirty = false;
+}
+
+void SceneIndex::build()
+{
+    mNodes.clear();
+    mSlotObject.clear();
+    for (std::vector<float> *array : {&mSlotMinX, &mSlotMinY, &mSlotMinZ, &mSlotMaxX, &mSlotMaxY, &mSlotMaxZ})
+    {
+        array->clear();
+    }
+
+    std::vector<uint32_t> objects(mObjectBounds.size());
+    for (uint32_t i = 0; i < objects.size(); i++)
+    {
+        objects[i] = i;
+    }
+
+    if (!objects.empty())
+    {
+        mNodes.reserve(objects.size() / gSceneLeafSize * 2 + 1);
+        mNodes.push_back(Node());
+        buildNode(0, objects.data(), (uint32_t)objects.size(), 0);
+    }
+
+    mDirtyNodes.assign(mNodes.size(), 0);
+    mNeedsBuild = false;
+    mHasDirty = false;
+    mBuildArea = rootArea();
+}
+
+void SceneIndex::buildNode(uint32_t index, uint32_t *objects, uint32_t count, uint32_t parent)
+{
+    Node node;
+    node.mParent = parent;
+    node.mMin = mObjectBounds[objects[0]].mMin;
+    node.mMax = mObjectBounds[objects[0]].mMax;
+
+    glm::vec3 centroidMin = mObjectBounds[objects[0]].mCenter;
+    glm::vec3 centroidMax = centroidMin;
+    for (uint32_t i = 1; i < count; i++)
+    {
+        const Bounds &bounds = mObjectBounds[objects[i]];
+        node.mMin = glm::min(node.mMin, bounds.mMin);
+        node.mMax = glm::max(node.mMax, bounds.mMax);
+        centroidMin = glm::min(centroidMin, bounds.mCenter);
+        centroidMax = glm::max(centroidMax, bounds.mCenter);
+    }
+
+    if (count <= gSceneLeafSize)
+    {
+        node.mFirst = (uint32_t)mSlotObject.size();
+        node.mCount = count;
+
+        for (uint32_t i = 0; i < gSceneLeafSize; i++)
+        {
+            bool used = i < count;
+            ObjectId object = used ? objects[i] : 0;
+            const Bounds &bounds = mObjectBounds[object];
+
+            mSlotMinX.push_back(bounds.mMin.x);
+            mSlotMinY.push_back(bounds.mMin.y);
+            mSlotMinZ.push_back(bounds.mMin.z);
+            mSlotMaxX.push_back(bounds.mMax.x);
+            mSlotMaxY.push_back(bounds.mMax.y);
+            mSlotMaxZ.push_back(bounds.mMax.z);
+            mSlotObject.push_back(object);
+
+            if (used)
+            {
+                mObjectSlot[object] = node.mFirst + i;
+                mObjectLeaf[object] = index;
+            }
+        }
+
+        mNodes[index] = node;
+        return;
+    }
+
+    // Median split along the longest axis of the centroids
+    glm::vec3 extent = centroidMax - centroidMin;
+    int axis = 0;
+    if (extent.y > extent[axis])
+    {
+        axis = 1;
+    }
+    if (extent.z > extent[axis])
+    {
+        axis = 2;
+    }
+
+    uint32_t half = count / 2;
+    std::nth_element(objects, objects + half, objects + count, [this, axis](uint32_t a, uint32_t b)
+                     { return mObjectBounds[a].mCenter[axis] < mObjectBounds[b].mCenter[axis]; });
+
+    // Children are adjacent, reserve both before recursing
+    uint32_t first = (uint32_t)mNodes.size();
+    mNodes.push_back(Node());
+    mNodes.push_back(Node());
+    node.mFirst = first;
+    node.mCount = 0;
+    mNodes[index] = node;
+
+    buildNode(first, objects, half, index);
+    buildNode(first + 1, objects + half, count - half, index);
+}
+
+void SceneIndex::commit()
+{
+    if (mNeedsBuild)
+    {
+        build();
+        return;
+    }
+
+    if (!mHasDirty)
+    {
+        return;
+    }
+
+    // Children always come after their parent, so one backwards pass
+    // refits every dirty path bottom-up
+    for (size_t i = mNodes.size(); i-- > 0;)
+    {
+        if (!mDirtyNodes[i])
+        {
+            continue;
+        }
+        mDirtyNodes[i] = 0;
+
+        Node &node = mNodes[i];
+        if (node.mCount > 0)
+        {
+            refitLeaf((uint32_t)i);
+        }
+        else
+        {
+            const Node &left = mNodes[node.mFirst];
+            const Node &right = mNodes[node.mFirst + 1];
+            node.mMin = glm::min(left.mMin, right.mMin);
+            node.mMax = glm::max(left.mMax, right.mMax);
+        }
+
+        if (i != 0)
+        {
+            mDirtyNodes[node.mParent] = 1;
+        }
+    }
+    mHasDirty = false;
+
+    if (rootArea() > mBuildArea * gSceneRebuildGrowth)
+    {
+        build();
+    }
+}
+
+void SceneIndex::refitLeaf(uint32_t index)
+{
+    Node &node = mNodes[index];
+    node.mMin = glm::vec3(mSlotMinX[node.mFirst], mSlotMinY[node.mFirst], mSlotMinZ[node.mFirst]);
+    node.mMax = glm::vec3(mSlotMaxX[node.mFirst], mSlotMaxY[node.mFirst], mSlotMaxZ[node.mFirst]);
+
+    for (uint32_t slot = node.mFirst + 1; slot < node.mFirst + node.mCount; slot++)
+    {
+        node.mMin = glm::min(node.mMin, glm::vec3(mSlotMinX[slot], mSlotMinY[slot], mSlotMinZ[slot]));
+        node.mMax = glm::max(node.mMax, glm::vec3(mSlotMaxX[slot], mSlotMaxY[slot], mSlotMaxZ[slot]));
+    }
+}
+
+float SceneIndex::rootArea() const
+{
+    return mNodes.empty() ? 0.0f : SurfaceArea(mNodes[0].mMin, mNodes[0].mMax);
+}
+
+void SceneIndex::cull(const Frustum &frustum, std::vector<ObjectId> &visible)
+{
+    commit();
+
+    mCullStats = CullStats();
+    size_t visibleBefore = visible.size();
+    if (!mNodes.empty())
+    {
+        cullTree<SimdLanes>(frustum, 0, visible, mStack, mCullStats);
+    }
+    mCullStats.visible = visible.size() - visibleBefore;
+}
+
+void SceneIndex::cullScalar(const Frustum &frustum, std::vector<ObjectId> &visible)
+{
+    commit();
+
+    mCullStats = CullStats();
+    size_t visibleBefore = visible.size();
+    if (!mNodes.empty())
+    {
+        cullTree<ScalarLanes>(frustum, 0, visible, mStack, mCullStats);
+    }
+    mCullStats.visible = visible.size() - visibleBefore;
+}
+
+void SceneIndex::getSubtrees(size_t count, std::vector<uint32_t> &roots) const
+{
+    roots.clear();
+    if (mNodes.empty())
+    {
+        return;
+    }
+
+    // Split the widest level until there are enough roots or only leaves
+    roots.push_back(0);
+    bool split = true;
+    while (roots.size() < count && split)
+    {
+        split = false;
+        for (size_t i = 0, levelSize = roots.size(); i < levelSize && roots.size() < count; i++)
+        {
+            const Node &node = mNodes[roots[i]];
+            if (node.mCount == 0)
+            {
+                roots[i] = node.mFirst;
+                roots.push_back(node.mFirst + 1);
+                split = true;
+            }
+        }
+    }
+}
+
+void SceneIndex::cullSubtree(const Frustum &frustum, uint32_t root, std::vector<ObjectId> &visible, std::vector<uint32_t> &stack, CullStats &stats) const
+{
+    size_t visibleBefore = visible.size();
+    cullTree<SimdLanes>(frustum, root, visible, stack, stats);
+    stats.visible += visible.size() - visibleBefore;
+}
+
+// Classify a box against the planes in planeMask. Returns false when it is
+// fully outside one plane, otherwise clears the bits of planes the box is
+// fully inside so children skip them.
+static bool TestNode(const glm::vec3 &min, const glm::vec3 &max, const Frustum &frustum, unsigned int &planeMask)
+{
+    for (int i = 0; i < Frustum::PlaneCount; i++)
+    {
+        if (!(planeMask & (1u << i)))
+        {
+            continue;
+        }
+
+        const glm::vec4 &plane = frustum.mPlanes[i];
+
+        // Corner furthest along the normal, and the one furthest against it
+        glm::vec3 positive(plane.x > 0.0f ? max.x : min.x, plane.y > 0.0f ? max.y : min.y, plane.z > 0.0f ? max.z : min.z);
+        glm::vec3 negative(plane.x > 0.0f ? min.x : max.x, plane.y > 0.0f ? min.y : max.y, plane.z > 0.0f ? min.z : max.z);
+
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f)
+        {
+            return false;
+        }
+        if (glm::dot(glm::vec3(plane), negative) + plane.w >= 0.0f)
+        {
+            planeMask &= ~(1u << i);
+        }
+    }
+    return true;
+}
+
+template <typename Lanes>
+void SceneIndex::cullTree(const Frustum &frustum, uint32_t root, std::vector<ObjectId> &visible, std::vector<uint32_t> &stack, CullStats &stats) const
+{
+    const unsigned int allPlanes = (1u << Frustum::PlaneCount) - 1;
+
+    // Node index and remaining plane mask, pushed as pairs
+    stack.clear();
+    stack.push_back(root);
+    stack.push_back(allPlanes);
+
+    while (!stack.empty())
+    {
+        unsigned int planeMask = stack.back();
+        stack.pop_back();
+        uint32_t index = stack.back();
+        stack.pop_back();
+
+        const Node &node = mNodes[index];
+        stats.nodesVisited++;
+
+        if (!TestNode(node.mMin, node.mMax, frustum, planeMask))
+        {
+            continue;
+        }
+
+        // Fully inside, everything below is visible without more tests
+        if (planeMask == 0)
+        {
+            emitSubtree(index, visible);
+            continue;
+        }
+
+        if (node.mCount > 0)
+        {
+            cullLeaf<Lanes>(node, frustum, planeMask, visible, stats);
+        }
+        else
+        {
+            stack.push_back(node.mFirst);
+            stack.push_back(planeMask);
+            stack.push_back(node.mFirst + 1);
+            stack.push_back(planeMask);
+        }
+    }
+}
+
+template <typename Lanes>
+void SceneIndex::cullLeaf(const Node &node, const Frustum &frustum, unsigned int planeMask, std::vector<ObjectId> &visible, CullStats &stats) const
+{
+    typedef typename Lanes::V V;
+
+    V zero = Lanes::set(0.0f);
+
+    for (uint32_t group = 0; group < node.mCount; group += (uint32_t)Lanes::Width)
+    {
+        uint32_t first = node.mFirst + group;
+        int outside = 0;
+
+        for (int i = 0; i < Frustum::PlaneCount; i++)
+        {
+            if (!(planeMask & (1u << i)))
+            {
+                continue;
+            }
+
+            const glm::vec4 &plane = frustum.mPlanes[i];
+
+            // The sign of the normal picks the same corner for every lane
+            V px = Lanes::load((plane.x > 0.0f ? mSlotMaxX : mSlotMinX).data() + first);
+            V py = Lanes::load((plane.y > 0.0f ? mSlotMaxY : mSlotMinY).data() + first);
+            V pz = Lanes::load((plane.z > 0.0f ? mSlotMaxZ : mSlotMinZ).data() + first);
+
+            V distance = Lanes::add(Lanes::add(Lanes::mul(px, Lanes::set(plane.x)), Lanes::mul(py, Lanes::set(plane.y))),
+                                    Lanes::add(Lanes::mul(pz, Lanes::set(plane.z)), Lanes::set(plane.w)));
+            outside |= Lanes::lessMask(distance, zero);
+        }
+
+        stats.boxesTested += Lanes::Width;
+
+        for (uint32_t lane = 0; lane < Lanes::Width && group + lane < node.mCount; lane++)
+        {
+            if (!(outside & (1 << lane)))
+            {
+                visible.push_back(mSlotObject[first + lane]);
+            }
+        }
+    }
+}
+
+void SceneIndex::emitSubtree(uint32_t index, std::vector<ObjectId> &visible) const
+{
+    const Node &node = mNodes[index];
+    if (node.mCount > 0)
+    {
+        visible.insert(visible.end(), mSlotObject.begin() + node.mFirst, mSlotObject.begin() + node.mFirst + node.mCount);
+        return;
+    }
+    emitSubtree(node.mFirst, visible);
+    emitSubtree(node.mFirst + 1, visible);
+}
@@ -0,0 +1,136 @@
+#include "ShaderPermutation.hpp"
+#include "ShaderReloader.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+// Bit order of ShaderFeatures
+static const char *const gFeatureDefines[] = {
+    "FEATURE_INSTANCED",
+    "FEATURE_PACKED_POSITIONS",
+    "FEATURE_VERTEX_COLOR",
+    "FEATURE_TEXTURE",
+    "FEATURE_DEPTH_ONLY",
+};
+
+static_assert(sizeof(gFeatureDefines) / sizeof(gFeatureDefines[0]) == 5, "One define per feature bit");
+
+std::string ReadShaderFile(const std::string &path)
+{
+    // One read into a string sized from the file, not a copy per line
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    std::string result;
+    if (file)
+    {
+        result.resize((size_t)file.tellg());
+        file.seekg(0);
+        file.read(&result[0], (std::streamsize)result.size());
+    }
+    return result;
+}
+
+std::string GetPermutationDefines(ShaderFeatures features)
+{
+    std::string defines;
+    for (uint32_t bit = 0; bit < sizeof(gFeatureDefines) / sizeof(gFeatureDefines[0]); bit++)
+    {
+        if (((uint32_t)features & (1u << bit)) != 0)
+        {
+            defines += "#define ";
+            defines += gFeatureDefines[bit];
+            defines += "\n";
+        }
+    }
+    return defines;
+}
+
+std::string InjectDefines(const std::string &source, const std::string &defines)
+{
+    if (defines.empty())
+    {
+        return source;
+    }
+
+    size_t version = source.find("#version");
+    if (version == std::string::npos)
+    {
+        return defines + source;
+    }
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos)
+    {
+        return source + "\n" + defines;
+    }
+
+    // The line after #version keeps its number
+    size_t nextLine = (size_t)std::count(source.begin(), source.begin() + lineEnd, '\n') + 2;
+    return source.substr(0, lineEnd + 1) + defines + "#line " + std::to_string(nextLine) + "\n" + source.substr(lineEnd + 1);
+}
+
+ShaderPermutations::ShaderPermutations()
+{
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+    destroy();
+}
+
+void ShaderPermutations::initialize(ProgramCache *cache, ShaderReloader *reloader, const std::string &directory,
+                                    const std::string &vertexFile, const std::string &fragmentFile)
+{
+    mCache = cache;
+    mReloader = reloader;
+    mDirectory = directory;
+    mVertexFile = vertexFile;
+    mFragmentFile = fragmentFile;
+}
+
+ShaderProgram &ShaderPermutations::get(ShaderFeatures features)
+{
+    std::unordered_map<uint32_t, std::unique_ptr<ShaderProgram>>::iterator it = mPrograms.find((uint32_t)features);
+    if (it != mPrograms.end())
+    {
+        return *it->second;
+    }
+
+    if (!IsValidPermutation(features))
+    {
+        std::cout << "Illegal shader features 0x" << std::hex << (uint32_t)features << std::dec << " for " << mVertexFile << std::endl;
+        exit(1);
+    }
+
+    // Read now, so a permutation first used after an edit sees it
+    std::string defines = GetPermutationDefines(features);
+    std::string vertexSource = InjectDefines(ReadShaderFile(mDirectory + "/" + mVertexFile), defines);
+    std::string fragmentSource = InjectDefines(ReadShaderFile(mDirectory + "/" + mFragmentFile), defines);
+
+    std::unique_ptr<ShaderProgram> program(new ShaderProgram());
+    if (mCache != nullptr)
+    {
+        program->adopt(mCache->load(vertexSource, fragmentSource));
+    }
+    else
+    {
+        program->create(vertexSource, fragmentSource);
+    }
+
+    if (mReloader != nullptr)
+    {
+        mReloader->watch(program.get(), mVertexFile, mFragmentFile, defines);
+    }
+
+    ShaderProgram &result = *program;
+    mPrograms[(uint32_t)features] = std::move(program);
+    return result;
+}
+
+void ShaderPermutations::destroy()
+{
+    for (std::pair<const uint32_t, std::unique_ptr<ShaderProgram>> &entry : mPrograms)
+    {
+        entry.second->destroy();
+    }
+    mPrograms.clear();
+}
@@ -0,0 +1,414 @@
+#include "ShaderProgram.hpp"
+#include "UniformBlocks.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+GLuint CompileShader(GLuint type, const std::string &source)
+{
+    GLuint shaderObject;
+
+    if (type == GL_VERTEX_SHADER)
+    {
+        shaderObject = glCreateShader(GL_VERTEX_SHADER);
+    }
+    else if (type == GL_FRAGMENT_SHADER)
+    {
+        shaderObject = glCreateShader(GL_FRAGMENT_SHADER);
+    }
+    else if (type == GL_GEOMETRY_SHADER)
+    {
+        shaderObject = glCreateShader(GL_GEOMETRY_SHADER);
+    }
+    else
+    {
+        std::cout << "Only Vertex, Geometry and Fragment shaders are supported" << std::endl;
+        exit(1);
+    }
+
+    const char *charSource = source.c_str();
+    glShaderSource(shaderObject, 1, &charSource, nullptr);
+    glCompileShader(shaderObject);
+
+    // Check for compilation errors, rewrite later
+    GLint isCompiled = 0;
+    glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &isCompiled);
+    if (isCompiled == GL_FALSE)
+    {
+        GLint maxLength = 0;
+        glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &maxLength);
+
+        std::vector<char> infoLog(maxLength);
+        glGetShaderInfoLog(shaderObject, maxLength, &maxLength, &infoLog[0]);
+
+        glDeleteShader(shaderObject);
+
+        std::cout << "Shader compilation error: " << std::string(infoLog.begin(), infoLog.end()) << std::endl;
+        exit(1);
+    }
+
+    return shaderObject;
+}
+
+GLuint CreateShaderProgram(const std::string &vertexShaderSource, const std::string &fragmentShaderSource, bool retrievable)
+{
+    GLuint programObject = glCreateProgram();
+
+    GLuint myVertexShader = CompileShader(GL_VERTEX_SHADER, vertexShaderSource);
+    GLuint myFragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+
+    glAttachShader(programObject, myVertexShader);
+    glAttachShader(programObject, myFragmentShader);
+
+    if (retrievable)
+    {
+        glProgramParameteri(programObject, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    glLinkProgram(programObject);
+
+    // Check for linking errors, rewrite later
+    GLint isLinked = 0;
+    glGetProgramiv(programObject, GL_LINK_STATUS, &isLinked);
+    if (isLinked == GL_FALSE)
+    {
+        GLint maxLength = 0;
+        glGetProgramiv(programObject, GL_INFO_LOG_LENGTH, &maxLength);
+
+        std::vector<char> infoLog(maxLength);
+        glGetProgramInfoLog(programObject, maxLength, &maxLength, &infoLog[0]);
+
+        glDeleteProgram(programObject);
+        glDeleteShader(myVertexShader);
+        glDeleteShader(myFragmentShader);
+
+        std::cout << "Program linking error: " << std::string(infoLog.begin(), infoLog.end()) << std::endl;
+        exit(1);
+    }
+
+    // Detach and delete shaders after linking
+    glDetachShader(programObject, myVertexShader);
+    glDetachShader(programObject, myFragmentShader);
+    glDeleteShader(myVertexShader);
+    glDeleteShader(myFragmentShader);
+
+    return programObject;
+}
+
+// Size in bytes of one element of a uniform type, 0 when not cached
+static size_t UniformTypeSize(GLenum type)
+{
+    switch (type)
+    {
+    case GL_FLOAT:
+        return sizeof(GLfloat);
+    case GL_FLOAT_VEC2:
+        return sizeof(GLfloat) * 2;
+    case GL_FLOAT_VEC3:
+        return sizeof(GLfloat) * 3;
+    case GL_FLOAT_VEC4:
+        return sizeof(GLfloat) * 4;
+    case GL_FLOAT_MAT3:
+        return sizeof(GLfloat) * 9;
+    case GL_FLOAT_MAT4:
+        return sizeof(GLfloat) * 16;
+    case GL_INT:
+    case GL_BOOL:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_BUFFER:
+    case GL_SAMPLER_CUBE:
+        return sizeof(GLint);
+    default:
+        return 0;
+    }
+}
+
+// Arrays are reported as "name[0]", store them under the plain name
+static std::string StripArraySuffix(const std::string &name)
+{
+    size_t bracket = name.find('[');
+    return bracket == std::string::npos ? name : name.substr(0, bracket);
+}
+
+ShaderProgram::ShaderProgram()
+{
+}
+
+ShaderProgram::~ShaderProgram()
+{
+    destroy();
+}
+
+void ShaderProgram::create(const std::string &vertexShaderSource, const std::string &fragmentShaderSource)
+{
+    adopt(CreateShaderProgram(vertexShaderSource, fragmentShaderSource));
+}
+
+void ShaderProgram::adopt(GLuint program)
+{
+    destroy();
+    mProgram = program;
+    reflect();
+}
+
+// Send a cached value, for uniforms carried over to a new program
+static void UploadUniform(const ShaderProgram::Uniform &uniform)
+{
+    const GLfloat *floats = (const GLfloat *)uniform.value.data();
+    const GLint *ints = (const GLint *)uniform.value.data();
+
+    switch (uniform.type)
+    {
+    case GL_FLOAT:
+        glUniform1fv(uniform.location, uniform.size, floats);
+        break;
+    case GL_FLOAT_VEC2:
+        glUniform2fv(uniform.location, uniform.size, floats);
+        break;
+    case GL_FLOAT_VEC3:
+        glUniform3fv(uniform.location, uniform.size, floats);
+        break;
+    case GL_FLOAT_VEC4:
+        glUniform4fv(uniform.location, uniform.size, floats);
+        break;
+    case GL_FLOAT_MAT3:
+        glUniformMatrix3fv(uniform.location, uniform.size, GL_FALSE, floats);
+        break;
+    case GL_FLOAT_MAT4:
+        glUniformMatrix4fv(uniform.location, uniform.size, GL_FALSE, floats);
+        break;
+    default:
+        glUniform1iv(uniform.location, uniform.size, ints);
+        break;
+    }
+}
+
+GLuint ShaderProgram::replace(GLuint program)
+{
+    GLuint previous = mProgram;
+    std::vector<Uniform> previousUniforms = std::move(mUniforms);
+    std::unordered_map<std::string, int> previousTable = std::move(mUniformTable);
+
+    mProgram.store(program, std::memory_order_release);
+    mUniforms.clear();
+    mAttributes.clear();
+    mUniformTable.clear();
+    mAttributeTable.clear();
+    reflect();
+
+    // Put every old name back at its old index. Names the new program
+    // dropped keep their slot with location -1, which GL ignores.
+    std::vector<Uniform> fresh = std::move(mUniforms);
+    std::unordered_map<std::string, int> freshTable = std::move(mUniformTable);
+    mUniforms = std::move(previousUniforms);
+    mUniformTable = std::move(previousTable);
+    for (Uniform &uniform : mUniforms)
+    {
+        std::unordered_map<std::string, int>::iterator it = freshTable.find(uniform.name);
+        if (it == freshTable.end())
+        {
+            uniform.location = -1;
+            uniform.hasValue = false;
+            continue;
+        }
+
+        Uniform &match = fresh[it->second];
+        bool sameType = match.type == uniform.type && match.size == uniform.size;
+        match.hasValue = sameType && uniform.hasValue;
+        if (match.hasValue)
+        {
+            match.value = uniform.value;
+        }
+        uniform = std::move(match);
+        freshTable.erase(it);
+    }
+    for (const std::pair<const std::string, int> &entry : freshTable)
+    {
+        mUniformTable[entry.first] = (int)mUniforms.size();
+        mUniforms.push_back(std::move(fresh[entry.second]));
+    }
+
+    glUseProgram(program);
+    for (const Uniform &uniform : mUniforms)
+    {
+        if (uniform.hasValue && uniform.location >= 0)
+        {
+            UploadUniform(uniform);
+        }
+    }
+
+    return previous;
+}
+
+void ShaderProgram::destroy()
+{
+    if (mProgram != 0)
+    {
+        glDeleteProgram(mProgram);
+        mProgram = 0;
+    }
+    mUniforms.clear();
+    mAttributes.clear();
+    mUniformTable.clear();
+    mAttributeTable.clear();
+}
+
+void ShaderProgram::use() const
+{
+    glUseProgram(mProgram);
+}
+
+void ShaderProgram::reflect()
+{
+    // Rebuilt and cached binaries start with default block bindings
+    BindUniformBlocks(mProgram);
+
+    GLint maxNameLength = 0;
+    glGetProgramiv(mProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    GLint maxAttributeLength = 0;
+    glGetProgramiv(mProgram, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxAttributeLength);
+
+    std::vector<char> nameBuffer(std::max(maxNameLength, maxAttributeLength) + 1);
+
+    GLint uniformCount = 0;
+    glGetProgramiv(mProgram, GL_ACTIVE_UNIFORMS, &uniformCount);
+
+    for (GLint i = 0; i < uniformCount; i++)
+    {
+        Uniform uniform;
+        GLsizei length = 0;
+        glGetActiveUniform(mProgram, i, (GLsizei)nameBuffer.size(), &length, &uniform.size, &uniform.type, nameBuffer.data());
+
+        uniform.name = StripArraySuffix(std::string(nameBuffer.data(), length));
+        uniform.location = glGetUniformLocation(mProgram, uniform.name.c_str());
+
+        // Members of uniform blocks have no location
+        if (uniform.location < 0)
+        {
+            continue;
+        }
+
+        uniform.value.resize(UniformTypeSize(uniform.type) * uniform.size);
+
+        mUniformTable[uniform.name] = (int)mUniforms.size();
+        mUniforms.push_back(std::move(uniform));
+    }
+
+    GLint attributeCount = 0;
+    glGetProgramiv(mProgram, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+
+    for (GLint i = 0; i < attributeCount; i++)
+    {
+        Attribute attribute;
+        GLsizei length = 0;
+        glGetActiveAttrib(mProgram, i, (GLsizei)nameBuffer.size(), &length, &attribute.size, &attribute.type, nameBuffer.data());
+
+        attribute.name = std::string(nameBuffer.data(), length);
+        attribute.location = glGetAttribLocation(mProgram, attribute.name.c_str());
+
+        mAttributeTable[attribute.name] = (int)mAttributes.size();
+        mAttributes.push_back(std::move(attribute));
+    }
+}
+
+int ShaderProgram::findUniform(const std::string &name) const
+{
+    std::unordered_map<std::string, int>::const_iterator it = mUniformTable.find(name);
+    return it == mUniformTable.end() ? -1 : it->second;
+}
+
+GLint ShaderProgram::getUniformLocation(const std::string &name) const
+{
+    int uniform = findUniform(name);
+    return uniform < 0 ? -1 : mUniforms[uniform].location;
+}
+
+GLint ShaderProgram::getAttributeLocation(const std::string &name) const
+{
+    std::unordered_map<std::string, int>::const_iterator it = mAttributeTable.find(name);
+    return it == mAttributeTable.end() ? -1 : mAttributes[it->second].location;
+}
+
+bool ShaderProgram::changed(int uniform, const void *data, size_t size)
+{
+    if (uniform < 0 || uniform >= (int)mUniforms.size())
+    {
+        return false;
+    }
+
+    Uniform &entry = mUniforms[uniform];
+
+    // Types we don't cache, or a mismatched setter, always upload
+    if (entry.value.size() < size)
+    {
+        return true;
+    }
+
+    if (entry.hasValue && std::memcmp(entry.value.data(), data, size) == 0)
+    {
+        mSkippedUploads++;
+        return false;
+    }
+
+    std::memcpy(entry.value.data(), data, size);
+    entry.hasValue = true;
+    return true;
+}
+
+void ShaderProgram::setInt(int uniform, GLint value)
+{
+    if (changed(uniform, &value, sizeof(value)))
+    {
+        glUniform1i(mUniforms[uniform].location, value);
+    }
+}
+
+void ShaderProgram::setFloat(int uniform, GLfloat value)
+{
+    if (changed(uniform, &value, sizeof(value)))
+    {
+        glUniform1f(mUniforms[uniform].location, value);
+    }
+}
+
+void ShaderProgram::setVec2(int uniform, const glm::vec2 &value)
+{
+    if (changed(uniform, &value[0], sizeof(GLfloat) * 2))
+    {
+        glUniform2fv(mUniforms[uniform].location, 1, &value[0]);
+    }
+}
+
+void ShaderProgram::setVec3(int uniform, const glm::vec3 &value)
+{
+    if (changed(uniform, &value[0], sizeof(GLfloat) * 3))
+    {
+        glUniform3fv(mUniforms[uniform].location, 1, &value[0]);
+    }
+}
+
+void ShaderProgram::setVec4(int uniform, const glm::vec4 &value)
+{
+    if (changed(uniform, &value[0], sizeof(GLfloat) * 4))
+    {
+        glUniform4fv(mUniforms[uniform].location, 1, &value[0]);
+    }
+}
+
+void ShaderProgram::setMat3(int uniform, const glm::mat3 &value)
+{
+    if (changed(uniform, &value[0][0], sizeof(GLfloat) * 9))
+    {
+        glUniformMatrix3fv(mUniforms[uniform].location, 1, GL_FALSE, &value[0][0]);
+    }
+}
+
+void ShaderProgram::setMat4(int uniform, const glm::mat4 &value)
+{
+    if (changed(uniform, &value[0][0], sizeof(GLfloat) * 16))
+    {
+        glUniformMatrix4fv(mUniforms[uniform].location, 1, GL_FALSE, &value[0][0]);
+    }
+}
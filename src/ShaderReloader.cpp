@@ -0,0 +1,198 @@
+#include "ShaderReloader.hpp"
+#include "ShaderPermutation.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+ShaderReloader::ShaderReloader()
+{
+}
+
+ShaderReloader::~ShaderReloader()
+{
+    mWatcher.stop();
+}
+
+void ShaderReloader::start(const std::string &directory)
+{
+    mDirectory = directory;
+    mParallel = GLAD_GL_KHR_parallel_shader_compile != 0;
+    if (mParallel)
+    {
+        // Let the driver pick the number of compiler threads
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+    }
+
+    if (mWatcher.start(directory))
+    {
+        std::cout << "Watching " << directory << " for shader changes" << (mParallel ? " (parallel compile)" : "") << std::endl;
+    }
+}
+
+void ShaderReloader::stop()
+{
+    mWatcher.stop();
+
+    for (Entry &entry : mEntries)
+    {
+        cancelBuild(entry);
+    }
+    mEntries.clear();
+
+    for (const Retired &retired : mRetired)
+    {
+        glDeleteProgram(retired.mProgram);
+    }
+    mRetired.clear();
+}
+
+void ShaderReloader::watch(ShaderProgram *program, const std::string &vertexFile, const std::string &fragmentFile, const std::string &defines)
+{
+    Entry entry;
+    entry.mProgram = program;
+    entry.mVertexFile = vertexFile;
+    entry.mFragmentFile = fragmentFile;
+    entry.mDefines = defines;
+    mEntries.push_back(entry);
+}
+
+bool ShaderReloader::update()
+{
+    // Old programs go once no frame in flight can reference them
+    for (size_t i = 0; i < mRetired.size();)
+    {
+        if (--mRetired[i].mFramesLeft > 0)
+        {
+            i++;
+            continue;
+        }
+        glDeleteProgram(mRetired[i].mProgram);
+        mRetired[i] = mRetired.back();
+        mRetired.pop_back();
+    }
+
+    mWatcher.takeChanges(mChanges);
+    for (Entry &entry : mEntries)
+    {
+        bool changed = std::find(mChanges.begin(), mChanges.end(), entry.mVertexFile) != mChanges.end() ||
+                       std::find(mChanges.begin(), mChanges.end(), entry.mFragmentFile) != mChanges.end();
+        if (changed)
+        {
+            // A newer save supersedes a build still running
+            cancelBuild(entry);
+            beginBuild(entry);
+        }
+    }
+
+    bool swapped = false;
+    for (Entry &entry : mEntries)
+    {
+        if (entry.mPendingProgram != 0)
+        {
+            swapped = finishBuild(entry) || swapped;
+        }
+    }
+    return swapped;
+}
+
+void ShaderReloader::beginBuild(Entry &entry)
+{
+    std::string vertexSource = InjectDefines(ReadShaderFile(mDirectory + "/" + entry.mVertexFile), entry.mDefines);
+    std::string fragmentSource = InjectDefines(ReadShaderFile(mDirectory + "/" + entry.mFragmentFile), entry.mDefines);
+    const char *vertexText = vertexSource.c_str();
+    const char *fragmentText = fragmentSource.c_str();
+
+    // No status queries here, they would wait for the compiler
+    entry.mPendingVertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(entry.mPendingVertex, 1, &vertexText, nullptr);
+    glCompileShader(entry.mPendingVertex);
+
+    entry.mPendingFragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(entry.mPendingFragment, 1, &fragmentText, nullptr);
+    glCompileShader(entry.mPendingFragment);
+
+    entry.mPendingProgram = glCreateProgram();
+    glAttachShader(entry.mPendingProgram, entry.mPendingVertex);
+    glAttachShader(entry.mPendingProgram, entry.mPendingFragment);
+    glLinkProgram(entry.mPendingProgram);
+}
+
+bool ShaderReloader::finishBuild(Entry &entry)
+{
+    if (mParallel)
+    {
+        GLint complete = GL_FALSE;
+        glGetProgramiv(entry.mPendingProgram, GL_COMPLETION_STATUS_KHR, &complete);
+        if (complete == GL_FALSE)
+        {
+            return false;
+        }
+    }
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(entry.mPendingProgram, GL_LINK_STATUS, &linked);
+    if (linked == GL_FALSE)
+    {
+        std::cout << "Reload of " << entry.mVertexFile << " + " << entry.mFragmentFile << " failed, keeping the old program" << std::endl;
+        std::cout << getLog(entry.mPendingVertex, false) << getLog(entry.mPendingFragment, false) << getLog(entry.mPendingProgram, true);
+        cancelBuild(entry);
+        return false;
+    }
+
+    GLuint program = entry.mPendingProgram;
+    entry.mPendingProgram = 0;
+    cancelBuild(entry);
+
+    Retired retired = {entry.mProgram->replace(program), gRetiredProgramFrames};
+    mRetired.push_back(retired);
+
+    std::cout << "Reloaded " << entry.mVertexFile << " + " << entry.mFragmentFile << std::endl;
+    return true;
+}
+
+void ShaderReloader::cancelBuild(Entry &entry)
+{
+    if (entry.mPendingProgram != 0)
+    {
+        glDeleteProgram(entry.mPendingProgram);
+        entry.mPendingProgram = 0;
+    }
+    if (entry.mPendingVertex != 0)
+    {
+        glDeleteShader(entry.mPendingVertex);
+        entry.mPendingVertex = 0;
+    }
+    if (entry.mPendingFragment != 0)
+    {
+        glDeleteShader(entry.mPendingFragment);
+        entry.mPendingFragment = 0;
+    }
+}
+
+std::string ShaderReloader::getLog(GLuint object, bool program) const
+{
+    GLint length = 0;
+    if (program)
+    {
+        glGetProgramiv(object, GL_INFO_LOG_LENGTH, &length);
+    }
+    else
+    {
+        glGetShaderiv(object, GL_INFO_LOG_LENGTH, &length);
+    }
+    if (length <= 1)
+    {
+        return std::string();
+    }
+
+    std::vector<char> log(length);
+    if (program)
+    {
+        glGetProgramInfoLog(object, length, &length, log.data());
+    }
+    else
+    {
+        glGetShaderInfoLog(object, length, &length, log.data());
+    }
+    return std::string(log.data(), length) + "\n";
+}
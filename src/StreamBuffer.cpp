@@ -0,0 +1,155 @@
+#include "StreamBuffer.hpp"
+
+#include <iostream>
+
+StreamBuffer::StreamBuffer()
+{
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    destroy();
+}
+
+void StreamBuffer::create(GLenum target, GLsizeiptr frameSize)
+{
+    destroy();
+
+    mTarget = target;
+    mFrameSize = frameSize;
+    mPersistent = GLAD_GL_ARB_buffer_storage != 0;
+
+    GLsizeiptr totalSize = frameSize * gStreamBufferFrames;
+
+    glGenBuffers(1, &mBuffer);
+    glBindBuffer(mTarget, mBuffer);
+
+    if (mPersistent)
+    {
+        // Immutable storage mapped once for the lifetime of the buffer
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(mTarget, totalSize, nullptr, flags);
+        mPersistentBase = (unsigned char *)glMapBufferRange(mTarget, 0, totalSize, flags);
+
+        if (mPersistentBase == nullptr)
+        {
+            std::cout << "Stream buffer persistent map failed" << std::endl;
+            exit(1);
+        }
+    }
+    else
+    {
+        glBufferData(mTarget, totalSize, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(mTarget, 0);
+}
+
+void StreamBuffer::destroy()
+{
+    for (GLsync &fence : mFences)
+    {
+        if (fence != nullptr)
+        {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    if (mBuffer != 0)
+    {
+        if (mPersistentBase != nullptr || mRegion != nullptr)
+        {
+            glBindBuffer(mTarget, mBuffer);
+            glUnmapBuffer(mTarget);
+            glBindBuffer(mTarget, 0);
+        }
+        glDeleteBuffers(1, &mBuffer);
+    }
+
+    mBuffer = 0;
+    mPersistentBase = nullptr;
+    mRegion = nullptr;
+    mRegionUsed = 0;
+    mFrameIndex = 0;
+}
+
+void StreamBuffer::beginFrame()
+{
+    GLsync &fence = mFences[mFrameIndex];
+
+    if (fence != nullptr)
+    {
+        // Normally already signaled, the region was last used two frames ago
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            mStallCount++;
+            while (result == GL_TIMEOUT_EXPIRED)
+            {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            }
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    GLintptr regionOffset = mFrameSize * mFrameIndex;
+    mRegionUsed = 0;
+
+    if (mPersistent)
+    {
+        mRegion = mPersistentBase + regionOffset;
+    }
+    else
+    {
+        // The fence guarantees the GPU is done, so skip the driver's own sync
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+        glBindBuffer(mTarget, mBuffer);
+        mRegion = (unsigned char *)glMapBufferRange(mTarget, regionOffset, mFrameSize, flags);
+        glBindBuffer(mTarget, 0);
+    }
+}
+
+void *StreamBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment, GLintptr *offset)
+{
+    if (mRegion == nullptr)
+    {
+        return nullptr;
+    }
+
+    GLsizeiptr start = (mRegionUsed + alignment - 1) / alignment * alignment;
+    if (start + size > mFrameSize)
+    {
+        return nullptr;
+    }
+
+    mRegionUsed = start + size;
+    *offset = mFrameSize * mFrameIndex + start;
+
+    return mRegion + start;
+}
+
+void StreamBuffer::commit()
+{
+    if (!mPersistent && mRegion != nullptr)
+    {
+        glBindBuffer(mTarget, mBuffer);
+        glUnmapBuffer(mTarget);
+        glBindBuffer(mTarget, 0);
+        mRegion = nullptr;
+    }
+}
+
+void StreamBuffer::endFrame()
+{
+    commit();
+
+    mFences[mFrameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    mFrameIndex = (mFrameIndex + 1) % gStreamBufferFrames;
+
+    if (mPersistent)
+    {
+        mRegion = nullptr;
+    }
+}
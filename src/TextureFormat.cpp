@@ -0,0 +1,339 @@
+#include "TextureFormat.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Container format codes mapped to GL: a DXGI format for DDS, a
+// VkFormat for KTX2
+struct CompressedFormat
+{
+    uint32_t mCode;
+    uint32_t mInternalFormat;
+    uint32_t mBlockBytes;
+    const char *mName;
+};
+
+static const CompressedFormat gDxgiFormats[] = {
+    {71, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8, "BC1"},
+    {72, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 8, "BC1 sRGB"},
+    {74, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 16, "BC2"},
+    {75, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, 16, "BC2 sRGB"},
+    {77, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16, "BC3"},
+    {78, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 16, "BC3 sRGB"},
+    {80, GL_COMPRESSED_RED_RGTC1, 8, "BC4"},
+    {81, GL_COMPRESSED_SIGNED_RED_RGTC1, 8, "BC4 signed"},
+    {83, GL_COMPRESSED_RG_RGTC2, 16, "BC5"},
+    {84, GL_COMPRESSED_SIGNED_RG_RGTC2, 16, "BC5 signed"},
+    {95, GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_ARB, 16, "BC6H"},
+    {96, GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT_ARB, 16, "BC6H signed"},
+    {98, GL_COMPRESSED_RGBA_BPTC_UNORM_ARB, 16, "BC7"},
+    {99, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB, 16, "BC7 sRGB"},
+};
+
+static const CompressedFormat gVkFormats[] = {
+    {131, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8, "BC1 RGB"},
+    {132, GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 8, "BC1 RGB sRGB"},
+    {133, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8, "BC1"},
+    {134, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 8, "BC1 sRGB"},
+    {135, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 16, "BC2"},
+    {136, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, 16, "BC2 sRGB"},
+    {137, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16, "BC3"},
+    {138, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 16, "BC3 sRGB"},
+    {139, GL_COMPRESSED_RED_RGTC1, 8, "BC4"},
+    {140, GL_COMPRESSED_SIGNED_RED_RGTC1, 8, "BC4 signed"},
+    {141, GL_COMPRESSED_RG_RGTC2, 16, "BC5"},
+    {142, GL_COMPRESSED_SIGNED_RG_RGTC2, 16, "BC5 signed"},
+    {143, GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_ARB, 16, "BC6H"},
+    {144, GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT_ARB, 16, "BC6H signed"},
+    {145, GL_COMPRESSED_RGBA_BPTC_UNORM_ARB, 16, "BC7"},
+    {146, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB, 16, "BC7 sRGB"},
+    {147, GL_COMPRESSED_RGB8_ETC2, 8, "ETC2 RGB"},
+    {148, GL_COMPRESSED_SRGB8_ETC2, 8, "ETC2 RGB sRGB"},
+    {149, GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, 8, "ETC2 RGB A1"},
+    {150, GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2, 8, "ETC2 RGB A1 sRGB"},
+    {151, GL_COMPRESSED_RGBA8_ETC2_EAC, 16, "ETC2 RGBA"},
+    {152, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 16, "ETC2 RGBA sRGB"},
+    {153, GL_COMPRESSED_R11_EAC, 8, "EAC R11"},
+    {154, GL_COMPRESSED_SIGNED_R11_EAC, 8, "EAC R11 signed"},
+    {155, GL_COMPRESSED_RG11_EAC, 16, "EAC RG11"},
+    {156, GL_COMPRESSED_SIGNED_RG11_EAC, 16, "EAC RG11 signed"},
+};
+
+static const uint32_t gDdsMagic = 0x20534444; // "DDS "
+static const size_t gDdsHeaderSize = 128;
+static const size_t gDdsDx10HeaderSize = 20;
+
+static const unsigned char gKtx2Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+static const size_t gKtx2HeaderSize = 80;
+static const size_t gKtx2LevelIndexEntrySize = 24;
+
+static uint32_t ReadU32(const unsigned char *data, size_t offset)
+{
+    uint32_t value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+static uint64_t ReadU64(const unsigned char *data, size_t offset)
+{
+    uint64_t value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+static uint32_t FourCC(char a, char b, char c, char d)
+{
+    return (uint32_t)(unsigned char)a | (uint32_t)(unsigned char)b << 8 | (uint32_t)(unsigned char)c << 16 | (uint32_t)(unsigned char)d << 24;
+}
+
+template <size_t N>
+static const CompressedFormat *FindFormat(const CompressedFormat (&formats)[N], uint32_t code)
+{
+    for (const CompressedFormat &format : formats)
+    {
+        if (format.mCode == code)
+        {
+            return &format;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t GetCompressedLevelSize(uint32_t blockBytes, uint32_t width, uint32_t height)
+{
+    return (uint64_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+}
+
+const char *GetTextureFormatName(uint32_t internalFormat)
+{
+    for (const CompressedFormat &format : gVkFormats)
+    {
+        if (format.mInternalFormat == internalFormat)
+        {
+            return format.mName;
+        }
+    }
+    return "unknown";
+}
+
+// Fill in the level sizes from the base size, true when there is room
+// for levelCount levels
+static bool SetLevelSizes(TextureFileInfo &info, const std::string &name)
+{
+    if (info.mWidth == 0 || info.mHeight == 0)
+    {
+        std::cout << "Texture " << name << " is empty" << std::endl;
+        return false;
+    }
+    if (info.mLevelCount == 0 || info.mLevelCount > gTextureMaxLevels)
+    {
+        std::cout << "Texture " << name << " has " << info.mLevelCount << " levels, at most " << gTextureMaxLevels << " are supported" << std::endl;
+        return false;
+    }
+
+    for (uint32_t level = 0; level < info.mLevelCount; level++)
+    {
+        TextureLevel &out = info.mLevels[level];
+        out.mWidth = std::max(info.mWidth >> level, 1u);
+        out.mHeight = std::max(info.mHeight >> level, 1u);
+        out.mSize = GetCompressedLevelSize(info.mBlockBytes, out.mWidth, out.mHeight);
+    }
+    return true;
+}
+
+static bool ParseDds(const unsigned char *data, size_t size, const std::string &name, TextureFileInfo &info)
+{
+    if (size < gDdsHeaderSize || ReadU32(data, 4) != 124)
+    {
+        std::cout << "Texture " << name << " has a truncated DDS header" << std::endl;
+        return false;
+    }
+
+    const uint32_t mipMapCountFlag = 0x20000;
+    const uint32_t fourCCFlag = 0x4;
+    const uint32_t cubeMapFlag = 0x200;
+    const uint32_t volumeFlag = 0x200000;
+
+    uint32_t flags = ReadU32(data, 8);
+    info.mHeight = ReadU32(data, 12);
+    info.mWidth = ReadU32(data, 16);
+    info.mLevelCount = (flags & mipMapCountFlag) ? std::max(ReadU32(data, 28), 1u) : 1;
+
+    uint32_t pixelFlags = ReadU32(data, 80);
+    uint32_t fourCC = ReadU32(data, 84);
+    uint32_t caps2 = ReadU32(data, 112);
+
+    if (caps2 & (cubeMapFlag | volumeFlag))
+    {
+        std::cout << "Texture " << name << " is a cube map or volume, only 2D textures are supported" << std::endl;
+        return false;
+    }
+    if (!(pixelFlags & fourCCFlag))
+    {
+        std::cout << "Texture " << name << " is not block compressed" << std::endl;
+        return false;
+    }
+
+    const CompressedFormat *format = nullptr;
+    size_t dataOffset = gDdsHeaderSize;
+
+    if (fourCC == FourCC('D', 'X', '1', '0'))
+    {
+        if (size < gDdsHeaderSize + gDdsDx10HeaderSize)
+        {
+            std::cout << "Texture " << name << " has a truncated DX10 header" << std::endl;
+            return false;
+        }
+
+        const uint32_t texture2D = 3;
+        const uint32_t cubeMiscFlag = 0x4;
+
+        uint32_t dxgiFormat = ReadU32(data, gDdsHeaderSize);
+        uint32_t dimension = ReadU32(data, gDdsHeaderSize + 4);
+        uint32_t miscFlag = ReadU32(data, gDdsHeaderSize + 8);
+        uint32_t arraySize = ReadU32(data, gDdsHeaderSize + 12);
+
+        if (dimension != texture2D || arraySize > 1 || (miscFlag & cubeMiscFlag))
+        {
+            std::cout << "Texture " << name << " is not a single 2D texture" << std::endl;
+            return false;
+        }
+
+        format = FindFormat(gDxgiFormats, dxgiFormat);
+        dataOffset += gDdsDx10HeaderSize;
+    }
+    else if (fourCC == FourCC('D', 'X', 'T', '1'))
+    {
+        format = FindFormat(gDxgiFormats, 71);
+    }
+    else if (fourCC == FourCC('D', 'X', 'T', '3'))
+    {
+        format = FindFormat(gDxgiFormats, 74);
+    }
+    else if (fourCC == FourCC('D', 'X', 'T', '5'))
+    {
+        format = FindFormat(gDxgiFormats, 77);
+    }
+    else if (fourCC == FourCC('A', 'T', 'I', '1') || fourCC == FourCC('B', 'C', '4', 'U'))
+    {
+        format = FindFormat(gDxgiFormats, 80);
+    }
+    else if (fourCC == FourCC('A', 'T', 'I', '2') || fourCC == FourCC('B', 'C', '5', 'U'))
+    {
+        format = FindFormat(gDxgiFormats, 83);
+    }
+
+    if (format == nullptr)
+    {
+        std::cout << "Texture " << name << " has an unsupported DDS format" << std::endl;
+        return false;
+    }
+
+    info.mInternalFormat = format->mInternalFormat;
+    info.mBlockBytes = format->mBlockBytes;
+    if (!SetLevelSizes(info, name))
+    {
+        return false;
+    }
+
+    // Levels follow the headers back to back, largest first
+    uint64_t offset = dataOffset;
+    for (uint32_t level = 0; level < info.mLevelCount; level++)
+    {
+        info.mLevels[level].mOffset = offset;
+        offset += info.mLevels[level].mSize;
+    }
+    if (offset > size)
+    {
+        std::cout << "Texture " << name << " is truncated, levels need " << offset << " bytes" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool ParseKtx2(const unsigned char *data, size_t size, const std::string &name, TextureFileInfo &info)
+{
+    if (size < gKtx2HeaderSize)
+    {
+        std::cout << "Texture " << name << " has a truncated KTX2 header" << std::endl;
+        return false;
+    }
+
+    uint32_t vkFormat = ReadU32(data, 12);
+    info.mWidth = ReadU32(data, 20);
+    info.mHeight = ReadU32(data, 24);
+    uint32_t depth = ReadU32(data, 28);
+    uint32_t layers = ReadU32(data, 32);
+    uint32_t faces = ReadU32(data, 36);
+    uint32_t levels = ReadU32(data, 40);
+    uint32_t supercompression = ReadU32(data, 44);
+
+    if (depth != 0 || layers > 1 || faces != 1)
+    {
+        std::cout << "Texture " << name << " is not a single 2D texture" << std::endl;
+        return false;
+    }
+    if (supercompression != 0)
+    {
+        std::cout << "Texture " << name << " uses supercompression scheme " << supercompression << ", transcode it to BCn or ETC2 first" << std::endl;
+        return false;
+    }
+
+    const CompressedFormat *format = FindFormat(gVkFormats, vkFormat);
+    if (format == nullptr)
+    {
+        std::cout << "Texture " << name << " has unsupported VkFormat " << vkFormat << std::endl;
+        return false;
+    }
+
+    // Zero levels asks the loader to generate mips, there is only the base
+    info.mInternalFormat = format->mInternalFormat;
+    info.mBlockBytes = format->mBlockBytes;
+    info.mLevelCount = std::max(levels, 1u);
+    if (!SetLevelSizes(info, name))
+    {
+        return false;
+    }
+
+    if (size < gKtx2HeaderSize + info.mLevelCount * gKtx2LevelIndexEntrySize)
+    {
+        std::cout << "Texture " << name << " has a truncated level index" << std::endl;
+        return false;
+    }
+
+    for (uint32_t level = 0; level < info.mLevelCount; level++)
+    {
+        size_t entry = gKtx2HeaderSize + level * gKtx2LevelIndexEntrySize;
+        uint64_t offset = ReadU64(data, entry);
+        uint64_t length = ReadU64(data, entry + 8);
+
+        TextureLevel &out = info.mLevels[level];
+        if (length != out.mSize || offset > size || length > size - offset)
+        {
+            std::cout << "Texture " << name << " level " << level << " does not match its size or lies outside the file" << std::endl;
+            return false;
+        }
+        out.mOffset = offset;
+    }
+    return true;
+}
+
+bool ParseTextureFile(const unsigned char *data, size_t size, const std::string &name, TextureFileInfo &info)
+{
+    info = TextureFileInfo();
+
+    if (size >= sizeof(gKtx2Identifier) && std::memcmp(data, gKtx2Identifier, sizeof(gKtx2Identifier)) == 0)
+    {
+        return ParseKtx2(data, size, name, info);
+    }
+    if (size >= sizeof(uint32_t) && ReadU32(data, 0) == gDdsMagic)
+    {
+        return ParseDds(data, size, name, info);
+    }
+
+    std::cout << "Texture " << name << " is neither DDS nor KTX2" << std::endl;
+    return false;
+}
@@ -0,0 +1,542 @@
+#include "CpuProfiler.hpp"
+#include "TextureStreamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// Level offsets inside a staging buffer
+const size_t gTextureStagingAlignment = 16;
+
+static size_t AlignStaging(size_t offset)
+{
+    return (offset + gTextureStagingAlignment - 1) / gTextureStagingAlignment * gTextureStagingAlignment;
+}
+
+// Whether the context can sample a format from TextureFormat
+static bool IsFormatSupported(uint32_t internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        return GLAD_GL_EXT_texture_compression_s3tc != 0;
+    case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+        return GLAD_GL_EXT_texture_compression_s3tc != 0 && GLAD_GL_EXT_texture_sRGB != 0;
+    case GL_COMPRESSED_RED_RGTC1:
+    case GL_COMPRESSED_SIGNED_RED_RGTC1:
+    case GL_COMPRESSED_RG_RGTC2:
+    case GL_COMPRESSED_SIGNED_RG_RGTC2:
+        return true;
+    case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT_ARB:
+    case GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT_ARB:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM_ARB:
+    case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM_ARB:
+        return GLAD_GL_ARB_texture_compression_bptc != 0;
+    default:
+        // ETC2 and EAC
+        return GLAD_GL_ARB_ES3_compatibility != 0;
+    }
+}
+
+TextureStreamer::TextureStreamer()
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    stop();
+}
+
+void TextureStreamer::start(JobSystem &jobSystem, size_t budget)
+{
+    mJobSystem = &jobSystem;
+    mBudget = budget;
+    mStopping = false;
+}
+
+void TextureStreamer::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+
+    // Copies skip their work once stopping, so this returns quickly
+    if (mJobSystem != nullptr)
+    {
+        mJobSystem->wait(mPending);
+    }
+
+    for (Upload &upload : mUploads)
+    {
+        if (upload.entry != nullptr)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.buffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            upload.entry = nullptr;
+        }
+        if (upload.buffer != 0)
+        {
+            glDeleteBuffers(1, &upload.buffer);
+            upload.buffer = 0;
+            upload.capacity = 0;
+        }
+    }
+
+    for (Entry *entry : mEntries)
+    {
+        if (entry->object != 0)
+        {
+            glDeleteTextures(1, &entry->object);
+        }
+        mEntryPool.destroy(entry);
+    }
+    mEntries.clear();
+    mReady.clear();
+    mResidentBytes = 0;
+    mInFlightBytes = 0;
+}
+
+TextureStreamer::Texture TextureStreamer::load(const std::string &path)
+{
+    Entry *queued = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        queued = mEntryPool.create();
+        queued->path = path;
+        mEntries.push_back(queued);
+        queued->texture = (Texture)mEntries.size();
+    }
+
+    EntryJob data = {this, queued};
+    mJobSystem->run(mJobSystem->create(&TextureStreamer::mapFileJob, data), &mPending);
+
+    return queued->texture;
+}
+
+void TextureStreamer::mapFileJob(Job *, const void *data)
+{
+    CpuScope scope("MapTexture");
+    const EntryJob *entryJob = (const EntryJob *)data;
+    entryJob->streamer->mapFile(*entryJob->entry);
+}
+
+void TextureStreamer::copyLevelsJob(Job *, const void *data)
+{
+    CpuScope scope("CopyTextureLevels");
+    const UploadJob *uploadJob = (const UploadJob *)data;
+    uploadJob->streamer->copyLevels(*uploadJob->upload);
+}
+
+void TextureStreamer::mapFile(Entry &entry)
+{
+    State next = State::Ready;
+
+    if (!entry.file.open(entry.path))
+    {
+        std::cout << "Could not open texture " << entry.path << std::endl;
+        next = State::Failed;
+    }
+    else if (!ParseTextureFile(entry.file.getData(), entry.file.getSize(), entry.path, entry.info))
+    {
+        entry.file.close();
+        next = State::Failed;
+    }
+    else
+    {
+        // The tail starts at the first level no larger than gTextureTailSize
+        const TextureFileInfo &info = entry.info;
+        entry.tailLevel = info.mLevelCount - 1;
+        for (uint32_t level = 0; level < info.mLevelCount; level++)
+        {
+            if (std::max(info.mLevels[level].mWidth, info.mLevels[level].mHeight) <= gTextureTailSize)
+            {
+                entry.tailLevel = level;
+                break;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    entry.state = next;
+}
+
+void TextureStreamer::copyLevels(Upload &upload)
+{
+    bool stopping;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        stopping = mStopping;
+    }
+
+    if (!stopping)
+    {
+        const Entry &entry = *upload.entry;
+        for (uint32_t level = upload.firstLevel; level <= upload.lastLevel; level++)
+        {
+            const TextureLevel &source = entry.info.mLevels[level];
+            std::memcpy(upload.destination + upload.offsets[level], entry.file.getData() + source.mOffset, (size_t)source.mSize);
+        }
+    }
+
+    upload.copied.store(true, std::memory_order_release);
+}
+
+void TextureStreamer::requestResidency(Texture texture, float pixels)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Entry *entry = findEntry(texture);
+    if (entry != nullptr)
+    {
+        entry->requestedPixels = std::max(entry->requestedPixels, pixels);
+    }
+}
+
+uint32_t TextureStreamer::getWantedLevel(const Entry &entry, float pixels) const
+{
+    // Each level halves the size, pick the one whose texels match the
+    // screen coverage
+    float size = (float)std::max(entry.info.mWidth, entry.info.mHeight);
+    if (pixels >= size)
+    {
+        return 0;
+    }
+    float level = std::floor(std::log2(size / std::max(pixels, 1.0f)));
+    return std::min((uint32_t)level, entry.tailLevel);
+}
+
+bool TextureStreamer::update()
+{
+    mFrame++;
+    bool calledGL = false;
+
+    for (Upload &upload : mUploads)
+    {
+        if (upload.entry != nullptr && upload.copied.load(std::memory_order_acquire))
+        {
+            finishUpload(upload);
+            calledGL = true;
+        }
+    }
+
+    // Take this frame's requests
+    mReady.clear();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (Entry *entry : mEntries)
+        {
+            if (entry->state != State::Ready)
+            {
+                continue;
+            }
+            if (entry->requestedPixels > 0.0f)
+            {
+                entry->wantedLevel = getWantedLevel(*entry, entry->requestedPixels);
+                entry->lastUsedFrame = mFrame;
+                entry->requestedPixels = 0.0f;
+            }
+            mReady.push_back(entry);
+        }
+    }
+
+    for (Entry *entry : mReady)
+    {
+        if (entry->object == 0)
+        {
+            createTexture(*entry);
+            calledGL = true;
+        }
+    }
+
+    size_t started = 0;
+    for (Upload &upload : mUploads)
+    {
+        if (upload.entry != nullptr)
+        {
+            continue;
+        }
+        if (started >= gTextureUploadBytesPerFrame)
+        {
+            break;
+        }
+
+        Entry *entry = pickUpload();
+        if (entry == nullptr)
+        {
+            break;
+        }
+
+        // The whole tail at once, then one finer level at a time
+        bool tail = entry->residentLevel == entry->info.mLevelCount;
+        uint32_t firstLevel = tail ? entry->tailLevel : entry->residentLevel - 1;
+        uint32_t lastLevel = tail ? entry->info.mLevelCount - 1 : firstLevel;
+
+        size_t bytes = 0;
+        for (uint32_t level = firstLevel; level <= lastLevel; level++)
+        {
+            bytes += (size_t)entry->info.mLevels[level].mSize;
+        }
+
+        // Tails are small and always admitted so every texture can be drawn
+        if (!makeRoom(bytes, entry) && !tail)
+        {
+            break;
+        }
+        calledGL = true;
+        if (!beginUpload(upload, *entry, firstLevel, lastLevel))
+        {
+            break;
+        }
+        started += bytes;
+    }
+
+    return calledGL;
+}
+
+void TextureStreamer::createTexture(Entry &entry)
+{
+    const TextureFileInfo &info = entry.info;
+
+    if (!IsFormatSupported(info.mInternalFormat))
+    {
+        std::cout << "Texture " << entry.path << " is " << GetTextureFormatName(info.mInternalFormat) << ", which this context can't sample" << std::endl;
+        entry.file.close();
+        std::lock_guard<std::mutex> lock(mMutex);
+        entry.state = State::Failed;
+        return;
+    }
+
+    glGenTextures(1, &entry.object);
+    glBindTexture(GL_TEXTURE_2D, entry.object);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)entry.tailLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)info.mLevelCount - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    entry.residentLevel = info.mLevelCount;
+}
+
+TextureStreamer::Entry *TextureStreamer::pickUpload() const
+{
+    // Missing tails first, then textures drawn this frame, then the ones
+    // furthest from the level they want
+    Entry *best = nullptr;
+    for (Entry *entry : mReady)
+    {
+        if (entry->object == 0 || entry->uploading || entry->wantedLevel >= entry->residentLevel)
+        {
+            continue;
+        }
+        if (entry->residentLevel == entry->info.mLevelCount)
+        {
+            return entry;
+        }
+        if (best == nullptr)
+        {
+            best = entry;
+            continue;
+        }
+
+        bool used = entry->lastUsedFrame == mFrame;
+        bool bestUsed = best->lastUsedFrame == mFrame;
+        uint32_t gap = entry->residentLevel - entry->wantedLevel;
+        uint32_t bestGap = best->residentLevel - best->wantedLevel;
+        if (used != bestUsed ? used : gap > bestGap)
+        {
+            best = entry;
+        }
+    }
+    return best;
+}
+
+bool TextureStreamer::makeRoom(size_t bytes, const Entry *keep)
+{
+    while (mResidentBytes + mInFlightBytes + bytes > mBudget)
+    {
+        // Least recently requested first, and among equals the textures
+        // holding levels finer than they want. Levels wanted this frame
+        // are never dropped, that would only stream them straight back.
+        Entry *victim = nullptr;
+        for (Entry *entry : mReady)
+        {
+            if (entry == keep || entry->object == 0 || entry->uploading || entry->residentLevel >= entry->tailLevel)
+            {
+                continue;
+            }
+
+            bool spare = entry->residentLevel < entry->wantedLevel;
+            if (!spare && entry->lastUsedFrame == mFrame)
+            {
+                continue;
+            }
+
+            if (victim == nullptr || entry->lastUsedFrame < victim->lastUsedFrame ||
+                (entry->lastUsedFrame == victim->lastUsedFrame && spare && victim->residentLevel >= victim->wantedLevel))
+            {
+                victim = entry;
+            }
+        }
+
+        if (victim == nullptr)
+        {
+            return false;
+        }
+        evictLevel(*victim);
+    }
+    return true;
+}
+
+void TextureStreamer::evictLevel(Entry &entry)
+{
+    const TextureFileInfo &info = entry.info;
+    uint32_t level = entry.residentLevel;
+
+    // Raise the base level first so the texture stays complete, then
+    // redefine the level as empty to release its storage
+    glBindTexture(GL_TEXTURE_2D, entry.object);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)level + 1);
+    glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, info.mInternalFormat, 0, 0, 0, 0, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    mResidentBytes -= (size_t)info.mLevels[level].mSize;
+    entry.residentLevel = level + 1;
+    mEvictionCount++;
+}
+
+bool TextureStreamer::beginUpload(Upload &upload, Entry &entry, uint32_t firstLevel, uint32_t lastLevel)
+{
+    size_t size = 0;
+    size_t bytes = 0;
+    for (uint32_t level = firstLevel; level <= lastLevel; level++)
+    {
+        upload.offsets[level] = size;
+        size = AlignStaging(size + (size_t)entry.info.mLevels[level].mSize);
+        bytes += (size_t)entry.info.mLevels[level].mSize;
+    }
+
+    if (upload.buffer == 0)
+    {
+        glGenBuffers(1, &upload.buffer);
+    }
+
+    // Buffers only grow, invalidating the range on map lets the driver
+    // hand out fresh storage while the last upload may still read it
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.buffer);
+    if (size > upload.capacity)
+    {
+        upload.capacity = size;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)upload.capacity, nullptr, GL_STREAM_DRAW);
+    }
+    void *destination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (destination == nullptr)
+    {
+        std::cout << "Could not map a staging buffer for texture " << entry.path << std::endl;
+        return false;
+    }
+
+    upload.entry = &entry;
+    upload.firstLevel = firstLevel;
+    upload.lastLevel = lastLevel;
+    upload.bytes = bytes;
+    upload.destination = (unsigned char *)destination;
+    upload.copied.store(false, std::memory_order_relaxed);
+
+    entry.uploading = true;
+    mInFlightBytes += bytes;
+
+    UploadJob data = {this, &upload};
+    mJobSystem->run(mJobSystem->create(&TextureStreamer::copyLevelsJob, data), &mPending);
+    return true;
+}
+
+void TextureStreamer::finishUpload(Upload &upload)
+{
+    Entry &entry = *upload.entry;
+    const TextureFileInfo &info = entry.info;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.buffer);
+    if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE)
+    {
+        // Sourced from the bound unpack buffer, the pointer is an offset
+        glBindTexture(GL_TEXTURE_2D, entry.object);
+        for (uint32_t level = upload.firstLevel; level <= upload.lastLevel; level++)
+        {
+            const TextureLevel &source = info.mLevels[level];
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, info.mInternalFormat, (GLsizei)source.mWidth, (GLsizei)source.mHeight, 0,
+                                   (GLsizei)source.mSize, (const void *)(uintptr_t)upload.offsets[level]);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)upload.firstLevel);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        entry.residentLevel = upload.firstLevel;
+        mResidentBytes += upload.bytes;
+        mUploadCount++;
+        mUploadedBytes += upload.bytes;
+    }
+    // Unmap fails when the driver lost the storage, the level is retried
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    mInFlightBytes -= upload.bytes;
+    entry.uploading = false;
+    upload.entry = nullptr;
+    upload.destination = nullptr;
+}
+
+TextureStreamer::Entry *TextureStreamer::findEntry(Texture texture) const
+{
+    if (texture == 0 || texture > mEntries.size())
+    {
+        return nullptr;
+    }
+    return mEntries[texture - 1];
+}
+
+GLuint TextureStreamer::getTextureObject(Texture texture) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Entry *entry = findEntry(texture);
+    if (entry == nullptr || entry->object == 0 || entry->residentLevel > entry->tailLevel)
+    {
+        return 0;
+    }
+    return entry->object;
+}
+
+uint32_t TextureStreamer::getResidentLevel(Texture texture) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Entry *entry = findEntry(texture);
+    if (entry == nullptr || entry->object == 0 || entry->residentLevel == entry->info.mLevelCount)
+    {
+        return gTextureMaxLevels;
+    }
+    return entry->residentLevel;
+}
+
+TextureStreamer::Stats TextureStreamer::getStats() const
+{
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        stats.textures = mEntries.size();
+    }
+    stats.residentBytes = mResidentBytes;
+    stats.budget = mBudget;
+    stats.uploads = mUploadCount;
+    stats.uploadedBytes = mUploadedBytes;
+    stats.evictions = mEvictionCount;
+    return stats;
+}
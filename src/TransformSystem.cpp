@@ -0,0 +1,278 @@
+#include "TransformSystem.hpp"
+#include "SimdLanes.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+
+// Write Lanes::Width matrices from twelve component vectors: columns 0-2
+// xyz and the translation. The SIMD versions transpose lanes to columns.
+static void StoreMatrices(const float c[12], glm::mat4 *out)
+{
+    glm::mat4 &m = out[0];
+    m[0] = glm::vec4(c[0], c[1], c[2], 0.0f);
+    m[1] = glm::vec4(c[3], c[4], c[5], 0.0f);
+    m[2] = glm::vec4(c[6], c[7], c[8], 0.0f);
+    m[3] = glm::vec4(c[9], c[10], c[11], 1.0f);
+}
+
+#if defined(SIMD_LANES_SSE)
+// Transpose x, y, z, w rows of four lanes into one column per matrix
+static void StoreColumn(__m128 x, __m128 y, __m128 z, __m128 w, glm::mat4 *out, int column)
+{
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(&out[0][column][0], x);
+    _mm_storeu_ps(&out[1][column][0], y);
+    _mm_storeu_ps(&out[2][column][0], z);
+    _mm_storeu_ps(&out[3][column][0], w);
+}
+
+static void StoreMatrices(const __m128 c[12], glm::mat4 *out)
+{
+    __m128 zero = _mm_setzero_ps();
+    StoreColumn(c[0], c[1], c[2], zero, out, 0);
+    StoreColumn(c[3], c[4], c[5], zero, out, 1);
+    StoreColumn(c[6], c[7], c[8], zero, out, 2);
+    StoreColumn(c[9], c[10], c[11], _mm_set1_ps(1.0f), out, 3);
+}
+#endif
+
+#if defined(SIMD_LANES_SSE) && defined(__AVX__)
+// Split into two halves and reuse the 4-wide transposes
+static void StoreMatrices(const __m256 c[12], glm::mat4 *out)
+{
+    __m128 low[12];
+    __m128 high[12];
+    for (int i = 0; i < 12; i++)
+    {
+        low[i] = _mm256_castps256_ps128(c[i]);
+        high[i] = _mm256_extractf128_ps(c[i], 1);
+    }
+    StoreMatrices(low, out);
+    StoreMatrices(high, out + 4);
+}
+#endif
+
+#if defined(SIMD_LANES_NEON)
+static void StoreColumn(float32x4_t x, float32x4_t y, float32x4_t z, float32x4_t w, glm::mat4 *out, int column)
+{
+    float32x4x2_t xy = vtrnq_f32(x, y);
+    float32x4x2_t zw = vtrnq_f32(z, w);
+    vst1q_f32(&out[0][column][0], vcombine_f32(vget_low_f32(xy.val[0]), vget_low_f32(zw.val[0])));
+    vst1q_f32(&out[1][column][0], vcombine_f32(vget_low_f32(xy.val[1]), vget_low_f32(zw.val[1])));
+    vst1q_f32(&out[2][column][0], vcombine_f32(vget_high_f32(xy.val[0]), vget_high_f32(zw.val[0])));
+    vst1q_f32(&out[3][column][0], vcombine_f32(vget_high_f32(xy.val[1]), vget_high_f32(zw.val[1])));
+}
+
+static void StoreMatrices(const float32x4_t c[12], glm::mat4 *out)
+{
+    float32x4_t zero = vdupq_n_f32(0.0f);
+    StoreColumn(c[0], c[1], c[2], zero, out, 0);
+    StoreColumn(c[3], c[4], c[5], zero, out, 1);
+    StoreColumn(c[6], c[7], c[8], zero, out, 2);
+    StoreColumn(c[9], c[10], c[11], vdupq_n_f32(1.0f), out, 3);
+}
+#endif
+
+// World matrix = translate * rotate(quaternion) * scale, matching
+// glm::mat4_cast for the rotation part
+template <typename Lanes>
+static void BuildMatrices(const float *const components[10], size_t first, glm::mat4 *out)
+{
+    typedef typename Lanes::V V;
+
+    V px = Lanes::load(components[0] + first);
+    V py = Lanes::load(components[1] + first);
+    V pz = Lanes::load(components[2] + first);
+    V qx = Lanes::load(components[3] + first);
+    V qy = Lanes::load(components[4] + first);
+    V qz = Lanes::load(components[5] + first);
+    V qw = Lanes::load(components[6] + first);
+    V sx = Lanes::load(components[7] + first);
+    V sy = Lanes::load(components[8] + first);
+    V sz = Lanes::load(components[9] + first);
+
+    V x2 = Lanes::add(qx, qx);
+    V y2 = Lanes::add(qy, qy);
+    V z2 = Lanes::add(qz, qz);
+
+    V xx = Lanes::mul(qx, x2);
+    V yy = Lanes::mul(qy, y2);
+    V zz = Lanes::mul(qz, z2);
+    V xy = Lanes::mul(qx, y2);
+    V xz = Lanes::mul(qx, z2);
+    V yz = Lanes::mul(qy, z2);
+    V wx = Lanes::mul(qw, x2);
+    V wy = Lanes::mul(qw, y2);
+    V wz = Lanes::mul(qw, z2);
+
+    V one = Lanes::set(1.0f);
+
+    V c[12];
+    c[0] = Lanes::mul(Lanes::sub(one, Lanes::add(yy, zz)), sx);
+    c[1] = Lanes::mul(Lanes::add(xy, wz), sx);
+    c[2] = Lanes::mul(Lanes::sub(xz, wy), sx);
+
+    c[3] = Lanes::mul(Lanes::sub(xy, wz), sy);
+    c[4] = Lanes::mul(Lanes::sub(one, Lanes::add(xx, zz)), sy);
+    c[5] = Lanes::mul(Lanes::add(yz, wx), sy);
+
+    c[6] = Lanes::mul(Lanes::add(xz, wy), sz);
+    c[7] = Lanes::mul(Lanes::sub(yz, wx), sz);
+    c[8] = Lanes::mul(Lanes::sub(one, Lanes::add(xx, yy)), sz);
+
+    c[9] = px;
+    c[10] = py;
+    c[11] = pz;
+
+    StoreMatrices(c, out);
+}
+
+template <typename Lanes>
+static void BuildBlock(const float *const components[10], size_t block, glm::mat4 *matrices)
+{
+    size_t first = block * gTransformBlockSize;
+    for (size_t lane = 0; lane < gTransformBlockSize; lane += Lanes::Width)
+    {
+        BuildMatrices<Lanes>(components, first + lane, matrices + first + lane);
+    }
+}
+
+void TransformSystem::reserve(size_t count)
+{
+    size_t padded = (count + gTransformBlockSize - 1) / gTransformBlockSize * gTransformBlockSize;
+
+    for (std::vector<float> *array : {&mPositionX, &mPositionY, &mPositionZ, &mRotationX, &mRotationY, &mRotationZ, &mRotationW, &mScaleX, &mScaleY, &mScaleZ})
+    {
+        array->reserve(padded);
+    }
+    mWorldMatrices.reserve(padded);
+    mDirtyBlocks.reserve(padded / gTransformBlockSize);
+}
+
+void TransformSystem::clear()
+{
+    mCount = 0;
+    for (std::vector<float> *array : {&mPositionX, &mPositionY, &mPositionZ, &mRotationX, &mRotationY, &mRotationZ, &mRotationW, &mScaleX, &mScaleY, &mScaleZ})
+    {
+        array->clear();
+    }
+    mWorldMatrices.clear();
+    mDirtyBlocks.clear();
+    mUpdatedCount = 0;
+}
+
+TransformSystem::Handle TransformSystem::create(const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale)
+{
+    Handle handle = (Handle)mCount++;
+
+    // Grow by a whole block of identity transforms so SIMD loads stay in range
+    if (handle % gTransformBlockSize == 0)
+    {
+        size_t padded = mPositionX.size() + gTransformBlockSize;
+        for (std::vector<float> *array : {&mPositionX, &mPositionY, &mPositionZ, &mRotationX, &mRotationY, &mRotationZ})
+        {
+            array->resize(padded, 0.0f);
+        }
+        for (std::vector<float> *array : {&mRotationW, &mScaleX, &mScaleY, &mScaleZ})
+        {
+            array->resize(padded, 1.0f);
+        }
+        mWorldMatrices.resize(padded, glm::mat4(1.0f));
+        mDirtyBlocks.push_back(0);
+    }
+
+    setPosition(handle, position);
+    setRotation(handle, rotation);
+    setScale(handle, scale);
+
+    return handle;
+}
+
+void TransformSystem::setPosition(Handle handle, const glm::vec3 &position)
+{
+    mPositionX[handle] = position.x;
+    mPositionY[handle] = position.y;
+    mPositionZ[handle] = position.z;
+    markDirty(handle);
+}
+
+void TransformSystem::setRotation(Handle handle, const glm::quat &rotation)
+{
+    mRotationX[handle] = rotation.x;
+    mRotationY[handle] = rotation.y;
+    mRotationZ[handle] = rotation.z;
+    mRotationW[handle] = rotation.w;
+    markDirty(handle);
+}
+
+void TransformSystem::setScale(Handle handle, const glm::vec3 &scale)
+{
+    mScaleX[handle] = scale.x;
+    mScaleY[handle] = scale.y;
+    mScaleZ[handle] = scale.z;
+    markDirty(handle);
+}
+
+glm::vec3 TransformSystem::getPosition(Handle handle) const
+{
+    return glm::vec3(mPositionX[handle], mPositionY[handle], mPositionZ[handle]);
+}
+
+glm::vec3 TransformSystem::getScale(Handle handle) const
+{
+    return glm::vec3(mScaleX[handle], mScaleY[handle], mScaleZ[handle]);
+}
+
+void TransformSystem::markAllDirty()
+{
+    std::fill(mDirtyBlocks.begin(), mDirtyBlocks.end(), (uint8_t)1);
+}
+
+void TransformSystem::update()
+{
+    mUpdatedCount = updateBlocks(0, mDirtyBlocks.size());
+}
+
+size_t TransformSystem::updateBlocks(size_t firstBlock, size_t lastBlock)
+{
+    const float *const components[10] = {
+        mPositionX.data(), mPositionY.data(), mPositionZ.data(),
+        mRotationX.data(), mRotationY.data(), mRotationZ.data(), mRotationW.data(),
+        mScaleX.data(), mScaleY.data(), mScaleZ.data()};
+
+    size_t updated = 0;
+    for (size_t block = firstBlock; block < lastBlock; block++)
+    {
+        if (mDirtyBlocks[block])
+        {
+            BuildBlock<SimdLanes>(components, block, mWorldMatrices.data());
+            mDirtyBlocks[block] = 0;
+            updated += gTransformBlockSize;
+        }
+    }
+    return updated;
+}
+
+void TransformSystem::updateScalar()
+{
+    const float *const components[10] = {
+        mPositionX.data(), mPositionY.data(), mPositionZ.data(),
+        mRotationX.data(), mRotationY.data(), mRotationZ.data(), mRotationW.data(),
+        mScaleX.data(), mScaleY.data(), mScaleZ.data()};
+
+    mUpdatedCount = 0;
+    for (size_t block = 0; block < mDirtyBlocks.size(); block++)
+    {
+        if (mDirtyBlocks[block])
+        {
+            BuildBlock<ScalarLanes>(components, block, mWorldMatrices.data());
+            mDirtyBlocks[block] = 0;
+            mUpdatedCount += gTransformBlockSize;
+        }
+    }
+}
+
+const char *TransformSystem::getSimdName()
+{
+    return GetSimdLanesName();
+}
@@ -0,0 +1,48 @@
+#include "UniformBlocks.hpp"
+
+// Fixed names so every program finds the same binding point
+struct UniformBlockName
+{
+    const char *mName;
+    GLuint mBinding;
+};
+
+static const UniformBlockName gUniformBlocks[] = {
+    {"FrameData", gFrameBlockBinding},
+    {"ViewData", gViewBlockBinding},
+    {"ObjectData", gObjectBlockBinding},
+};
+
+void BindUniformBlocks(GLuint program)
+{
+    for (const UniformBlockName &block : gUniformBlocks)
+    {
+        GLuint index = glGetUniformBlockIndex(program, block.mName);
+        if (index != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(program, index, block.mBinding);
+        }
+    }
+}
+
+GLsizeiptr GetUniformBufferAlignment()
+{
+    static GLint alignment = 0;
+    if (alignment == 0)
+    {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+        // The spec caps it at 256, use that if the query failed
+        if (alignment <= 0)
+        {
+            alignment = 256;
+        }
+    }
+    return alignment;
+}
+
+GLsizeiptr GetObjectBlockStride()
+{
+    GLsizeiptr alignment = GetUniformBufferAlignment();
+    return ((GLsizeiptr)sizeof(ObjectBlock) + alignment - 1) / alignment * alignment;
+}
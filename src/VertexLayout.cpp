@@ -0,0 +1,226 @@
+#include "VertexLayout.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static uint32_t AddAttribute(VertexLayout *layout, uint32_t location, uint32_t components, uint32_t type, bool normalized, uint32_t size)
+{
+    VertexAttribute &attribute = layout->mAttributes[layout->mAttributeCount++];
+    attribute.mLocation = location;
+    attribute.mComponents = components;
+    attribute.mType = type;
+    attribute.mNormalized = normalized ? 1 : 0;
+    attribute.mOffset = layout->mStride;
+
+    layout->mStride += (size + 3) & ~3u;
+    return attribute.mOffset;
+}
+
+VertexLayout MakeVertexLayout(const VertexFormat &format)
+{
+    VertexLayout layout;
+
+    switch (format.mPosition)
+    {
+    case PositionFormat::Float:
+        AddAttribute(&layout, gPositionAttributeLocation, 3, GL_FLOAT, false, 12);
+        break;
+    case PositionFormat::Half:
+        AddAttribute(&layout, gPositionAttributeLocation, 3, GL_HALF_FLOAT, false, 6);
+        break;
+    case PositionFormat::Snorm16:
+        AddAttribute(&layout, gPositionAttributeLocation, 3, GL_SHORT, true, 6);
+        break;
+    }
+
+    switch (format.mColor)
+    {
+    case ColorFormat::Float:
+        AddAttribute(&layout, gColorAttributeLocation, 3, GL_FLOAT, false, 12);
+        break;
+    case ColorFormat::Unorm8:
+        AddAttribute(&layout, gColorAttributeLocation, 4, GL_UNSIGNED_BYTE, true, 4);
+        break;
+    }
+
+    switch (format.mNormal)
+    {
+    case NormalFormat::None:
+        break;
+    case NormalFormat::Float:
+        AddAttribute(&layout, gNormalAttributeLocation, 3, GL_FLOAT, false, 12);
+        break;
+    case NormalFormat::Int2_10_10_10:
+        AddAttribute(&layout, gNormalAttributeLocation, 4, GL_INT_2_10_10_10_REV, true, 4);
+        break;
+    }
+
+    return layout;
+}
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (exponent >= 31)
+    {
+        // Overflow and infinity clamp to infinity, NaN stays NaN
+        bool nan = ((bits >> 23) & 0xFF) == 0xFF && mantissa != 0;
+        return (uint16_t)(sign | 0x7C00 | (nan ? 0x200 : 0));
+    }
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+        {
+            return (uint16_t)sign;
+        }
+        // Denormal, shift in the implicit bit and round to nearest
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1)
+        {
+            half++;
+        }
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    // Round to nearest, a carry into the exponent is still correct
+    if (mantissa & 0x1000)
+    {
+        half++;
+    }
+    return (uint16_t)half;
+}
+
+static int16_t FloatToSnorm16(float value)
+{
+    return (int16_t)std::lround(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f);
+}
+
+static uint8_t FloatToUnorm8(float value)
+{
+    return (uint8_t)std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f);
+}
+
+static uint32_t PackNormal(const float *normal)
+{
+    uint32_t packed = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        int32_t component = (int32_t)std::lround(std::min(std::max(normal[i], -1.0f), 1.0f) * 511.0f);
+        packed |= ((uint32_t)component & 0x3FF) << (i * 10);
+    }
+    return packed;
+}
+
+static const VertexAttribute *FindAttribute(const VertexLayout &layout, uint32_t location)
+{
+    for (uint32_t i = 0; i < layout.mAttributeCount; i++)
+    {
+        if (layout.mAttributes[i].mLocation == location)
+        {
+            return &layout.mAttributes[i];
+        }
+    }
+    return nullptr;
+}
+
+void PackVertices(const VertexFormat &format, const VertexLayout &layout, const Bounds &bounds,
+                  const float *positions, const float *colors, const float *normals,
+                  size_t vertexCount, size_t stride, std::vector<unsigned char> &out)
+{
+    out.assign(vertexCount * layout.mStride, 0);
+
+    const VertexAttribute *positionAttribute = FindAttribute(layout, gPositionAttributeLocation);
+    const VertexAttribute *colorAttribute = FindAttribute(layout, gColorAttributeLocation);
+    const VertexAttribute *normalAttribute = normals ? FindAttribute(layout, gNormalAttributeLocation) : nullptr;
+
+    glm::vec3 scale;
+    glm::vec3 offset;
+    GetPositionDequantization(*positionAttribute, bounds, &scale, &offset);
+
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        unsigned char *vertex = out.data() + v * layout.mStride;
+        const float *position = positions + v * stride;
+
+        unsigned char *destination = vertex + positionAttribute->mOffset;
+        switch (format.mPosition)
+        {
+        case PositionFormat::Float:
+            std::memcpy(destination, position, sizeof(float) * 3);
+            break;
+        case PositionFormat::Half:
+            for (int i = 0; i < 3; i++)
+            {
+                uint16_t half = FloatToHalf(position[i]);
+                std::memcpy(destination + i * 2, &half, 2);
+            }
+            break;
+        case PositionFormat::Snorm16:
+            for (int i = 0; i < 3; i++)
+            {
+                int16_t snorm = FloatToSnorm16(scale[i] > 0.0f ? (position[i] - offset[i]) / scale[i] : 0.0f);
+                std::memcpy(destination + i * 2, &snorm, 2);
+            }
+            break;
+        }
+
+        if (colorAttribute && colors)
+        {
+            const float *color = colors + v * stride;
+            destination = vertex + colorAttribute->mOffset;
+            if (format.mColor == ColorFormat::Float)
+            {
+                std::memcpy(destination, color, sizeof(float) * 3);
+            }
+            else
+            {
+                destination[0] = FloatToUnorm8(color[0]);
+                destination[1] = FloatToUnorm8(color[1]);
+                destination[2] = FloatToUnorm8(color[2]);
+                destination[3] = 255;
+            }
+        }
+
+        if (normalAttribute)
+        {
+            const float *normal = normals + v * stride;
+            destination = vertex + normalAttribute->mOffset;
+            if (format.mNormal == NormalFormat::Float)
+            {
+                std::memcpy(destination, normal, sizeof(float) * 3);
+            }
+            else
+            {
+                uint32_t packed = PackNormal(normal);
+                std::memcpy(destination, &packed, sizeof(packed));
+            }
+        }
+    }
+}
+
+void GetPositionDequantization(const VertexAttribute &position, const Bounds &bounds, glm::vec3 *scale, glm::vec3 *offset)
+{
+    if (position.mNormalized)
+    {
+        // Normalized positions span the box, [-1, 1] maps to [min, max]
+        *scale = (bounds.mMax - bounds.mMin) * 0.5f;
+        *offset = (bounds.mMax + bounds.mMin) * 0.5f;
+    }
+    else
+    {
+        *scale = glm::vec3(1.0f);
+        *offset = glm::vec3(0.0f);
+    }
+}
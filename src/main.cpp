@@ -5,79 +5,271 @@
 #include <fstream>
 #include <vector>
 #include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
 
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
+#include "Benchmark.hpp"
 #include "Camera.hpp"
+#include "CameraPath.hpp"
+#include "CommandBuffer.hpp"
+#include "CpuProfiler.hpp"
+#include "FrameArena.hpp"
+#include "FixedTimestep.hpp"
+#include "FramePacer.hpp"
+#include "GLDebug.hpp"
+#include "GpuCuller.hpp"
+#include "GpuProfiler.hpp"
+#include "JobSystem.hpp"
+#include "Mesh3D.hpp"
+#include "MeshArena.hpp"
+#include "MeshImport.hpp"
+#include "MeshLoader.hpp"
+#include "OffscreenTarget.hpp"
+#include "ResolutionController.hpp"
+#include "ProgramCache.hpp"
+#include "RenderQueue.hpp"
+#include "RenderThread.hpp"
+#include "SceneIndex.hpp"
+#include "ShaderPermutation.hpp"
+#include "ShaderProgram.hpp"
+#include "ShaderReloader.hpp"
+#include "StreamBuffer.hpp"
+#include "TextureStreamer.hpp"
+#include "TransformSystem.hpp"
+#include "UniformBlocks.hpp"
+#include "VertexLayout.hpp"
 
 // #define GLM_ENABLE_EXPERIMENTAL
 // #include <glm/gtx/string_cast.hpp>
 
-// Error checking
-static void GLClearError()
-{
-    while (glGetError() != GL_NO_ERROR)
-        ;
-}
-static bool GLCheckError(const char *function, int line)
-{
-    while (GLenum error = glGetError())
-    {
-        std::cout << "OpenGL Error: " << error << ", Line: " << line << ", Function: " << function << std::endl;
-        return true;
-    }
-    return false;
-}
-#define GLCheck(x)  \
-    GLClearError(); \
-    x;              \
-    GLCheckError(#x, __LINE__);
-
 struct App
 {
     int mScreenWidth = 640;
     int mScreenHeight = 480;
     SDL_Window *mGraphicsApplicationWindow = nullptr;
     SDL_GLContext mOpenGLContext = nullptr;
-    GLuint mGraphicsPipelineShaderProgram = 0;
+    ShaderProgram *mGraphicsPipelineShaderProgram = nullptr;
+    ShaderProgram *mMultiDrawShaderProgram = nullptr;
+    ShaderProgram *mDepthShaderProgram = nullptr;
     bool mQuit = false;
     Camera mCamera;
 };
 
-struct Mesh3D
-{
-    // VAO, VBO, and IBO
-    GLuint mVertexArrayObject = 0;
-    GLuint mVertexBufferObject = 0;
-    GLuint mIndexBufferObject = 0;
-};
-
 // Globals
 App gApp;
 Mesh3D gMesh;
 
-float gSpinAngle = 0.0f;
+// The simulation runs in fixed steps. Each tick moves the current state
+// on from the last one, and the frame draws a blend of the two, so motion
+// is smooth and the same at any frame rate. Benchmarks run one step per
+// frame.
+const double gSimulationStep = 1.0 / 60.0;
+const int gMaxSimulationSteps = 8;
+const float gCameraSpeed = 6.0f;
+const float gSpinSpeed = 0.6f;
+FixedTimestep gTimestep(gSimulationStep, gMaxSimulationSteps);
+
+struct SimulationState
+{
+    glm::vec3 mEye = glm::vec3(0.0f);
+    float mSpinAngle = 0.0f;
+};
+SimulationState gPreviousState;
+SimulationState gCurrentState;
 
-const int gTargetFPS = 60;
-const int gFrameDuration = 1000 / gTargetFPS;
+// WASD held this frame, x right and y forward. Sampled by Input() and
+// applied by every tick of the frame.
+glm::vec2 gMoveInput = glm::vec2(0.0f);
 
-// Function to load shader source code from file
-std::string LoadShaderAsString(const std::string filename)
-{
-    std::string result = "";
-    std::string line = "";
+// Spin of this frame, between the last two ticks
+float gSpinAngle = 0.0f;
 
-    std::ifstream myFile(filename);
+// Vertex attribute encoding, 12 bytes per vertex instead of 24
+const VertexFormat gVertexFormat = {PositionFormat::Snorm16, ColorFormat::Unorm8, NormalFormat::None};
+
+// Instanced rendering, draws a grid of quads with one draw call. The
+// count can be set with --instances, the grid stays about square.
+const bool gUseInstancing = true;
+GLsizei gInstanceCount = 100 * 100;
+int gInstanceGridSize = 100;
+const float gInstanceSpacing = 1.5f;
+
+// Instance transforms, world matrices are rebuilt in SIMD batches
+TransformSystem gTransforms;
+
+// Instance bounds for frustum culling, only visible instances are drawn
+SceneIndex gSceneIndex;
+size_t gVisibleCount = 0;
+
+// Linked program binaries, stored next to the executable
+ProgramCache gProgramCache;
+
+// Feature permutations of the shader files, built on first use. Their
+// binaries go into the program cache like any other program.
+ShaderPermutations gMeshPermutations;
+ShaderPermutations gMultiDrawPermutations;
+
+// Optional .mesh asset, loaded in the background and swapped in for the quad
+MeshLoader gMeshLoader;
+const char *gSceneMeshPath = "../meshes/scene.mesh";
+MeshLoader::Request gSceneMeshRequest = 0;
+
+// Optional compressed texture for the scene, its mip levels stream in
+// as the camera gets close to the instances
+TextureStreamer gTextureStreamer;
+const size_t gTextureBudget = 64 * 1024 * 1024;
+const char *gSceneTexturePaths[] = {"../textures/scene.ktx2", "../textures/scene.dds"};
+TextureStreamer::Texture gSceneTexture = 0;
+
+// The textured permutation samples the scene texture here, white until
+// its mip tail is resident
+const GLuint gBaseColorTextureUnit = 2;
+GLuint gWhiteTexture = 0;
+
+// Instances are drawn at the coarsest LOD that stays within this error
+const float gLodPixelError = 1.0f;
+
+// Each record task culls one subtree of the scene index into its own
+// command buffer and draws its share of every LOD with one instanced
+// call. A few tasks per thread keep the threads busy when the visible
+// instances are spread unevenly over the subtrees.
+struct RecordTask
+{
+    std::vector<SceneIndex::ObjectId> mVisible;
+    std::vector<uint32_t> mCullStack;
+    SceneIndex::CullStats mCullStats;
+    GLsizei mLodCounts[gMeshMaxLods] = {};
+    float mNearest = 0.0f;
+};
+const size_t gRecordTasksPerThread = 2;
+std::vector<uint32_t> gRecordRoots;
+std::vector<RecordTask> gRecordTasks;
+GLsizei gLodCounts[gMeshMaxLods] = {};
+
+// Scratch memory that lives for one frame, one arena per job thread.
+// Reset at the top of every main loop iteration.
+FrameArenas gFrameArenas;
+
+// Static boxes of many distinct shapes, merged into one arena and drawn
+// with a single multi-draw call where the driver supports it. Rows of
+// gStaticMeshGridX, the count can be set with --meshes.
+const bool gUseStaticArena = true;
+const int gStaticMeshGridX = 64;
+int gStaticMeshCount = 64 * 32;
+const float gStaticMeshSpacing = 2.4f;
+MeshArena gStaticArena;
+size_t gStaticArenaCalls = 0;
+
+// F2 moves instance culling to the GPU, frustum plus last frame's depth
+bool gUseGpuCulling = false;
+GpuCuller gGpuCuller;
+
+// F3 draws the instances into depth first with a position-only program,
+// the color pass then only shades the nearest fragment of each pixel
+bool gUseDepthPrepass = false;
+
+// The quad spins and shows both faces, the boxes are closed
+const Material gMeshMaterial = {1, false};
+const Material gStaticMaterial = {2, true};
+
+// Transform blocks per job when the simulation is split up
+const size_t gTransformBlocksPerJob = 64;
+
+// Draw packets for the frame, sorted and executed with shadowed GL state.
+// Only used on the render thread.
+const uint32_t gDepthPass = 0;
+const uint32_t gOpaquePass = 1;
+RenderQueue gRenderQueue;
+RenderBackend gRenderBackend;
+
+// The main thread and the job system simulate, cull and record command
+// buffers, the render thread, which owns the GL context, replays them
+RenderThread gRenderThread;
+JobSystem gJobSystem;
+
+// Rebuilds the main and multi-draw programs when their files are saved
+ShaderReloader gShaderReloader;
+
+// Handed from the render thread, where the loader finishes meshes, to
+// the simulation
+std::mutex gLoadedMeshMutex;
+Mesh3D gLoadedMesh;
+bool gHasLoadedMesh = false;
+
+// Set by F1, the pacer lives on the render thread
+bool gCyclePacerMode = false;
+
+// Set by F4, the resolution controller lives there too
+bool gToggleDynamicResolution = false;
+
+// Window title, produced by the render thread's reports
+std::mutex gReportMutex;
+std::string gReportTitle = "SDL game";
+
+// Per-frame dynamic data, instance matrices are written straight into it
+StreamBuffer gStreamBuffer;
+
+// The frame's shared uniform blocks and one ObjectData range per draw
+StreamBuffer gUniformStream;
+const GLsizeiptr gUniformStreamSize = 256 * 1024;
 
-    while (std::getline(myFile, line))
-    {
-        result += line + "\n";
-    }
-    myFile.close();
+const int gTargetFPS = 60;
 
-    return result;
-}
+// Frame pacing and frame time statistics, F1 cycles the mode
+FramePacer gFramePacer;
+const double gStatsReportInterval = 5.0;
+
+// GPU time per pass, summarized in the window title and written out at exit
+GpuProfiler gGpuProfiler;
+const char *gGpuProfileFile = "gpu_profile.csv";
+
+// Command line. --benchmark plays a camera path for a fixed number of
+// uncapped frames, without input, and writes the samples to JSON.
+BenchmarkOptions gBenchmarkOptions;
+CameraPath gCameraPath;
+BenchmarkRecorder gBenchmarkRecorder;
+
+// CPU traces, with ENABLE_CPU_PROFILER. Frames this many times over
+// budget save the zones of the last gCpuSpikeTraceTime ms, a few times
+// per run and not during startup.
+const char *gCpuTraceFile = "cpu_trace.json";
+const double gCpuSpikeFactor = 2.0;
+const double gCpuSpikeTraceTime = 250.0;
+const int gCpuSpikeWarmupFrames = 120;
+const int gCpuSpikeMinInterval = 300;
+const int gMaxCpuSpikeTraces = 8;
+int gCpuSpikeTraces = 0;
+int gLastCpuSpikeFrame = 0;
+
+// Drawn into instead of the window with --offscreen
+OffscreenTarget gOffscreenTarget;
+
+// The scene is drawn into a corner of this at the render scale and
+// blitted up to the window or the offscreen target. It is reallocated
+// only when the output size changes. The controller runs on the render
+// thread and publishes the scale the next recorded frame is drawn at.
+OffscreenTarget gSceneTarget;
+ResolutionController gResolutionController;
+std::atomic<float> gRenderScale(1.0f);
+
+// Frames finished on the render thread, samples start after the warmup
+int gRenderedFrames = 0;
+
+// Render thread: a measured frame's counts, written to the benchmark once
+// the next frame begins and the pacer knows the frame's full interval
+struct PendingBenchmarkFrame
+{
+    bool mValid = false;
+    double mWorkTime = 0.0;
+    size_t mDrawCalls = 0;
+    size_t mTriangles = 0;
+};
+PendingBenchmarkFrame gPendingBenchmarkFrame;
 
 void GetOpenGLVersionInfo()
 {
@@ -107,125 +299,329 @@ void VertexSpecification(Mesh3D *mesh)
         0, 1, 2,
         2, 1, 3};
 
+    const size_t stride = 6;
+    std::vector<float> vertices(vertexData, vertexData + sizeof(vertexData) / sizeof(GLfloat));
+    std::vector<GLuint> indices(indexData, indexData + sizeof(indexData) / sizeof(GLuint));
+
+    // Optimize, build the LOD chain and pack into the configured layout,
+    // the same import step .mesh files are written with
+    ImportedMesh imported;
+    ImportMesh(gVertexFormat, vertices, stride, indices, imported);
+    std::cout << "Mesh optimized: " << imported.mStats.mVerticesBefore << " -> " << imported.mStats.mVerticesAfter << " vertices, ACMR "
+              << imported.mStats.mAcmrBefore << " -> " << imported.mStats.mAcmrAfter << std::endl;
+
+    mesh->mBounds = imported.mBounds;
+    mesh->mLodCount = imported.mLodCount;
+    std::copy(imported.mLods, imported.mLods + imported.mLodCount, mesh->mLods);
+    std::cout << "Mesh LODs: " << mesh->mLodCount << std::endl;
+
+    const VertexLayout &layout = imported.mLayout;
+    const std::vector<unsigned char> &packedVertices = imported.mVertices;
+    GetPositionDequantization(layout.mAttributes[0], mesh->mBounds, &mesh->mPositionScale, &mesh->mPositionOffset);
+
     // Setup VAO
     glGenVertexArrays(1, &mesh->mVertexArrayObject);
-    glBindVertexArray(mesh->mVertexArrayObject);
 
-    // Setup VBO
+    // Setup VBO and send vertex data to GPU
     glGenBuffers(1, &mesh->mVertexBufferObject);
     glBindBuffer(GL_ARRAY_BUFFER, mesh->mVertexBufferObject);
+    glBufferData(GL_ARRAY_BUFFER, packedVertices.size(), packedVertices.data(), GL_STATIC_DRAW);
 
-    // Send vertex data to GPU
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertexData), vertexData, GL_STATIC_DRAW);
+    // Locations and colors in the packed formats
+    SetVertexAttributes(mesh, layout.mAttributes, layout.mAttributeCount, layout.mStride);
 
-    // Setup IBO
+    // Setup IBO, recorded in the VAO
+    glBindVertexArray(mesh->mVertexArrayObject);
     glGenBuffers(1, &mesh->mIndexBufferObject);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->mIndexBufferObject);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indexData), indexData, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * imported.mIndices.size(), imported.mIndices.data(), GL_STATIC_DRAW);
+    mesh->mIndexCount = (GLsizei)mesh->mLods[0].mIndexCount;
 
-    // Locations
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 6, (void *)0);
-    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
 
-    // Colors
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 6, (void *)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
+    if (gUseInstancing)
+    {
+        gStreamBuffer.create(GL_ARRAY_BUFFER, sizeof(glm::mat4) * gInstanceCount);
+    }
 
-    // Send to vertex shader
-    glBindVertexArray(0);
+    // Whole alignments, so every frame's region starts on a valid range offset
+    GLsizeiptr alignment = GetUniformBufferAlignment();
+    gUniformStream.create(GL_UNIFORM_BUFFER, (gUniformStreamSize + alignment - 1) / alignment * alignment);
+}
 
-    // Unbind VAO and VBO
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+// Features of the scene mesh's programs, fixed by the configuration
+ShaderFeatures GetMeshFeatures()
+{
+    ShaderFeatures features = ShaderFeatures::None;
+    if (gUseInstancing)
+    {
+        features = features | ShaderFeatures::Instanced;
+    }
+    if (gVertexFormat.mPosition == PositionFormat::Snorm16)
+    {
+        features = features | ShaderFeatures::PackedPositions;
+    }
+    return features;
 }
 
-GLuint CompileShader(GLuint type, const std::string &source)
+void CreateGraphicsPipeline()
 {
-    GLuint shaderObject;
+    // The culler's programs are left out, their feedback varyings are set before linking
+    gProgramCache.initialize("shader_cache");
+    gShaderReloader.start("../shaders");
+    gMeshPermutations.initialize(&gProgramCache, &gShaderReloader, "../shaders", "vertex.glsl", "fragment.glsl");
+    gMultiDrawPermutations.initialize(&gProgramCache, &gShaderReloader, "../shaders", "vertex_multidraw.glsl", "fragment.glsl");
+
+    // Only the permutations this run draws with are built
+    ShaderFeatures meshFeatures = GetMeshFeatures();
+    ShaderFeatures colorFeatures = meshFeatures | (gSceneTexture != 0 ? ShaderFeatures::Texture : ShaderFeatures::VertexColor);
+    gApp.mGraphicsPipelineShaderProgram = &gMeshPermutations.get(colorFeatures);
+    gApp.mDepthShaderProgram = &gMeshPermutations.get(meshFeatures | ShaderFeatures::DepthOnly);
+
+    // Camera and per-object data come from the shared uniform blocks
+    if (glGetUniformBlockIndex(gApp.mGraphicsPipelineShaderProgram->getProgram(), "ViewData") == GL_INVALID_INDEX)
+    {
+        std::cout << "ViewData uniform block not found, does name match?" << std::endl;
+        exit(1);
+    }
 
-    if (type == GL_VERTEX_SHADER)
+    if (HasFeature(colorFeatures, ShaderFeatures::Texture))
     {
-        shaderObject = glCreateShader(GL_VERTEX_SHADER);
+        const unsigned char white[4] = {255, 255, 255, 255};
+        glGenTextures(1, &gWhiteTexture);
+        glBindTexture(GL_TEXTURE_2D, gWhiteTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        gApp.mGraphicsPipelineShaderProgram->use();
+        gApp.mGraphicsPipelineShaderProgram->setInt(gApp.mGraphicsPipelineShaderProgram->findUniform("uBaseColor"), (GLint)gBaseColorTextureUnit);
+        glUseProgram(0);
     }
-    else if (type == GL_FRAGMENT_SHADER)
+
+    if (gUseStaticArena)
     {
-        shaderObject = glCreateShader(GL_FRAGMENT_SHADER);
+        // Dequantization is folded into the draw matrices
+        gApp.mMultiDrawShaderProgram = &gMultiDrawPermutations.get(MakePermutation<ShaderFeatures::VertexColor>());
+
+        // The sampler unit never changes
+        gApp.mMultiDrawShaderProgram->use();
+        gApp.mMultiDrawShaderProgram->setInt(gApp.mMultiDrawShaderProgram->findUniform("uDrawData"), (GLint)gDrawDataTextureUnit);
+        glUseProgram(0);
     }
-    else
+    std::cout << "Shader permutations: " << gMeshPermutations.getCount() + gMultiDrawPermutations.getCount()
+              << ", program cache " << gProgramCache.getHits() << " hits, " << gProgramCache.getMisses() << " misses" << std::endl;
+
+    if (gUseInstancing)
     {
-        std::cout << "Only Vertex shader and Fragment shader are supported" << std::endl;
-        exit(1);
+        GpuCullSources sources;
+        sources.mCullVertex = ReadShaderFile("../shaders/cull_vertex.glsl");
+        sources.mCullGeometry = ReadShaderFile("../shaders/cull_geometry.glsl");
+        sources.mHiZVertex = ReadShaderFile("../shaders/hiz_vertex.glsl");
+        sources.mHiZFragment = ReadShaderFile("../shaders/hiz_fragment.glsl");
+        gGpuCuller.create(sources, gApp.mScreenWidth, gApp.mScreenHeight);
+    }
+}
+
+// Box with its own size and colors, 6 floats per vertex like the quad
+void MakeStaticBox(uint32_t seed, std::vector<float> &vertices, std::vector<uint32_t> &indices)
+{
+    // Cheap integer hash, the same seed always gives the same box
+    seed = (seed ^ 61u) ^ (seed >> 16);
+    seed *= 9u;
+    seed ^= seed >> 4;
+    seed *= 0x27d4eb2du;
+    seed ^= seed >> 15;
+
+    glm::vec3 size(0.3f + (seed & 0xff) / 255.0f,
+                   0.2f + ((seed >> 8) & 0xff) / 255.0f * 1.5f,
+                   0.3f + ((seed >> 16) & 0xff) / 255.0f);
+    glm::vec3 tint(0.3f + ((seed >> 24) & 0xf) / 15.0f * 0.7f, 0.3f, 0.3f + ((seed >> 28) & 0xf) / 15.0f * 0.7f);
+
+    vertices.clear();
+    for (uint32_t corner = 0; corner < 8; corner++)
+    {
+        glm::vec3 unit((corner & 1) ? 0.5f : -0.5f, (corner & 2) ? 1.0f : 0.0f, (corner & 4) ? 0.5f : -0.5f);
+        glm::vec3 position = unit * size;
+        glm::vec3 color = tint * (0.6f + 0.4f * unit.y);
+        vertices.insert(vertices.end(), {position.x, position.y, position.z, color.x, color.y, color.z});
     }
 
-    const char *charSource = source.c_str();
-    glShaderSource(shaderObject, 1, &charSource, nullptr);
-    glCompileShader(shaderObject);
+    // Counter-clockwise from outside
+    static const uint32_t boxIndices[36] = {
+        0, 2, 1, 1, 2, 3,
+        4, 5, 6, 5, 7, 6,
+        0, 1, 4, 1, 5, 4,
+        2, 6, 3, 3, 6, 7,
+        0, 4, 2, 2, 4, 6,
+        1, 3, 5, 3, 7, 5};
+    indices.assign(boxIndices, boxIndices + 36);
+}
 
-    // Check for compilation errors, rewrite later
-    GLint isCompiled = 0;
-    glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &isCompiled);
-    if (isCompiled == GL_FALSE)
+// A field of distinct static boxes below the quads, one arena draw each
+void CreateStaticScene()
+{
+    if (!gUseStaticArena)
     {
-        GLint maxLength = 0;
-        glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &maxLength);
+        return;
+    }
 
-        std::vector<char> infoLog(maxLength);
-        glGetShaderInfoLog(shaderObject, maxLength, &maxLength, &infoLog[0]);
+    const size_t stride = 6;
+    VertexLayout layout = MakeVertexLayout(gVertexFormat);
+    gStaticArena.initialize(layout);
 
-        glDeleteShader(shaderObject);
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<unsigned char> packedVertices;
 
-        std::cout << "Shader compilation error: " << std::string(infoLog.begin(), infoLog.end()) << std::endl;
-        exit(1);
+    for (int i = 0; i < gStaticMeshCount; i++)
+    {
+        int x = i % gStaticMeshGridX;
+        int z = i / gStaticMeshGridX;
+        MakeStaticBox((uint32_t)i, vertices, indices);
+
+        size_t vertexCount = vertices.size() / stride;
+        Bounds bounds = ComputeBounds(vertices.data(), vertexCount, stride);
+        PackVertices(gVertexFormat, layout, bounds, vertices.data(), vertices.data() + 3, nullptr, vertexCount, stride, packedVertices);
+
+        glm::vec3 positionScale;
+        glm::vec3 positionOffset;
+        GetPositionDequantization(layout.mAttributes[0], bounds, &positionScale, &positionOffset);
+
+        uint32_t mesh = gStaticArena.addMesh(packedVertices.data(), (uint32_t)vertexCount, indices.data(), (uint32_t)indices.size(), positionScale, positionOffset);
+        glm::vec3 position((x - gStaticMeshGridX / 2) * gStaticMeshSpacing, -3.0f, -z * gStaticMeshSpacing);
+        gStaticArena.addDraw(mesh, glm::translate(glm::mat4(1.0f), position));
     }
+    gStaticArena.upload();
 
-    return shaderObject;
+    std::cout << "Static meshes: " << gStaticArena.getMeshCount() << " ("
+              << (gStaticArena.usesMultiDraw() ? "multi-draw indirect" : "draw loop") << ")" << std::endl;
 }
 
-GLuint CreateShaderProgram(const std::string &vertexShaderSource, const std::string &fragmentShaderSource)
+// Lay the instances out on a grid behind the camera start position
+void CreateScene()
 {
-    GLuint programObject = glCreateProgram();
+    gTransforms.reserve(gInstanceCount);
 
-    GLuint myVertexShader = CompileShader(GL_VERTEX_SHADER, vertexShaderSource);
-    GLuint myFragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+    for (GLsizei i = 0; i < gInstanceCount; i++)
+    {
+        int x = i % gInstanceGridSize;
+        int z = i / gInstanceGridSize;
+        glm::vec3 position((x - gInstanceGridSize / 2) * gInstanceSpacing, 0.0f, -z * gInstanceSpacing);
+        gTransforms.create(position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+
+        // The quads spin, bound them by their sphere so rotation never needs a refit
+        glm::vec3 center = position + gMesh.mBounds.mCenter;
+        gSceneIndex.insert(MakeBounds(center, glm::vec3(gMesh.mBounds.mRadius)));
+    }
+    gSceneIndex.build();
 
-    glAttachShader(programObject, myVertexShader);
-    glAttachShader(programObject, myFragmentShader);
-    glLinkProgram(programObject);
+    std::cout << "Transforms: " << gTransforms.size() << " (" << TransformSystem::getSimdName() << ")" << std::endl;
+}
 
-    // Check for linking errors, rewrite later
-    GLint isLinked = 0;
-    glGetProgramiv(programObject, GL_LINK_STATUS, &isLinked);
-    if (isLinked == GL_FALSE)
+// Start loading the scene mesh if there is one, the quad is drawn meanwhile
+void RequestSceneMesh()
+{
+    gMeshLoader.start(gJobSystem);
+
+    // Benchmarks keep the synthetic scene, a mesh arriving mid-run would
+    // make them depend on load times
+    std::ifstream file(gSceneMeshPath);
+    if (file.good() && !gBenchmarkOptions.mEnabled)
     {
-        GLint maxLength = 0;
-        glGetProgramiv(programObject, GL_INFO_LOG_LENGTH, &maxLength);
+        gSceneMeshRequest = gMeshLoader.load(gSceneMeshPath);
+    }
+}
 
-        std::vector<char> infoLog(maxLength);
-        glGetProgramInfoLog(programObject, maxLength, &maxLength, &infoLog[0]);
+// Start streaming the scene texture if there is one, the first path found wins
+void RequestSceneTexture()
+{
+    gTextureStreamer.start(gJobSystem, gTextureBudget);
 
-        glDeleteProgram(programObject);
-        glDeleteShader(myVertexShader);
-        glDeleteShader(myFragmentShader);
+    // Like the mesh, kept out of benchmarks so uploads don't vary runs
+    if (gBenchmarkOptions.mEnabled)
+    {
+        return;
+    }
+    for (const char *path : gSceneTexturePaths)
+    {
+        std::ifstream file(path);
+        if (file.good())
+        {
+            gSceneTexture = gTextureStreamer.load(path);
+            return;
+        }
+    }
+}
 
-        std::cout << "Program linking error: " << std::string(infoLog.begin(), infoLog.end()) << std::endl;
-        exit(1);
+// Render thread: finish pending uploads and hand the scene mesh over once ready
+void PollMeshLoader()
+{
+    // The loader binds buffers and VAOs directly
+    if (gMeshLoader.update())
+    {
+        gRenderBackend.getState().invalidateVertexArray();
+    }
+
+    if (gSceneMeshRequest == 0)
+    {
+        return;
+    }
+
+    MeshLoader::State state = gMeshLoader.getState(gSceneMeshRequest);
+    if (state == MeshLoader::State::Failed)
+    {
+        gSceneMeshRequest = 0;
+        return;
     }
 
-    // Detach and delete shaders after linking
-    glDetachShader(programObject, myVertexShader);
-    glDetachShader(programObject, myFragmentShader);
-    glDeleteShader(myVertexShader);
-    glDeleteShader(myFragmentShader);
+    Mesh3D mesh;
+    if (!gMeshLoader.takeMesh(gSceneMeshRequest, &mesh))
+    {
+        return;
+    }
+    gSceneMeshRequest = 0;
 
-    return programObject;
+    std::lock_guard<std::mutex> lock(gLoadedMeshMutex);
+    gLoadedMesh = mesh;
+    gHasLoadedMesh = true;
 }
 
-void CreateGraphicsPipeline()
+// Main thread: replace the quad with a loaded mesh. The quad is deleted
+// on the render thread before the first frame that no longer draws it.
+void UpdateSceneMesh(FrameCommands &frame)
 {
-    std::string vertexShaderSource = LoadShaderAsString("../shaders/vertex.glsl");
-    std::string fragmentShaderSource = LoadShaderAsString("../shaders/fragment.glsl");
+    {
+        std::lock_guard<std::mutex> lock(gLoadedMeshMutex);
+        if (!gHasLoadedMesh)
+        {
+            return;
+        }
+        Mesh3D retired = gMesh;
+        frame.mTasks.push_back([retired]() mutable
+                               { DestroyMesh(&retired); });
+        gMesh = gLoadedMesh;
+        gHasLoadedMesh = false;
+    }
+
+    // Instance bounds follow the new mesh
+    for (SceneIndex::ObjectId i = 0; i < (SceneIndex::ObjectId)gTransforms.size(); i++)
+    {
+        glm::vec3 center = gTransforms.getPosition(i) + gMesh.mBounds.mCenter;
+        gSceneIndex.update(i, MakeBounds(center, glm::vec3(gMesh.mBounds.mRadius)));
+    }
+    gSceneIndex.build();
+
+    std::cout << "Loaded " << gSceneMeshPath << ": " << gMesh.mIndexCount << " indices" << std::endl;
+}
 
-    gApp.mGraphicsPipelineShaderProgram = CreateShaderProgram(vertexShaderSource, fragmentShaderSource);
+// Projected size in pixels of one unit at distance one, for LOD selection.
+// A scaled frame has fewer pixels to spend detail on.
+float GetLodPixelsPerUnit()
+{
+    int height = ScaleRenderSize(gApp.mScreenHeight, gRenderScale.load());
+    return height / (2.0f * std::tan(gApp.mCamera.getFovY() * 0.5f));
 }
 
 // Function to initialize the SDL and OpenGL context
@@ -244,7 +640,20 @@ void InitializeProgram(App *app)
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
     SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
 
-    app->mGraphicsApplicationWindow = SDL_CreateWindow("SDL game", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, app->mScreenWidth, app->mScreenHeight, SDL_WINDOW_OPENGL);
+#ifdef ENABLE_GL_DEBUG
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+#endif
+
+    Uint32 windowFlags = SDL_WINDOW_OPENGL;
+    if (gBenchmarkOptions.mOffscreen)
+    {
+        windowFlags |= SDL_WINDOW_HIDDEN;
+    }
+    else
+    {
+        windowFlags |= SDL_WINDOW_RESIZABLE;
+    }
+    app->mGraphicsApplicationWindow = SDL_CreateWindow("SDL game", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, app->mScreenWidth, app->mScreenHeight, windowFlags);
 
     if (app->mGraphicsApplicationWindow == nullptr)
     {
@@ -268,11 +677,40 @@ void InitializeProgram(App *app)
     }
 
     GetOpenGLVersionInfo();
+
+    float aspect = ((float)app->mScreenWidth) / ((float)app->mScreenHeight);
+    app->mCamera.setProjection(glm::radians(45.0f), aspect, 0.1f, gUseInstancing ? 200.0f : 10.0f);
+
+    // Only does anything in ENABLE_GL_DEBUG builds
+    InitializeGLDebug();
+
+    // Benchmarks run as fast as the frames go
+    gFramePacer.initialize(gBenchmarkOptions.mEnabled ? FramePacer::Mode::Uncapped : FramePacer::Mode::Limited, gTargetFPS);
+    gGpuProfiler.initialize();
+
+    if (gBenchmarkOptions.mOffscreen && !gOffscreenTarget.create(app->mScreenWidth, app->mScreenHeight))
+    {
+        std::cout << "Offscreen target could not be created" << std::endl;
+        exit(1);
+    }
+    if (!gSceneTarget.create(app->mScreenWidth, app->mScreenHeight))
+    {
+        std::cout << "Scene target could not be created" << std::endl;
+        exit(1);
+    }
+
+    // Benchmarks hold their scale unless given a budget, interactive
+    // runs steer towards the pacer's frame time
+    double budget = gBenchmarkOptions.mGpuBudget > 0.0 ? gBenchmarkOptions.mGpuBudget : gFramePacer.getFrameBudget();
+    gResolutionController.initialize(gBenchmarkOptions.mRenderScale, budget);
+    gResolutionController.setEnabled(gBenchmarkOptions.mEnabled ? gBenchmarkOptions.mGpuBudget > 0.0 : true);
+    gRenderScale = gResolutionController.getScale();
 }
 
 // Function to handle input events
 void Input()
 {
+    CpuScope scope("Input");
     SDL_Event e;
 
     while (SDL_PollEvent(&e) != 0)
@@ -282,6 +720,11 @@ void Input()
             std::cout << "Goodbye!" << std::endl;
             gApp.mQuit = true;
         }
+        else if (gBenchmarkOptions.mEnabled)
+        {
+            // The camera path drives the view
+            continue;
+        }
         else if (e.type == SDL_MOUSEMOTION)
         {
             if (SDL_GetRelativeMouseMode())
@@ -291,6 +734,38 @@ void Input()
                 gApp.mCamera.mouseLook(deltaX, deltaY);
             }
         }
+        else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F1)
+        {
+            gCyclePacerMode = true;
+        }
+        else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F2 && gUseInstancing)
+        {
+            gUseGpuCulling = !gUseGpuCulling;
+            std::cout << "Culling on the " << (gUseGpuCulling ? "GPU" : "CPU") << std::endl;
+        }
+        else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3)
+        {
+            gUseDepthPrepass = !gUseDepthPrepass;
+            std::cout << "Depth pre-pass " << (gUseDepthPrepass ? "on" : "off") << std::endl;
+        }
+        else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F4)
+        {
+            gToggleDynamicResolution = true;
+        }
+        else if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED && !gBenchmarkOptions.mOffscreen)
+        {
+            // Only the size is recorded here, the render thread resizes
+            // its targets when the first frame of the new size arrives
+            int width = 0;
+            int height = 0;
+            SDL_GL_GetDrawableSize(gApp.mGraphicsApplicationWindow, &width, &height);
+            if (width > 0 && height > 0 && (width != gApp.mScreenWidth || height != gApp.mScreenHeight))
+            {
+                gApp.mScreenWidth = width;
+                gApp.mScreenHeight = height;
+                gApp.mCamera.setAspect((float)width / (float)height);
+            }
+        }
         else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)
         {
             if (SDL_GetRelativeMouseMode())
@@ -306,116 +781,771 @@ void Input()
         }
     }
 
-    float speed = 0.1f;
+    gMoveInput = glm::vec2(0.0f);
+    if (gBenchmarkOptions.mEnabled)
+    {
+        return;
+    }
 
+    // Movement waits for the simulation ticks, looking around above is
+    // applied right away
     const Uint8 *state = SDL_GetKeyboardState(NULL);
 
     if (state[SDL_SCANCODE_W])
     {
-        gApp.mCamera.moveForward(speed);
+        gMoveInput.y += 1.0f;
     }
     if (state[SDL_SCANCODE_S])
     {
-        gApp.mCamera.moveBackward(speed);
+        gMoveInput.y -= 1.0f;
     }
     if (state[SDL_SCANCODE_A])
     {
-        gApp.mCamera.moveLeft(speed);
+        gMoveInput.x -= 1.0f;
     }
     if (state[SDL_SCANCODE_D])
     {
-        gApp.mCamera.moveRight(speed);
+        gMoveInput.x += 1.0f;
     }
 }
 
-void PreDraw()
+// Object data of the scene mesh, the model matrix is applied before any
+// instance matrix
+ObjectBlock MakeMeshObject(const glm::mat4 &model)
 {
-    glEnable(GL_DEPTH_TEST);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
+    ObjectBlock object;
+    object.mModel = model;
+    object.mPositionScale = glm::vec4(gMesh.mPositionScale, 0.0f);
+    object.mPositionOffset = glm::vec4(gMesh.mPositionOffset, 0.0f);
+    return object;
+}
 
-    glViewport(0, 0, gApp.mScreenWidth, gApp.mScreenHeight);
-    glClearColor(0.2f, 0.0f, 0.1f, 1.0f);
+// Record a draw of gMesh at a LOD with the pipeline program
+void RecordMesh(CommandBuffer &buffer, uint32_t lod, float depth, int32_t object, uint32_t firstInstance, GLsizei instanceCount)
+{
+    DrawCommand command;
+    command.mObject = object;
+    command.mProgram = gApp.mGraphicsPipelineShaderProgram->getProgram();
+    command.mVertexArray = gMesh.mVertexArrayObject;
+    command.mIndexType = gMesh.mIndexType;
+    GLsizei indexCount;
+    GetMeshLodRange(gMesh, lod, &indexCount, &command.mIndexOffset);
+    command.mIndexCount = indexCount;
+    command.mFirstInstance = firstInstance;
+    command.mInstanceCount = instanceCount;
+    command.mCullBackFaces = gMeshMaterial.mCullBackFaces;
+
+    // After a pre-pass the color pass overdraws nothing, so state order
+    // wins. Without one, front to back lets early-Z reject hidden pixels.
+    uint32_t quantizedDepth = QuantizeDepth(depth, gApp.mCamera.getFarPlane());
+    if (gUseDepthPrepass)
+    {
+        command.mKey = MakeSortKey(gOpaquePass, command.mProgram, gMeshMaterial.mId, command.mVertexArray, quantizedDepth);
+    }
+    else
+    {
+        command.mKey = MakeDepthSortKey(gOpaquePass, quantizedDepth, command.mProgram, command.mVertexArray, gMeshMaterial.mId);
+    }
+    buffer.draw(command);
 
-    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+    // The same instances again into depth only, ahead of every color draw
+    if (gUseDepthPrepass)
+    {
+        command.mProgram = gApp.mDepthShaderProgram->getProgram();
+        command.mKey = MakeDepthSortKey(gDepthPass, quantizedDepth, command.mProgram, command.mVertexArray, gMeshMaterial.mId);
+        buffer.draw(command);
+    }
+}
 
-    // Use Shader Program
-    glUseProgram(gApp.mGraphicsPipelineShaderProgram);
+// One fixed step of the simulation
+void Simulate(float step)
+{
+    CpuScope scope("Simulate");
+    gPreviousState = gCurrentState;
+    gCurrentState.mSpinAngle += gSpinSpeed * step;
 
-    gSpinAngle += 0.01f;
+    // The camera moves along its current direction from the simulated eye
+    if (gMoveInput.x != 0.0f || gMoveInput.y != 0.0f)
+    {
+        Camera &camera = gApp.mCamera;
+        camera.setView(gCurrentState.mEye, camera.getViewDirection());
+        camera.moveForward(gMoveInput.y * gCameraSpeed * step);
+        camera.moveRight(gMoveInput.x * gCameraSpeed * step);
+        gCurrentState.mEye = camera.getEye();
+    }
+}
 
-    // Create transformation matrices
-    glm::mat4 globalTransform = glm::rotate(glm::mat4(1.0f), gSpinAngle, glm::vec3(0.0f, 1.0f, 0.0f));
-    glm::mat4 viewSpace = gApp.mCamera.getViewMatrix();
-    glm::mat4 perspective = glm::perspective(glm::radians(45.0f), ((float)gApp.mScreenWidth) / ((float)gApp.mScreenHeight), 0.1f, 10.0f);
+// Place the frame alpha of a step past the previous state. Camera paths
+// set the benchmark camera themselves.
+void Interpolate(float alpha)
+{
+    gSpinAngle = glm::mix(gPreviousState.mSpinAngle, gCurrentState.mSpinAngle, alpha);
+    if (gBenchmarkOptions.mEnabled)
+    {
+        return;
+    }
 
-    glm::mat4 transforms = perspective * viewSpace * globalTransform;
+    // setView always invalidates the cached matrices, so only move the
+    // camera when the eye actually changed. A resting eye isn't mixed,
+    // rounding could make it differ from frame to frame.
+    glm::vec3 eye = gCurrentState.mEye;
+    if (gPreviousState.mEye != gCurrentState.mEye)
+    {
+        eye = glm::mix(gPreviousState.mEye, gCurrentState.mEye, alpha);
+    }
+    if (eye != gApp.mCamera.getEye())
+    {
+        gApp.mCamera.setView(eye, gApp.mCamera.getViewDirection());
+    }
+}
 
-    // Find uniform locations
-    GLint uTransformLocation = glGetUniformLocation(gApp.mGraphicsPipelineShaderProgram, "uTransform");
+// Instance rotations follow from the spin angle, so the interpolated
+// angle gives the interpolated transforms. Matrices are rebuilt for the
+// frame rather than per step.
+void UpdateTransforms()
+{
+    CpuScope scope("UpdateTransforms");
+    if (!gUseInstancing)
+    {
+        return;
+    }
 
-    // Set uniform
-    if (uTransformLocation >= 0)
+    // Blocks are independent, each job spins the quads of its blocks and
+    // rebuilds their matrices. Every column is a little ahead of the
+    // previous one.
+    gJobSystem.parallelFor(gTransforms.getBlockCount(), gTransformBlocksPerJob, [](size_t firstBlock, size_t lastBlock)
+                           {
+                               CpuScope scope("SimulateBlocks");
+                               size_t last = std::min(lastBlock * gTransformBlockSize, gTransforms.size());
+                               for (size_t i = firstBlock * gTransformBlockSize; i < last; i++)
+                               {
+                                   float angle = gSpinAngle + (i % gInstanceGridSize) * 0.1f;
+                                   gTransforms.setRotation((TransformSystem::Handle)i, glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+                               }
+                               gTransforms.updateBlocks(firstBlock, lastBlock); });
+}
+
+// Cull the task's subtree and record its visible instances
+void RecordSubtree(CommandBuffer &buffer, RecordTask &task, uint32_t root, const Frustum &frustum)
+{
+    CpuScope scope("RecordSubtree");
+    task.mVisible.clear();
+    task.mCullStats = SceneIndex::CullStats();
+    gSceneIndex.cullSubtree(frustum, root, task.mVisible, task.mCullStack, task.mCullStats);
+
+    // Bucket by the LOD their distance allows. The buckets are one array
+    // from the thread's frame arena, split by a counting sort.
+    size_t visibleCount = task.mVisible.size();
+    FrameArena &arena = gFrameArenas.get(gJobSystem.getThreadIndex());
+    uint8_t *instanceLods = arena.allocateArray<uint8_t>(visibleCount);
+    SceneIndex::ObjectId *lodInstances = arena.allocateArray<SceneIndex::ObjectId>(visibleCount);
+
+    float pixelsPerUnit = GetLodPixelsPerUnit();
+    const glm::vec3 &eye = gApp.mCamera.getEye();
+    float nearest[gMeshMaxLods];
+    for (uint32_t lod = 0; lod < gMeshMaxLods; lod++)
     {
-        glUniformMatrix4fv(uTransformLocation, 1, GL_FALSE, &transforms[0][0]);
+        task.mLodCounts[lod] = 0;
+        nearest[lod] = gApp.mCamera.getFarPlane();
     }
-    else
+    for (size_t i = 0; i < visibleCount; i++)
     {
-        std::cout << "Transform uniform not found, does name match?" << std::endl;
-        exit(1);
+        float distance = glm::length(gTransforms.getPosition(task.mVisible[i]) - eye);
+        uint32_t lod = SelectMeshLod(gMesh, distance, pixelsPerUnit, gLodPixelError);
+        instanceLods[i] = (uint8_t)lod;
+        task.mLodCounts[lod]++;
+        nearest[lod] = std::min(nearest[lod], distance);
+    }
+    task.mNearest = *std::min_element(nearest, nearest + gMeshMaxLods);
+
+    GLsizei lodFirst[gMeshMaxLods];
+    GLsizei next = 0;
+    for (uint32_t lod = 0; lod < gMeshMaxLods; lod++)
+    {
+        lodFirst[lod] = next;
+        next += task.mLodCounts[lod];
+    }
+    GLsizei lodFill[gMeshMaxLods];
+    std::copy(lodFirst, lodFirst + gMeshMaxLods, lodFill);
+    for (size_t i = 0; i < visibleCount; i++)
+    {
+        lodInstances[lodFill[instanceLods[i]]++] = task.mVisible[i];
+    }
+
+    // Compact each LOD's instances into the buffer and draw them with one call
+    const glm::mat4 *worldMatrices = gTransforms.getWorldMatrices();
+    int32_t object = visibleCount > 0 ? buffer.addObject(MakeMeshObject(glm::mat4(1.0f))) : -1;
+    for (uint32_t lod = 0; lod < gMeshMaxLods; lod++)
+    {
+        GLsizei count = task.mLodCounts[lod];
+        if (count == 0)
+        {
+            continue;
+        }
+
+        uint32_t firstInstance = 0;
+        glm::mat4 *instanceModels = buffer.allocateInstances(count, &firstInstance);
+        const SceneIndex::ObjectId *instances = lodInstances + lodFirst[lod];
+        for (GLsizei i = 0; i < count; i++)
+        {
+            instanceModels[i] = worldMatrices[instances[i]];
+        }
+        RecordMesh(buffer, lod, nearest[lod], object, firstInstance, count);
     }
 }
 
-void Draw()
+void RecordFrame(FrameCommands &frame)
 {
-    glBindVertexArray(gMesh.mVertexArrayObject);
+    CpuScope scope("RecordFrame");
 
-    // glDrawArrays(GL_TRIANGLES,0,6);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    // One task per subtree, tasks never share a command buffer
+    gRecordRoots.clear();
+    if (gUseInstancing && !gUseGpuCulling)
+    {
+        gSceneIndex.commit();
+        gSceneIndex.getSubtrees(gJobSystem.getThreadCount() * gRecordTasksPerThread, gRecordRoots);
+    }
+    size_t taskCount = gRecordRoots.size();
+    frame.mBuffers.resize(1 + taskCount);
+    gRecordTasks.resize(std::max(gRecordTasks.size(), taskCount));
+
+    // Frame state goes first
+    CommandBuffer &setup = frame.mBuffers[0];
+    ShaderProgram *program = gApp.mGraphicsPipelineShaderProgram;
+    float renderScale = gRenderScale.load();
+    frame.mOutputWidth = gApp.mScreenWidth;
+    frame.mOutputHeight = gApp.mScreenHeight;
+    frame.mRenderWidth = ScaleRenderSize(gApp.mScreenWidth, renderScale);
+    frame.mRenderHeight = ScaleRenderSize(gApp.mScreenHeight, renderScale);
+    setup.setCapability(GL_DEPTH_TEST, true);
+    setup.setCullFace(GL_BACK);
+    setup.setFrontFace(GL_CCW);
+    setup.setViewport(0, 0, frame.mRenderWidth, frame.mRenderHeight);
+    setup.setClearColor(0.2f, 0.0f, 0.1f, 1.0f);
+    setup.clear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+    setup.useProgram(program);
+
+    // Shared by every program through the frame and view blocks
+    static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    static std::chrono::steady_clock::time_point lastTime = startTime;
+    static uint32_t frameIndex = 0;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    frame.mFrameBlock.mViewport = glm::vec4(0.0f, 0.0f, (float)frame.mRenderWidth, (float)frame.mRenderHeight);
+    frame.mFrameBlock.mTime = std::chrono::duration<float>(now - startTime).count();
+    frame.mFrameBlock.mDeltaTime = std::chrono::duration<float>(now - lastTime).count();
+    frame.mFrameBlock.mFrameIndex = frameIndex++;
+    lastTime = now;
+
+    // Cached by the camera, only rebuilt after it moved
+    const glm::mat4 &viewProjection = gApp.mCamera.getViewProjectionMatrix();
+    frame.mViewBlock.mView = gApp.mCamera.getViewMatrix();
+    frame.mViewBlock.mProjection = gApp.mCamera.getProjectionMatrix();
+    frame.mViewBlock.mViewProjection = viewProjection;
+    frame.mViewBlock.mEye = glm::vec4(gApp.mCamera.getEye(), 1.0f);
+    frame.mDepthPrepass = gUseDepthPrepass;
+
+    if (!gUseInstancing)
+    {
+        glm::mat4 globalTransform = glm::rotate(glm::mat4(1.0f), gSpinAngle, glm::vec3(0.0f, 1.0f, 0.0f));
+        float distance = glm::length(gApp.mCamera.getEye() - gMesh.mBounds.mCenter);
+        RecordMesh(setup, SelectMeshLod(gMesh, distance, GetLodPixelsPerUnit(), gLodPixelError), distance, setup.addObject(MakeMeshObject(globalTransform)), 0, 0);
+        return;
+    }
 
-    glBindVertexArray(0);
+    // The render thread culls and draws every instance from a copy
+    if (gUseGpuCulling)
+    {
+        const glm::mat4 *worldMatrices = gTransforms.getWorldMatrices();
+        frame.mCullMesh = gMesh;
+        frame.mCullModels.assign(worldMatrices, worldMatrices + gTransforms.size());
+        frame.mViewProjection = viewProjection;
+        frame.mCullObject = MakeMeshObject(glm::mat4(1.0f));
+        return;
+    }
+
+    // The camera caches the frustum, fetch it before the jobs share it
+    const Frustum &frustum = gApp.mCamera.getFrustum();
+    gJobSystem.parallelFor(taskCount, 1, [&frame, &frustum](size_t first, size_t last)
+                           {
+                               for (size_t task = first; task < last; task++)
+                               {
+                                   RecordSubtree(frame.mBuffers[1 + task], gRecordTasks[task], gRecordRoots[task], frustum);
+                               } });
+
+    gVisibleCount = 0;
+    std::fill(gLodCounts, gLodCounts + gMeshMaxLods, 0);
+    float nearest = gApp.mCamera.getFarPlane();
+    for (size_t task = 0; task < taskCount; task++)
+    {
+        gVisibleCount += gRecordTasks[task].mVisible.size();
+        for (uint32_t lod = 0; lod < gMeshMaxLods; lod++)
+        {
+            gLodCounts[lod] += gRecordTasks[task].mLodCounts[lod];
+        }
+        nearest = std::min(nearest, gRecordTasks[task].mNearest);
+    }
+
+    // Every instance shares the scene texture, the nearest one needs the
+    // finest level
+    if (gSceneTexture != 0 && gVisibleCount > 0)
+    {
+        float pixels = 2.0f * gMesh.mBounds.mRadius * GetLodPixelsPerUnit() / std::max(nearest, gApp.mCamera.getNearPlane());
+        gTextureStreamer.requestResidency(gSceneTexture, pixels);
+    }
+}
+
+// Render thread: keep a trace of what led up to a frame far over budget
+void SaveCpuSpikeTrace(double frameTime)
+{
+    if (gRenderedFrames < gCpuSpikeWarmupFrames || gCpuSpikeTraces == gMaxCpuSpikeTraces ||
+        gRenderedFrames - gLastCpuSpikeFrame < gCpuSpikeMinInterval || frameTime < gFramePacer.getFrameBudget() * gCpuSpikeFactor)
+    {
+        return;
+    }
+
+    std::string path = "cpu_spike_" + std::to_string(gCpuSpikeTraces) + ".json";
+    if (CpuProfilerWriteTrace(path, gCpuSpikeTraceTime))
+    {
+        std::cout << "Frame took " << frameTime << " ms, CPU trace saved to " << path << std::endl;
+    }
+    gCpuSpikeTraces++;
+    gLastCpuSpikeFrame = gRenderedFrames;
+}
+
+// Render thread: write the frame and view blocks and bind them for every
+// program. Returns the offset of the GPU culled mesh's object data, -1
+// when the uniform buffer is full.
+GLintptr BindFrameBlocks(const FrameCommands &frame)
+{
+    GLsizeiptr alignment = GetUniformBufferAlignment();
+    GLintptr frameOffset = 0;
+    GLintptr viewOffset = 0;
+    GLintptr cullOffset = 0;
+    FrameBlock *frameBlock = (FrameBlock *)gUniformStream.allocate(sizeof(FrameBlock), alignment, &frameOffset);
+    ViewBlock *viewBlock = (ViewBlock *)gUniformStream.allocate(sizeof(ViewBlock), alignment, &viewOffset);
+    ObjectBlock *cullObject = (ObjectBlock *)gUniformStream.allocate(sizeof(ObjectBlock), alignment, &cullOffset);
+    if (frameBlock == nullptr || viewBlock == nullptr || cullObject == nullptr)
+    {
+        std::cout << "Frame uniforms don't fit the uniform buffer" << std::endl;
+        return -1;
+    }
+
+    *frameBlock = frame.mFrameBlock;
+    *viewBlock = frame.mViewBlock;
+    *cullObject = frame.mCullObject;
+
+    GLuint buffer = gUniformStream.getBuffer();
+    glBindBufferRange(GL_UNIFORM_BUFFER, gFrameBlockBinding, buffer, frameOffset, sizeof(FrameBlock));
+    glBindBufferRange(GL_UNIFORM_BUFFER, gViewBlockBinding, buffer, viewOffset, sizeof(ViewBlock));
+    return cullOffset;
+}
+
+// Runs on the render thread for every submitted frame
+void RenderFrame(FrameCommands &frame)
+{
+    static std::chrono::steady_clock::time_point lastReport = std::chrono::steady_clock::now();
+
+    // Start frame timer, which also ends the last frame's interval
+    gFramePacer.beginFrame();
+    gGpuProfiler.beginFrame();
+
+    // The last frame's zones are complete by now
+    if (CpuProfilerEnabled() && !gBenchmarkOptions.mEnabled)
+    {
+        SaveCpuSpikeTrace(gFramePacer.getFrameTimes().getLast());
+    }
+
+    if (gPendingBenchmarkFrame.mValid)
+    {
+        gBenchmarkRecorder.addRenderFrame(gFramePacer.getFrameTimes().getLast(), gPendingBenchmarkFrame.mWorkTime,
+                                          gPendingBenchmarkFrame.mDrawCalls, gPendingBenchmarkFrame.mTriangles);
+        gPendingBenchmarkFrame.mValid = false;
+    }
+
+    // The scale reaches the main thread for the next frame it records
+    const RollingStats *gpuFrameTimes = gGpuProfiler.getScopeTimes("Frame");
+    if (gpuFrameTimes != nullptr && gResolutionController.update(*gpuFrameTimes))
+    {
+        gRenderScale = gResolutionController.getScale();
+    }
+
+    {
+        CpuScope scope("PollMeshLoader");
+        PollMeshLoader();
+    }
+
+    // Only texture and unpack buffer bindings change, the state cache
+    // tracks neither
+    {
+        CpuScope scope("StreamTextures");
+        gTextureStreamer.update();
+    }
+    if (gWhiteTexture != 0)
+    {
+        GLuint texture = gTextureStreamer.getTextureObject(gSceneTexture);
+        glActiveTexture(GL_TEXTURE0 + gBaseColorTextureUnit);
+        glBindTexture(GL_TEXTURE_2D, texture != 0 ? texture : gWhiteTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // A swapped program is left bound behind the state cache's back
+    {
+        CpuScope scope("ShaderReload");
+        if (gShaderReloader.update())
+        {
+            gRenderBackend.getState().invalidate();
+        }
+    }
+
+    // Both only reallocate when the window was resized. The output is 0
+    // unless the frame goes to the offscreen target.
+    if (!gSceneTarget.resize(frame.mOutputWidth, frame.mOutputHeight))
+    {
+        std::cout << "Scene target could not be resized to " << frame.mOutputWidth << "x" << frame.mOutputHeight << std::endl;
+        exit(1);
+    }
+    gGpuCuller.resize(frame.mOutputWidth, frame.mOutputHeight);
+    GLuint output = gOffscreenTarget.getFramebuffer();
+    GLuint framebuffer = gSceneTarget.getFramebuffer();
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    bool gpuCulling = !frame.mCullModels.empty();
+    {
+        GpuScope frameScope(gGpuProfiler, "Frame");
+        CpuScope cpuFrameScope("Frame");
+        GLStateCache &state = gRenderBackend.getState();
+        GLintptr cullObjectOffset = -1;
+
+        // With a pre-pass the color pass only draws fragments that match
+        // the depth already written
+        PassState opaque;
+        if (frame.mDepthPrepass)
+        {
+            opaque.mDepthFunc = GL_EQUAL;
+            opaque.mDepthWrite = false;
+        }
+        PassState depthOnly;
+        depthOnly.mColorWrite = false;
+        gRenderBackend.setPassState(gDepthPass, depthOnly);
+        gRenderBackend.setPassState(gOpaquePass, opaque);
+        {
+            // Replay commits the uniform buffer, so the frame's blocks are
+            // written first and nothing draws while it is still mapped
+            GpuScope scope(gGpuProfiler, "Replay");
+            CpuScope cpuScope("Replay");
+            if (gUseInstancing)
+            {
+                gStreamBuffer.beginFrame();
+            }
+            gUniformStream.beginFrame();
+            cullObjectOffset = BindFrameBlocks(frame);
+            ReplayCommandBuffers(frame.mBuffers.data(), frame.mBuffers.size(), gRenderQueue, gRenderBackend, gStreamBuffer, gUniformStream);
+            if (gUseInstancing)
+            {
+                gStreamBuffer.endFrame();
+            }
+        }
+        if (gpuCulling)
+        {
+            GpuScope scope(gGpuProfiler, "Cull");
+            CpuScope cpuScope("Cull");
+            gGpuCuller.cull(state, frame.mCullMesh, frame.mCullModels.data(), (GLsizei)frame.mCullModels.size(), frame.mViewProjection);
+        }
+        if (gpuCulling && cullObjectOffset >= 0)
+        {
+            // The frame state was set by the replayed setup buffer
+            GpuScope scope(gGpuProfiler, "Culled");
+            CpuScope cpuScope("Culled");
+            glBindBufferRange(GL_UNIFORM_BUFFER, gObjectBlockBinding, gUniformStream.getBuffer(), cullObjectOffset, sizeof(ObjectBlock));
+            state.setEnabled(GL_CULL_FACE, gMeshMaterial.mCullBackFaces);
+            if (frame.mDepthPrepass)
+            {
+                state.setColorMask(false);
+                state.useProgram(gApp.mDepthShaderProgram->getProgram());
+                gGpuCuller.draw(state, frame.mCullMesh);
+                state.setColorMask(true);
+                state.setDepthFunc(GL_EQUAL);
+                state.setDepthMask(false);
+            }
+            state.useProgram(gApp.mGraphicsPipelineShaderProgram->getProgram());
+            gGpuCuller.draw(state, frame.mCullMesh);
+            state.setDepthFunc(GL_LESS);
+            state.setDepthMask(true);
+        }
+        if (gUseStaticArena)
+        {
+            // Static meshes after the sorted draws, the frame state is set
+            GpuScope scope(gGpuProfiler, "Static");
+            CpuScope cpuScope("Static");
+            state.setEnabled(GL_CULL_FACE, gStaticMaterial.mCullBackFaces);
+            state.useProgram(gApp.mMultiDrawShaderProgram->getProgram());
+            gStaticArenaCalls = gStaticArena.draw(state);
+        }
+        gUniformStream.endFrame();
+        if (gpuCulling)
+        {
+            // Next frame's occlusion test uses this frame's depth
+            GpuScope scope(gGpuProfiler, "HiZ");
+            CpuScope cpuScope("HiZ");
+            gGpuCuller.buildHiZ(state, framebuffer, frame.mRenderWidth, frame.mRenderHeight, frame.mViewProjection);
+        }
+        else
+        {
+            gGpuCuller.invalidateHiZ();
+        }
+        {
+            // A full size frame is copied texel for texel
+            GpuScope scope(gGpuProfiler, "Upscale");
+            CpuScope cpuScope("Upscale");
+            bool scaled = frame.mRenderWidth != frame.mOutputWidth || frame.mRenderHeight != frame.mOutputHeight;
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, output);
+            glBlitFramebuffer(0, 0, frame.mRenderWidth, frame.mRenderHeight, 0, 0, frame.mOutputWidth, frame.mOutputHeight, GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, output);
+        }
+        {
+            // Update screen, offscreen frames only wait for an older frame
+            GpuScope scope(gGpuProfiler, "Swap");
+            CpuScope cpuScope("Swap");
+            if (output != 0)
+            {
+                gOffscreenTarget.endFrame();
+            }
+            else
+            {
+                SDL_GL_SwapWindow(gApp.mGraphicsApplicationWindow);
+            }
+        }
+    }
+
+    gGpuProfiler.endFrame();
+
+    // Record the work time and wait out the rest of the frame
+    {
+        CpuScope scope("Pace");
+        gFramePacer.endFrame();
+    }
+
+    gRenderedFrames++;
+    if (gBenchmarkOptions.mEnabled && gRenderedFrames > gBenchmarkOptions.mWarmupFrames)
+    {
+        // The GPU culled instances are one indirect draw
+        const RenderBackend::Stats &stats = gRenderBackend.getStats();
+        size_t drawCalls = stats.draws + gStaticArenaCalls + (gpuCulling ? 1 : 0);
+        size_t triangles = stats.triangles + (gUseStaticArena ? gStaticArena.getTriangleCount() : 0);
+        gPendingBenchmarkFrame.mValid = true;
+        gPendingBenchmarkFrame.mWorkTime = gFramePacer.getWorkTimes().getLast();
+        gPendingBenchmarkFrame.mDrawCalls = drawCalls;
+        gPendingBenchmarkFrame.mTriangles = triangles;
+        gBenchmarkRecorder.addGpuScopes(gGpuProfiler);
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double>(now - lastReport).count() >= gStatsReportInterval)
+    {
+        gFramePacer.printReport(std::cout);
+        gGpuProfiler.printReport(std::cout);
+        const GLStateCache &state = gRenderBackend.getState();
+        std::cout << "Draws: " << gRenderBackend.getStats().draws << ", object ranges " << gRenderBackend.getStats().objectRangeChanges << ", state calls " << state.getCallCount()
+                  << ", skipped " << state.getSkippedCount() << std::endl;
+        if (gUseStaticArena)
+        {
+            std::cout << "Static draws: " << gStaticArena.getDrawCount() << " in " << gStaticArenaCalls << " calls" << std::endl;
+        }
+        std::cout << "Render scale " << gResolutionController.getScale() << " of " << frame.mOutputWidth << "x" << frame.mOutputHeight
+                  << (gResolutionController.isEnabled() ? ", dynamic" : ", fixed") << ", GPU budget " << gResolutionController.getBudget() << " ms" << std::endl;
+        TextureStreamer::Stats textures = gTextureStreamer.getStats();
+        if (textures.textures > 0)
+        {
+            std::cout << "Textures: " << textures.residentBytes / 1024 << " of " << textures.budget / 1024 << " KB resident, "
+                      << textures.uploads << " uploads, " << textures.evictions << " evictions" << std::endl;
+        }
+        gRenderBackend.getState().resetCounters();
+
+        std::lock_guard<std::mutex> lock(gReportMutex);
+        gReportTitle = "SDL game - GPU " + gGpuProfiler.getSummary();
+        lastReport = now;
+    }
+}
+
+// Benchmarks: place the camera for a frame. The warmup holds the start
+// of the path, the measured frames spread over all of it.
+void PlayCameraPath(int frameIndex)
+{
+    int measured = std::max(frameIndex - gBenchmarkOptions.mWarmupFrames, 0);
+    float t = (float)measured / (float)std::max(gBenchmarkOptions.mFrames - 1, 1);
+
+    glm::vec3 eye;
+    glm::vec3 direction;
+    gCameraPath.sample(t, eye, direction);
+    gApp.mCamera.setView(eye, direction);
 }
 
 void MainLoop()
 {
-    // Move mouse to middle of screen
-    SDL_WarpMouseInWindow(gApp.mGraphicsApplicationWindow, gApp.mScreenWidth / 2, gApp.mScreenHeight / 2);
-    SDL_SetRelativeMouseMode(SDL_TRUE);
-    SDL_ShowCursor(SDL_FALSE);
+    if (!gBenchmarkOptions.mEnabled)
+    {
+        // Move mouse to middle of screen
+        SDL_WarpMouseInWindow(gApp.mGraphicsApplicationWindow, gApp.mScreenWidth / 2, gApp.mScreenHeight / 2);
+        SDL_SetRelativeMouseMode(SDL_TRUE);
+        SDL_ShowCursor(SDL_FALSE);
+    }
 
-    bool frameSafe = true;
+    gRenderThread.start(gApp.mGraphicsApplicationWindow, gApp.mOpenGLContext, RenderFrame);
 
+    std::chrono::steady_clock::time_point lastReport = std::chrono::steady_clock::now();
+
+    int frameIndex = 0;
+    int benchmarkFrames = gBenchmarkOptions.mWarmupFrames + gBenchmarkOptions.mFrames;
+    gCurrentState.mEye = gApp.mCamera.getEye();
+    gPreviousState = gCurrentState;
+    std::chrono::steady_clock::time_point lastFrame = std::chrono::steady_clock::now();
     while (!gApp.mQuit)
     {
-        // Start frame timer
-        std::chrono::high_resolution_clock::time_point frameStart = std::chrono::high_resolution_clock::now();
+        // Last frame's jobs have all been waited for
+        gFrameArenas.reset();
 
         Input();
-        PreDraw();
-        Draw();
 
-        // Update screen
-        SDL_GL_SwapWindow(gApp.mGraphicsApplicationWindow);
+        if (gBenchmarkOptions.mEnabled)
+        {
+            if (frameIndex == benchmarkFrames)
+            {
+                break;
+            }
+            PlayCameraPath(frameIndex);
+        }
+
+        // Benchmarks simulate the same steps however fast they render
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        double elapsed = gBenchmarkOptions.mEnabled ? gSimulationStep : std::chrono::duration<double>(frameStart - lastFrame).count();
+        lastFrame = frameStart;
+        int steps = gTimestep.advance(elapsed);
 
-        // Calculate frame duration
-        std::chrono::high_resolution_clock::time_point frameEnd = std::chrono::high_resolution_clock::now();
-        long long frameTime = std::chrono::duration_cast<std::chrono::milliseconds>(frameEnd - frameStart).count();
+        // Waits only when the render thread is a whole frame behind
+        FrameCommands &frame = gRenderThread.beginFrame();
+        if (gCyclePacerMode)
+        {
+            frame.mTasks.push_back([]()
+                                   { gFramePacer.cycleMode(); });
+            gCyclePacerMode = false;
+        }
+        if (gToggleDynamicResolution)
+        {
+            frame.mTasks.push_back([]()
+                                   {
+                                       gResolutionController.setEnabled(!gResolutionController.isEnabled());
+                                       std::cout << "Dynamic resolution " << (gResolutionController.isEnabled() ? "on" : "off") << std::endl; });
+            gToggleDynamicResolution = false;
+        }
 
-        // Delay to maintain target frame rate
-        if (frameTime < gFrameDuration)
+        std::chrono::steady_clock::time_point workStart = std::chrono::steady_clock::now();
+        UpdateSceneMesh(frame);
+        for (int step = 0; step < steps; step++)
         {
-            SDL_Delay(gFrameDuration - frameTime);
+            Simulate((float)gSimulationStep);
         }
-        else if (frameSafe && frameTime > gFrameDuration)
+        Interpolate(gTimestep.getAlpha());
+        if (!gBenchmarkOptions.mEnabled && !gBenchmarkOptions.mRecordPath.empty())
         {
-            std::cout << "Frame rate has dropped below " << gTargetFPS << " FPS" << std::endl;
-            frameSafe = false;
+            gCameraPath.addKey((float)frameIndex, gApp.mCamera.getEye(), gApp.mCamera.getViewDirection());
         }
+        UpdateTransforms();
+        RecordFrame(frame);
+        double workTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - workStart).count();
+        gRenderThread.submitFrame();
+
+        if (gBenchmarkOptions.mEnabled && frameIndex >= gBenchmarkOptions.mWarmupFrames)
+        {
+            gBenchmarkRecorder.addCpuFrame(workTime);
+        }
+        frameIndex++;
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - lastReport).count() >= gStatsReportInterval)
+        {
+            if (gUseGpuCulling)
+            {
+                std::cout << "Visible instances: culled on the GPU" << std::endl;
+            }
+            else
+            {
+                std::cout << "Visible instances: " << gVisibleCount << " of " << gSceneIndex.getObjectCount() << ", per LOD:";
+                for (GLsizei count : gLodCounts)
+                {
+                    std::cout << " " << count;
+                }
+                std::cout << std::endl;
+            }
+            std::cout << "Simulation: " << gTimestep.getStepCount() << " steps, " << gTimestep.getDroppedTime() * 1000.0 << " ms dropped" << std::endl;
+            std::cout << "Frame arenas: peak " << gFrameArenas.getPeak() / 1024 << " of " << gFrameArenas.getCapacity() / 1024
+                      << " KB, " << gFrameArenas.getOverflowCount() << " overflows" << std::endl;
+
+            std::lock_guard<std::mutex> lock(gReportMutex);
+            SDL_SetWindowTitle(gApp.mGraphicsApplicationWindow, gReportTitle.c_str());
+            lastReport = now;
+        }
+    }
+
+    // Replays the frames still queued and gives the context back
+    gRenderThread.stop();
+
+    gFramePacer.printReport(std::cout);
+    gGpuProfiler.printReport(std::cout);
+    gGpuProfiler.writeCsv(gGpuProfileFile);
+    if (CpuProfilerWriteTrace(gCpuTraceFile))
+    {
+        std::cout << "CPU trace saved to " << gCpuTraceFile << std::endl;
+    }
+
+    if (gBenchmarkOptions.mEnabled)
+    {
+        // No frame follows the last one, it ends when its work does
+        if (gPendingBenchmarkFrame.mValid)
+        {
+            gBenchmarkRecorder.addRenderFrame(gPendingBenchmarkFrame.mWorkTime, gPendingBenchmarkFrame.mWorkTime,
+                                              gPendingBenchmarkFrame.mDrawCalls, gPendingBenchmarkFrame.mTriangles);
+        }
+
+        BenchmarkInfo info;
+        info.mRenderer = (const char *)glGetString(GL_RENDERER);
+        info.mVersion = (const char *)glGetString(GL_VERSION);
+        info.mSimd = TransformSystem::getSimdName();
+        info.mInstances = gTransforms.size();
+        info.mStaticMeshes = gUseStaticArena ? gStaticArena.getMeshCount() : 0;
+        info.mJobThreads = gJobSystem.getThreadCount();
+        info.mMultiDraw = gStaticArena.usesMultiDraw();
+        info.mCameraPath = gBenchmarkOptions.mCameraPath.empty() ? "flyover" : gBenchmarkOptions.mCameraPath;
+        gBenchmarkRecorder.writeJson(gBenchmarkOptions.mOutputPath, gBenchmarkOptions, info);
+    }
+    else if (!gBenchmarkOptions.mRecordPath.empty() && gCameraPath.save(gBenchmarkOptions.mRecordPath))
+    {
+        std::cout << "Camera path saved to " << gBenchmarkOptions.mRecordPath << std::endl;
     }
 }
 
 void CleanUp()
 {
+    // Loader jobs finish before the job system goes away
+    gMeshLoader.stop();
+    gTextureStreamer.stop();
+    gJobSystem.stop();
+    gFrameArenas.destroy();
+    gGpuProfiler.destroy();
+    gStreamBuffer.destroy();
+    gUniformStream.destroy();
+    DestroyMesh(&gMesh);
+    gStaticArena.destroy();
+    gGpuCuller.destroy();
+    gOffscreenTarget.destroy();
+    gSceneTarget.destroy();
+    gShaderReloader.stop();
+    gMeshPermutations.destroy();
+    gMultiDrawPermutations.destroy();
+    glDeleteTextures(1, &gWhiteTexture);
+
+    SDL_GL_DeleteContext(gApp.mOpenGLContext);
+
     // Destroy the window
     SDL_DestroyWindow(gApp.mGraphicsApplicationWindow);
 
@@ -423,18 +1553,77 @@ void CleanUp()
     SDL_Quit();
 }
 
+// Scene and window size from the command line, and the benchmark's path
+void ApplyCommandLine()
+{
+    BenchmarkOptions &options = gBenchmarkOptions;
+    if (options.mInstances > 0)
+    {
+        gInstanceCount = options.mInstances;
+        gInstanceGridSize = (int)std::ceil(std::sqrt((double)gInstanceCount));
+    }
+    if (options.mStaticMeshes >= 0)
+    {
+        gStaticMeshCount = options.mStaticMeshes;
+    }
+    if (options.mWidth > 0)
+    {
+        gApp.mScreenWidth = options.mWidth;
+        gApp.mScreenHeight = options.mHeight;
+    }
+    options.mWidth = gApp.mScreenWidth;
+    options.mHeight = gApp.mScreenHeight;
+    gUseGpuCulling = options.mGpuCulling && gUseInstancing;
+    gUseDepthPrepass = options.mDepthPrepass;
+
+    if (!options.mEnabled)
+    {
+        return;
+    }
+
+    if (!options.mCameraPath.empty())
+    {
+        if (!gCameraPath.load(options.mCameraPath))
+        {
+            exit(1);
+        }
+    }
+    else
+    {
+        int rows = (gInstanceCount + gInstanceGridSize - 1) / gInstanceGridSize;
+        gCameraPath.makeFlyover(std::max(rows * gInstanceSpacing, 10.0f));
+    }
+    gBenchmarkRecorder.start(options.mFrames);
+}
+
 int main(int argc, char *argv[])
 {
+    if (!ParseBenchmarkOptions(argc, argv, gBenchmarkOptions))
+    {
+        return 1;
+    }
+    ApplyCommandLine();
+    CpuProfilerSetThreadName("Main");
+
     // Setup graphics program
     InitializeProgram(&gApp);
 
     // Set up geometry, VAO, and VBO
     VertexSpecification(&gMesh);
+    CreateScene();
+
+    // The main thread becomes thread 0 of the job system
+    gJobSystem.start();
+    std::cout << "Job threads: " << gJobSystem.getThreadCount() << std::endl;
+    gFrameArenas.create(gJobSystem.getThreadCount(), gFrameArenaSize);
+    RequestSceneMesh();
+    RequestSceneTexture();
 
     // Create graphics pipeline
     // At the moment we set up the
     // vertex and fragment shaders
     CreateGraphicsPipeline();
+    CreateStaticScene();
 
     // Call main loop
     MainLoop();